@@ -0,0 +1,44 @@
+#pragma once
+
+#include "BasicMetrics.h"
+#include "ConfigManager.h"
+#include "DNSResolver.h"
+#include "EventPublisher.h"
+#include "MockDnsServer.h"
+#include "interface/ILogger.h"
+#include <functional>
+#include <memory>
+
+namespace leigod::dns::bench {
+
+    // 丢弃所有日志，避免格式化输出影响测量结果
+    class NullLogger : public ILogger {
+    public:
+        bool shouldLog(int) const override { return false; }
+        void log(int, const char *, const char *, int, const std::string &) const override {}
+    };
+
+    // 创建指向模拟服务器、由内部I/O线程驱动的解析器
+    inline std::shared_ptr<DNSResolver> makeResolver(const MockDnsServer &server,
+                                                     const std::function<void(DNSResolverConfig &)> &tweak = {}) {
+        auto logger = std::make_shared<NullLogger>();
+        auto configManager = std::make_shared<ConfigManager>(logger);
+
+        DNSResolverConfig config;
+        config.servers.push_back({"127.0.0.1", server.port(), 1, 2000, true});
+        config.managed_io = true;
+        config.max_concurrent_queries = 100000;
+        if (tweak) {
+            tweak(config);
+        }
+        configManager->updateConfig(config);
+
+        auto resolver = std::make_shared<DNSResolver>(logger, configManager, std::make_shared<BasicMetrics>(logger),
+                                                      std::make_shared<EventPublisher>());
+        if (!resolver->initialize()) {
+            return nullptr;
+        }
+        return resolver;
+    }
+
+}// namespace leigod::dns::bench
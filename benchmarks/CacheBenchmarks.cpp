@@ -0,0 +1,169 @@
+#include "LRUCache.h"
+#include "ShardedLRUCache.h"
+#include "TinyLfuCache.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace leigod::dns;
+
+namespace {
+    constexpr size_t CACHE_CAPACITY = 10000;
+    constexpr size_t HOST_COUNT = 4096;
+    constexpr int64_t CACHE_TTL = 3600 * 1000;
+
+    const std::vector<std::string> &hostnames() {
+        static const std::vector<std::string> hosts = [] {
+            std::vector<std::string> result;
+            result.reserve(HOST_COUNT);
+            for (size_t i = 0; i < HOST_COUNT; ++i) {
+                result.push_back("host" + std::to_string(i) + ".bench.example.com");
+            }
+            return result;
+        }();
+        return hosts;
+    }
+
+    const AddressList &addresses() {
+        static const AddressList list{*IPAddress::parse("192.0.2.1"), *IPAddress::parse("192.0.2.2")};
+        return list;
+    }
+
+    template<typename Cache>
+    std::unique_ptr<Cache> createCache();
+
+    template<>
+    std::unique_ptr<LRUCache> createCache<LRUCache>() {
+        return std::make_unique<LRUCache>(CACHE_CAPACITY, CACHE_TTL);
+    }
+
+    template<>
+    std::unique_ptr<ShardedLRUCache> createCache<ShardedLRUCache>() {
+        return std::make_unique<ShardedLRUCache>(CACHE_CAPACITY, CACHE_TTL, 16);
+    }
+
+    template<>
+    std::unique_ptr<TinyLfuCache> createCache<TinyLfuCache>() {
+        return std::make_unique<TinyLfuCache>(CACHE_CAPACITY, CACHE_TTL);
+    }
+
+    // 访问轨迹回放时的缓存容量（小于热点集合，淘汰策略决定命中率）
+    constexpr size_t TRACE_CACHE_CAPACITY = 2000;
+    constexpr size_t TRACE_HOT_SET = 8000;
+    constexpr size_t TRACE_LENGTH = 1 << 20;
+
+    /**
+     * 访问轨迹：DNS_BENCH_TRACE指向每行一个主机名的记录文件时回放该文件；
+     * 否则生成Zipf分布的热点访问，每隔一段穿插一次一次性名称的扫描突发（模拟爬虫）
+     */
+    const std::vector<std::string> &trace() {
+        static const std::vector<std::string> names = [] {
+            std::vector<std::string> result;
+            if (const char *path = std::getenv("DNS_BENCH_TRACE")) {
+                std::ifstream file(path);
+                for (std::string line; std::getline(file, line);) {
+                    if (!line.empty()) {
+                        result.push_back(std::move(line));
+                    }
+                }
+                if (!result.empty()) {
+                    return result;
+                }
+            }
+
+            std::vector<double> weights(TRACE_HOT_SET);
+            for (size_t i = 0; i < weights.size(); ++i) {
+                weights[i] = 1.0 / static_cast<double>(i + 1);
+            }
+            std::mt19937 rng(42);
+            std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+            result.reserve(TRACE_LENGTH);
+            size_t scanned = 0;
+            for (size_t i = 0; i < TRACE_LENGTH; ++i) {
+                const bool burst = (i / 16384) % 4 == 3;
+                if (burst && rng() % 2 == 0) {
+                    result.push_back("scan" + std::to_string(scanned++) + ".crawler.example.com");
+                } else {
+                    result.push_back("host" + std::to_string(zipf(rng)) + ".bench.example.com");
+                }
+            }
+            return result;
+        }();
+        return names;
+    }
+
+    // 所有线程共享同一个预热过的缓存实例
+    template<typename Cache>
+    Cache &sharedCache() {
+        static const auto cache = [] {
+            auto result = createCache<Cache>();
+            for (const auto &host: hostnames()) {
+                result->update(host, addresses(), std::chrono::milliseconds(-1));
+            }
+            return result;
+        }();
+        return *cache;
+    }
+
+    template<typename Cache>
+    void BM_CacheGet(benchmark::State &state) {
+        auto &cache = sharedCache<Cache>();
+        const auto &hosts = hostnames();
+
+        size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+        AddressList ips;
+        for (auto _: state) {
+            benchmark::DoNotOptimize(cache.get(hosts[i++ % hosts.size()], ips));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template<typename Cache>
+    void BM_CacheUpdate(benchmark::State &state) {
+        auto &cache = sharedCache<Cache>();
+        const auto &hosts = hostnames();
+
+        size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+        for (auto _: state) {
+            cache.update(hosts[i++ % hosts.size()], addresses(), std::chrono::milliseconds(-1));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    // 回放访问轨迹：未命中时写入，模拟解析器的读穿透；hit_rate计数反映淘汰策略的效果
+    template<typename Cache>
+    void BM_CacheTrace(benchmark::State &state) {
+        const auto &names = trace();
+        std::vector<HostnameKey> keys;
+        keys.reserve(names.size());
+        for (const auto &name: names) {
+            keys.emplace_back(name);
+        }
+
+        double hit_rate = 0.0;
+        for (auto _: state) {
+            Cache cache(TRACE_CACHE_CAPACITY, CACHE_TTL);
+            AddressList ips;
+            for (const auto &key: keys) {
+                if (!cache.lookup(key, ips).hit) {
+                    cache.update(key.name, addresses(), std::chrono::milliseconds(-1));
+                }
+            }
+            hit_rate = cache.hit_rate();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keys.size()));
+        state.counters["hit_rate"] = hit_rate;
+    }
+}// namespace
+
+BENCHMARK_TEMPLATE(BM_CacheGet, LRUCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheGet, ShardedLRUCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheUpdate, LRUCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheUpdate, ShardedLRUCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheGet, TinyLfuCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheUpdate, TinyLfuCache)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CacheTrace, LRUCache)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CacheTrace, TinyLfuCache)->Unit(benchmark::kMillisecond);
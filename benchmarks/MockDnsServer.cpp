@@ -0,0 +1,132 @@
+#include "MockDnsServer.h"
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace leigod::dns::bench {
+
+    namespace {
+        constexpr size_t DNS_HEADER_SIZE = 12;
+        constexpr uint16_t TYPE_A = 1;
+        constexpr uint32_t ANSWER_TTL = 300;
+
+        void closeSocket(intptr_t socket) {
+#ifdef _WIN32
+            closesocket(static_cast<SOCKET>(socket));
+#else
+            close(static_cast<int>(socket));
+#endif
+        }
+
+        // 跳过问题段中的QNAME，返回QTYPE的偏移，报文不完整时返回0
+        size_t skipQuestionName(const uint8_t *packet, size_t length) {
+            size_t offset = DNS_HEADER_SIZE;
+            while (offset < length && packet[offset] != 0) {
+                offset += packet[offset] + 1;
+            }
+            ++offset;
+            return offset + 4 <= length ? offset : 0;
+        }
+    }// namespace
+
+    MockDnsServer::MockDnsServer() {
+        const auto fd = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+        if (fd == INVALID_SOCKET) {
+#else
+        if (fd < 0) {
+#endif
+            throw std::runtime_error("Failed to create mock DNS socket");
+        }
+        socket_ = static_cast<intptr_t>(fd);
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            closeSocket(socket_);
+            throw std::runtime_error("Failed to bind mock DNS socket");
+        }
+
+        socklen_t addr_len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+        port_ = ntohs(addr.sin_port);
+
+        // 接收超时用于周期性检查停止标志
+#ifdef _WIN32
+        DWORD timeout = 100;
+#else
+        timeval timeout{0, 100 * 1000};
+#endif
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    MockDnsServer::~MockDnsServer() {
+        stop_ = true;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        closeSocket(socket_);
+    }
+
+    void MockDnsServer::run() {
+        std::array<uint8_t, 512> packet{};
+        while (!stop_) {
+            sockaddr_in peer{};
+            socklen_t peer_len = sizeof(peer);
+            const auto received = recvfrom(socket_, reinterpret_cast<char *>(packet.data()), packet.size(), 0,
+                                           reinterpret_cast<sockaddr *>(&peer), &peer_len);
+            if (received < 0 || static_cast<size_t>(received) < DNS_HEADER_SIZE) {
+                continue;
+            }
+
+            const size_t qtype_offset = skipQuestionName(packet.data(), static_cast<size_t>(received));
+            if (qtype_offset == 0) {
+                continue;
+            }
+            queries_.fetch_add(1, std::memory_order_relaxed);
+
+            // 应答：保留ID和问题段，丢弃EDNS等附加记录
+            const uint16_t qtype = static_cast<uint16_t>(packet[qtype_offset] << 8 | packet[qtype_offset + 1]);
+            size_t length = qtype_offset + 4;
+            const bool answer = qtype == TYPE_A && length + 16 <= packet.size();
+
+            packet[2] = static_cast<uint8_t>(0x80 | (packet[2] & 0x01));// QR + RD
+            packet[3] = 0x80;                                           // RA, NOERROR
+            packet[6] = 0;
+            packet[7] = answer ? 1 : 0;// ANCOUNT
+            std::memset(&packet[8], 0, 4);// NSCOUNT, ARCOUNT
+
+            if (answer) {
+                const uint8_t record[] = {
+                        0xC0, 0x0C,// 指向问题段中的名字
+                        0x00, 0x01,// TYPE A
+                        0x00, 0x01,// CLASS IN
+                        static_cast<uint8_t>(ANSWER_TTL >> 24), static_cast<uint8_t>(ANSWER_TTL >> 16),
+                        static_cast<uint8_t>(ANSWER_TTL >> 8), static_cast<uint8_t>(ANSWER_TTL),
+                        0x00, 0x04,// RDLENGTH
+                        127, 0, 0, 1,
+                };
+                std::memcpy(&packet[length], record, sizeof(record));
+                length += sizeof(record);
+            }
+
+            sendto(socket_, reinterpret_cast<const char *>(packet.data()), static_cast<int>(length), 0,
+                   reinterpret_cast<sockaddr *>(&peer), peer_len);
+        }
+    }
+
+}// namespace leigod::dns::bench
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace leigod::dns::bench {
+
+    /**
+     * 本地UDP模拟DNS服务器
+     * 绑定127.0.0.1的临时端口，对A查询返回固定地址，对其他类型返回无记录的NOERROR应答
+     */
+    class MockDnsServer {
+    public:
+        MockDnsServer();
+        ~MockDnsServer();
+
+        MockDnsServer(const MockDnsServer &) = delete;
+        MockDnsServer &operator=(const MockDnsServer &) = delete;
+
+        uint16_t port() const { return port_; }
+        uint64_t queries() const { return queries_.load(std::memory_order_relaxed); }
+
+    private:
+        void run();
+
+        intptr_t socket_{-1};
+        uint16_t port_{0};
+        std::atomic<bool> stop_{false};
+        std::atomic<uint64_t> queries_{0};
+        std::thread thread_;
+    };
+
+}// namespace leigod::dns::bench
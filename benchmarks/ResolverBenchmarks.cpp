@@ -0,0 +1,308 @@
+#include "BenchmarkSupport.h"
+#include "Hostname.h"
+#include <ares.h>
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace leigod::dns;
+using namespace leigod::dns::bench;
+
+namespace {
+    // 模拟服务器与预热过的解析器在所有基准之间共享
+    struct ResolverEnvironment {
+        MockDnsServer server;
+        std::shared_ptr<DNSResolver> resolver = makeResolver(server);
+        std::vector<std::string> hosts;
+
+        ResolverEnvironment() {
+            for (int i = 0; i < 64; ++i) {
+                hosts.push_back("warm" + std::to_string(i) + ".bench.test");
+            }
+            warm();
+        }
+
+        void warm() {
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t done = 0;
+            for (const auto &host: hosts) {
+                resolver->resolve(host, [&](const ResolveResult &) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++done;
+                    cv.notify_one();
+                });
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::seconds(5), [&] { return done == hosts.size(); });
+        }
+    };
+
+    ResolverEnvironment &environment() {
+        static ResolverEnvironment env;
+        return env;
+    }
+
+    void BM_IsValidHostname(benchmark::State &state) {
+        const std::vector<std::string> hosts = {
+                "example.com",
+                "www.some-long-subdomain.example.co.uk",
+                "a.b.c.d.e.f.g.h.example.org",
+                "invalid-.example.com",
+        };
+        size_t i = 0;
+        for (auto _: state) {
+            benchmark::DoNotOptimize(isValidHostname(hosts[i++ % hosts.size()]));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_CanonicalizeHostname(benchmark::State &state) {
+        const std::vector<std::string> hosts = {
+                "Example.COM",
+                "www.some-long-subdomain.example.co.uk.",
+                "A.B.C.D.E.F.G.H.EXAMPLE.ORG",
+                "cdn-edge-node-0042.eu-central-1.static-assets.example.net",
+        };
+        HostnameKey key;
+        size_t i = 0;
+        for (auto _: state) {
+            benchmark::DoNotOptimize(canonicalizeHostname(hosts[i++ % hosts.size()], key));
+            benchmark::DoNotOptimize(key.hash);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_RecordQuery(benchmark::State &state) {
+        static BasicMetrics metrics(std::make_shared<NullLogger>());
+        const std::string host = "host" + std::to_string(state.thread_index() % 8) + ".bench.test";
+        int64_t duration = 0;
+        for (auto _: state) {
+            metrics.recordQuery(host, duration++ % 50, true);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // 缓存命中时resolve()在调用线程上同步完成
+    void BM_ResolveCacheHit(benchmark::State &state) {
+        auto &env = environment();
+        if (!env.resolver) {
+            state.SkipWithError("Failed to initialize resolver");
+            return;
+        }
+
+        size_t i = static_cast<size_t>(state.thread_index());
+        for (auto _: state) {
+            env.resolver->resolve(env.hosts[i++ % env.hosts.size()], [](const ResolveResult &result) {
+                benchmark::DoNotOptimize(result.ip_addresses.size());
+            });
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * 缓存命中路径上的查询跟踪开销：参数为采样率（千分比），0时只多一次采样阈值比较
+     */
+    void BM_ResolveCacheHitTraced(benchmark::State &state) {
+        auto &env = environment();
+        if (!env.resolver) {
+            state.SkipWithError("Failed to initialize resolver");
+            return;
+        }
+
+        const auto tracer = env.resolver->getTracer();
+        if (state.thread_index() == 0) {
+            tracer->setSampleRate(static_cast<double>(state.range(0)) / 1000.0);
+        }
+
+        size_t i = static_cast<size_t>(state.thread_index());
+        for (auto _: state) {
+            env.resolver->resolve(env.hosts[i++ % env.hosts.size()], [](const ResolveResult &result) {
+                benchmark::DoNotOptimize(result.ip_addresses.size());
+            });
+        }
+        state.SetItemsProcessed(state.iterations());
+
+        if (state.thread_index() == 0) {
+            tracer->setSampleRate(0);
+        }
+    }
+
+    /**
+     * 闭环负载生成：保持固定数量的在途查询，每个查询完成后立即发起下一个
+     * 每次查询使用新的主机名以绕过缓存，统计QPS与延迟分位数；第三个参数选择查询策略（0为cares，1为udp_batch）
+     */
+    void BM_ClosedLoopLoad(benchmark::State &state) {
+        const auto concurrency = static_cast<size_t>(state.range(0));
+        const auto io_threads = static_cast<uint32_t>(state.range(1));
+        const std::string strategy = state.range(2) == 0 ? "cares" : "udp_batch";
+        constexpr auto RUN_DURATION = std::chrono::seconds(2);
+
+        struct Slot {
+            std::vector<int64_t> latencies_ns;
+            uint64_t failures{0};
+            // 发起方与完成回调各加一次，后到的一方发起下一个查询
+            std::atomic<int> handoff{0};
+        };
+
+        MockDnsServer server;
+        for (auto _: state) {
+            auto resolver = makeResolver(server, [io_threads, &strategy](DNSResolverConfig &config) {
+                config.io_threads = io_threads;
+                config.query_strategy = strategy;
+            });
+            if (!resolver) {
+                state.SkipWithError("Failed to initialize resolver");
+                return;
+            }
+
+            std::vector<Slot> slots(concurrency);
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<size_t> active{concurrency};
+            std::mutex mutex;
+            std::condition_variable cv;
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto deadline = start + RUN_DURATION;
+
+            // 每个槽位串行发起查询。回调在resolve()返回前就已执行（缓存命中、立即失败）时由这里的循环
+            // 发起下一个，不在回调中递归，栈深度不随同步完成的次数增长
+            std::function<void(size_t)> issue = [&](size_t slot) {
+                auto &s = slots[slot];
+                while (true) {
+                    s.handoff.store(0, std::memory_order_relaxed);
+                    const auto name =
+                            "q" + std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) + ".load.test";
+                    const auto issued = std::chrono::steady_clock::now();
+                    resolver->resolve(name, [&, slot, issued](const ResolveResult &result) {
+                        const auto now = std::chrono::steady_clock::now();
+                        auto &s = slots[slot];
+                        s.latencies_ns.push_back(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(now - issued).count());
+                        s.failures += result.status != ARES_SUCCESS;
+
+                        if (now >= deadline) {
+                            if (active.fetch_sub(1) == 1) {
+                                std::lock_guard<std::mutex> lock(mutex);
+                                cv.notify_one();
+                            }
+                        } else if (s.handoff.fetch_add(1, std::memory_order_acq_rel) == 1) {
+                            issue(slot);
+                        }
+                    });
+                    if (s.handoff.fetch_add(1, std::memory_order_acq_rel) == 0) {
+                        return;
+                    }
+                }
+            };
+
+            for (size_t slot = 0; slot < concurrency; ++slot) {
+                issue(slot);
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, RUN_DURATION + std::chrono::seconds(10), [&] { return active == 0; });
+            }
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            state.SetIterationTime(elapsed);
+
+            // 先关闭解析器，保证不再有回调引用本次迭代的局部状态
+            resolver->shutdown();
+
+            std::vector<int64_t> latencies;
+            uint64_t failures = 0;
+            for (const auto &s: slots) {
+                latencies.insert(latencies.end(), s.latencies_ns.begin(), s.latencies_ns.end());
+                failures += s.failures;
+            }
+
+            auto percentile = [&latencies](double p) {
+                if (latencies.empty()) {
+                    return 0.0;
+                }
+                const auto index = static_cast<size_t>(p * static_cast<double>(latencies.size() - 1));
+                std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+                return static_cast<double>(latencies[index]) / 1000.0;
+            };
+
+            state.counters["qps"] = static_cast<double>(latencies.size()) / elapsed;
+            state.counters["p50_us"] = percentile(0.50);
+            state.counters["p99_us"] = percentile(0.99);
+            state.counters["p999_us"] = percentile(0.999);
+            state.counters["failures"] = static_cast<double>(failures);
+        }
+    }
+
+    /**
+     * 在第一个完成回调中关闭解析器：关闭推迟到查询策略的事件分发返回之后，其余查询以取消结束。
+     * 同时作为回调重入shutdown()的回归检查，任一查询未完成即报错；第一个参数为是否托管I/O，第二个选择查询策略
+     */
+    void BM_ShutdownFromCallback(benchmark::State &state) {
+        const bool managed = state.range(0) != 0;
+        const std::string strategy = state.range(1) == 0 ? "cares" : "udp_batch";
+        constexpr size_t QUERIES = 4;
+
+        MockDnsServer server;
+        uint64_t sequence = 0;
+        for (auto _: state) {
+            auto resolver = makeResolver(server, [managed, &strategy](DNSResolverConfig &config) {
+                config.managed_io = managed;
+                config.query_strategy = strategy;
+                config.cache.enabled = false;
+            });
+            if (!resolver) {
+                state.SkipWithError("Failed to initialize resolver");
+                return;
+            }
+
+            std::atomic<size_t> done{0};
+            std::weak_ptr<DNSResolver> weak = resolver;
+            for (size_t i = 0; i < QUERIES; ++i) {
+                resolver->resolve("s" + std::to_string(sequence++) + ".shutdown.test", [&done, weak](const ResolveResult &) {
+                    if (done.fetch_add(1) == 0) {
+                        if (auto self = weak.lock()) {
+                            self->shutdown();
+                        }
+                    }
+                });
+            }
+
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (done < QUERIES && std::chrono::steady_clock::now() < deadline) {
+                if (managed) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                } else {
+                    resolver->processEvents();
+                }
+            }
+            if (done != QUERIES) {
+                state.SkipWithError("Queries were not completed after shutdown from a callback");
+                return;
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}// namespace
+
+BENCHMARK(BM_IsValidHostname);
+BENCHMARK(BM_CanonicalizeHostname);
+BENCHMARK(BM_RecordQuery)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ResolveCacheHit)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ResolveCacheHitTraced)->ArgName("sample_permille")->Arg(0)->Arg(10)->Arg(1000)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ClosedLoopLoad)
+        ->ArgNames({"concurrency", "io_threads", "strategy"})
+        ->ArgsProduct({{1, 16, 64}, {1, 2, 4, 8}, {0, 1}})
+        ->Iterations(1)
+        ->UseManualTime()
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ShutdownFromCallback)
+        ->ArgNames({"managed", "strategy"})
+        ->ArgsProduct({{0, 1}, {0, 1}})
+        ->Unit(benchmark::kMicrosecond);
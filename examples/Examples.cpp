@@ -2,6 +2,7 @@
 #include "ConfigManager.h"
 #include "DNSResolver.h"
 #include "EventPublisher.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
@@ -34,6 +35,8 @@ namespace leigod {
         public:
             explicit ConsoleLogger(Level minLevel = Level::kINFO) : minLevel_(minLevel) {}
 
+            bool shouldLog(int level) const override { return level >= minLevel_; }
+
             void log(int level, const char *file, const char *func, int line, const std::string &message) const override {
 
                 if (level < minLevel_) return;
@@ -131,20 +134,27 @@ int main(int argv, char *argc[]) {
             "google.com", "github.com", "stackoverflow.com",
             "example.com", "wikipedia.org", "reddit.com"};
 
-    for (const auto &domain: domains) {
-        resolver->resolve(domain, [domain](const ResolveResult &result) {
-            std::cout << domain << ": ";
-            if (result.status == 0) {
-                for (const auto &ip: result.ip_addresses) {
-                    std::cout << ip << " ";
+    // 启动时批量解析：每个结果就绪即打印，全部完成后汇总
+    resolver->resolveMany(
+            domains,
+            [](std::vector<ResolveResult> results) {
+                const auto succeeded = std::ranges::count_if(results, [](const ResolveResult &result) {
+                    return result.status == 0;
+                });
+                std::cout << "Batch resolved " << succeeded << "/" << results.size() << " domains" << std::endl;
+            },
+            [](const ResolveResult &result) {
+                std::cout << result.hostname << ": ";
+                if (result.status == 0) {
+                    for (const auto &ip: result.ip_addresses) {
+                        std::cout << ip << " ";
+                    }
+                    std::cout << "(" << result.resolution_time << "us)";
+                } else {
+                    std::cout << "Failed: " << result.error;
                 }
-                std::cout << "(" << result.resolution_time << "ms)";
-            } else {
-                std::cout << "Failed: " << result.error;
-            }
-            std::cout << std::endl;
-        });
-    }
+                std::cout << std::endl;
+            });
 
     std::thread thr([&resolver]() {
         while (g_running) {
@@ -167,6 +177,9 @@ int main(int argv, char *argc[]) {
             std::cout << "Cache misses: " << stats.cache_misses << std::endl;
             std::cout << "Cache hit rate: " << (stats.cache_hit_rate * 100) << "%" << std::endl;
             std::cout << "Avg query time: " << stats.avg_query_time_ms << "ms" << std::endl;
+            std::cout << "Query time p50/p99/p999: " << stats.query_time_us.percentile(0.5) << "/"
+                      << stats.query_time_us.percentile(0.99) << "/" << stats.query_time_us.percentile(0.999) << "us"
+                      << std::endl;
             std::cout << "=============" << std::endl;
 
             lastStatsTime = now;
@@ -178,7 +191,7 @@ int main(int argv, char *argc[]) {
                         for (const auto &ip: result.ip_addresses) {
                             std::cout << ip << " ";
                         }
-                        std::cout << "(" << result.resolution_time << "ms)";
+                        std::cout << "(" << result.resolution_time << "us)";
                     } else {
                         std::cout << "Failed: " << result.error;
                     }
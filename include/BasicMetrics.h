@@ -4,34 +4,42 @@
 #include "interface/IMetrics.h"
 #include <atomic>
 #include <chrono>
-#include <deque>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace leigod::dns {
     class BasicMetrics : public IMetrics {
+        // 每个线程分片跟踪的热点主机名数量
+        static constexpr size_t HOST_TOP_K = 128;
+        // 热点主机名快照的发布间隔（记录次数）
+        static constexpr uint32_t HOST_PUBLISH_INTERVAL = 256;
+
     public:
-        explicit BasicMetrics(std::shared_ptr<ILogger> logger)
-            : logger_(std::move(logger)),
-              last_cleanup_(std::chrono::steady_clock::now()),
-              last_performance_update_(std::chrono::steady_clock::now()) {}
+        explicit BasicMetrics(std::shared_ptr<ILogger> logger);
 
         ~BasicMetrics() override = default;
 
         // IMetrics 接口实现
         void recordQuery(const std::string &hostname, int64_t duration, bool success) override;
-        void recordCacheHit(const std::string &hostname) override;
+        void recordCacheHit(const std::string &hostname, int64_t duration) override;
+        void recordNegativeCacheHit(const std::string &hostname, int64_t duration) override;
         void recordCacheMiss(const std::string &hostname) override;
         void recordError(const std::string &type, const std::string &detail) override;
         void recordRetry(const std::string &hostname, uint32_t attempt) override;
+        void recordHedge(HedgeOutcome outcome) override;
+        void recordAdmission(AdmissionOutcome outcome, size_t queue_depth, int64_t wait_time) override;
+        void recordServerLatency(const std::string &server, int64_t latency) override;
         Stats getStats() const override;
         void resetStats() override;
 
         // 扩展功能
-        void recordServerLatency(const std::string &server, int64_t latency);
         std::string getPrometheusMetrics() const;
 
         // 性能指标结构
@@ -61,36 +69,150 @@ namespace leigod::dns {
         std::vector<std::string> checkAlertConditions() const;
 
     private:
+        // 主机名热点统计条目
+        struct HostEntry {
+            std::string hostname;
+            uint64_t weight{0};// Space-Saving计数（可能高估，高估量不超过error）
+            uint64_t error{0};
+            HostStats stats;
+        };
+
+        /**
+         * Space-Saving热点主机名统计：只保留固定数量的条目，
+         * 新主机名替换计数最小的条目并继承其计数作为误差上界。只由所属线程访问。
+         * 条目下标按计数组成小顶堆，替换时直接取堆顶；热点条目计数大、位于堆底，命中时很少需要下沉
+         */
+        class HeavyHitters {
+        public:
+            explicit HeavyHitters(size_t capacity);
+            HostStats &touch(const std::string &hostname);
+            const std::vector<HostEntry> &entries() const { return entries_; }
+            void clear();
+
+        private:
+            uint64_t weightAt(size_t position) const { return entries_[heap_[position]].weight; }
+            void swapHeap(size_t a, size_t b);
+            void siftUp(size_t position);
+            void siftDown(size_t position);
+
+            size_t capacity_;
+            std::vector<HostEntry> entries_;
+            // 键指向entries_中的hostname，entries_预留容量后不再重新分配
+            std::unordered_map<std::string_view, size_t> index_;
+            // heap_为按计数排列的entries_下标，position_[slot]为slot在heap_中的位置
+            std::vector<size_t> heap_;
+            std::vector<size_t> position_;
+        };
+
+        /**
+         * 线程本地计数分片：计数器只由所属线程写入（relaxed读后写，不使用原子读改写指令），
+         * getStats()等读取方按需汇总所有分片。线程退出时交还分片，计数保留并由之后首次记录的线程接管，
+         * 分片数量因此不超过同时记录的线程数
+         */
+        struct Shard {
+            explicit Shard(uint64_t epoch) : epoch(epoch), hosts(HOST_TOP_K) {}
+
+            // 是否有线程持有；交还（release）与接管（acquire）之间传递线程私有部分的可见性
+            std::atomic<bool> owned{true};
+
+            // 分片所属的统计周期，resetStats()后由所属线程在下次记录时清零
+            std::atomic<uint64_t> epoch;
+
+            std::atomic<uint64_t> total_queries{0};
+            std::atomic<uint64_t> successful_queries{0};
+            std::atomic<uint64_t> failed_queries{0};
+            std::atomic<uint64_t> cache_hits{0};
+            std::atomic<uint64_t> cache_misses{0};
+            std::atomic<uint64_t> negative_cache_hits{0};
+            std::atomic<uint64_t> total_retries{0};
+            std::atomic<uint64_t> hedged_queries{0};
+            std::atomic<uint64_t> hedge_wins{0};
+            std::atomic<uint64_t> hedges_suppressed{0};
+            std::atomic<uint64_t> admission_queued{0};
+            std::atomic<uint64_t> admission_expired{0};
+            std::atomic<uint64_t> admission_rejected{0};
+
+            // 查询耗时汇总（in microseconds），平方和用于计算标准差
+            std::atomic<double> duration_sum{0};
+            std::atomic<double> duration_sq_sum{0};
+            std::atomic<int64_t> duration_min{std::numeric_limits<int64_t>::max()};
+            std::atomic<int64_t> duration_max{0};
+
+            // 查询耗时与缓存命中路径耗时分布
+            LatencyHistogram query_time;
+            LatencyHistogram cache_hit_time;
+
+            // 热点主机名：所属线程私有，定期发布快照供读取方使用
+            HeavyHitters hosts;
+            uint32_t records_since_publish{0};
+            std::mutex published_mutex;
+            std::vector<HostEntry> published_hosts;
+        };
+
+        // 分片汇总结果
+        struct Totals {
+            uint64_t total_queries{0};
+            uint64_t successful_queries{0};
+            uint64_t failed_queries{0};
+            uint64_t cache_hits{0};
+            uint64_t cache_misses{0};
+            uint64_t negative_cache_hits{0};
+            uint64_t total_retries{0};
+            uint64_t hedged_queries{0};
+            uint64_t hedge_wins{0};
+            uint64_t hedges_suppressed{0};
+            uint64_t admission_queued{0};
+            uint64_t admission_expired{0};
+            uint64_t admission_rejected{0};
+            double duration_sum{0};
+            double duration_sq_sum{0};
+            int64_t duration_min{std::numeric_limits<int64_t>::max()};
+            int64_t duration_max{0};
+        };
+
         // 内部方法
-        void cleanupOldStats();
-        void updatePerformanceMetrics();
-
-        // 基础计数器
-        std::atomic<uint64_t> total_queries_{0};
-        std::atomic<uint64_t> successful_queries_{0};
-        std::atomic<uint64_t> failed_queries_{0};
-        std::atomic<uint64_t> cache_hits_{0};
-        std::atomic<uint64_t> cache_misses_{0};
-        std::atomic<uint64_t> total_retries_{0};
-
-        // 运行时统计
-        RunningStats query_stats_;
-
-        // 详细统计数据
-        std::map<std::string, HostStats> hostname_stats_;
-        std::map<std::string, ServerStats> server_stats_;
-        std::map<std::string, std::vector<double>> server_latencies_;
+        Shard &localShard();
+        // 接管已退出线程交还的分片，没有时新建
+        std::shared_ptr<Shard> acquireShard();
+        HostStats &touchHost(Shard &shard, const std::string &hostname);
+        void publishHosts(Shard &shard, bool force);
+        Totals aggregate() const;
+        // 合并各分片的耗时分布
+        void collectHistograms(LatencyHistogram::Snapshot &query_time, LatencyHistogram::Snapshot &cache_hit_time) const;
+        std::map<std::string, LatencyHistogram::Snapshot> collectServerLatencies() const;
+        std::map<std::string, HostStats> collectHostStats() const;
+        // 在持有mutex_时按固定间隔刷新性能指标
+        void refreshPerformanceLocked() const;
+
+        // 实例ID：线程本地分片表以此区分不同的BasicMetrics实例（不复用，避免地址重用造成混淆）
+        const uint64_t id_;
+        std::atomic<uint64_t> epoch_{0};
+
+        // 分片注册表，仅在线程首次记录和汇总时加锁；记录线程另持有引用，实例先于线程销毁时分片仍有效
+        std::vector<std::shared_ptr<Shard>> shards_;
+        mutable std::mutex shards_mutex_;
+
+        // 服务器延迟分布：已有服务器只加读锁，直方图本身无锁记录
+        std::map<std::string, std::unique_ptr<LatencyHistogram>, std::less<>> server_latencies_;
+        mutable std::shared_mutex server_mutex_;
+        // 准入队列：等待时间分布与最近一次观测到的队列深度，均无锁记录
+        LatencyHistogram admission_wait_;
+        std::atomic<uint64_t> admission_queue_depth_{0};
+
+        // 服务器延迟告警阈值（in microseconds），记录路径无需加mutex_
+        std::atomic<int64_t> max_latency_us_;
+
+        // 冷路径统计数据（错误、重试历史），由mutex_保护
         std::map<std::string, ErrorStats> error_stats_;
         std::map<std::string, std::vector<uint32_t>> retry_attempts_;
-        std::deque<double> query_durations_;
 
         // 性能指标和配置
         mutable PerformanceMetrics current_performance_;
         AlertThresholds alert_thresholds_;
+        mutable uint64_t last_total_queries_{0};
 
         // 时间戳
-        std::chrono::steady_clock::time_point last_cleanup_;
-        std::chrono::steady_clock::time_point last_performance_update_;
+        mutable std::chrono::steady_clock::time_point last_performance_update_;
 
         // 互斥锁
         mutable std::mutex mutex_;
@@ -99,10 +221,9 @@ namespace leigod::dns {
         std::shared_ptr<ILogger> logger_;
 
         // 配置常量
-        static constexpr size_t MAX_SAMPLES = 1000;
         static constexpr size_t MAX_RETRY_HISTORY = 100;
+        static constexpr size_t MAX_RETRY_HOSTS = 1024;
         static constexpr auto PERFORMANCE_UPDATE_INTERVAL = std::chrono::minutes(1);
-        static constexpr auto CLEANUP_INTERVAL = std::chrono::hours(1);
 
     public:
         // 禁用拷贝和赋值
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "interface/ICache.h"
+
+namespace leigod::dns {
+
+    /**
+     * 缓存快照
+     * 紧凑的二进制文件，保存主机名、二进制地址与绝对过期时间，用于重启后预热缓存。
+     * 写入时先写临时文件再rename替换，读方看到的总是完整的快照；
+     * 读取时mmap整个文件，由loadInto()分批解析，文件页按需换入，打开快照不解析任何条目
+     *
+     * 文件格式（本机字节序，快照只用于同一台机器上的重启）：
+     *   文件头：magic[8]、uint64 条目数
+     *   条目：  int64 过期时间（Unix毫秒）、uint16 主机名长度、uint8 地址数、uint8 保留，
+     *          随后为主机名字节与各个地址（uint8 地址族 + 4或16字节地址）
+     */
+    class CacheSnapshot {
+    public:
+        ~CacheSnapshot();
+
+        CacheSnapshot(const CacheSnapshot &) = delete;
+        CacheSnapshot &operator=(const CacheSnapshot &) = delete;
+
+        // 将缓存中未过期的条目原子地写入path，返回写入的条目数，失败时返回std::nullopt
+        static std::optional<size_t> write(const std::string &path, const ICache &cache);
+
+        // 映射快照文件，文件不存在或文件头无效时返回nullptr
+        static std::unique_ptr<CacheSnapshot> open(const std::string &path);
+
+        // 解析最多max_entries个条目，跳过已过期的条目，不覆盖缓存中已有的较新条目，返回写入缓存的条目数
+        size_t loadInto(ICache &cache, size_t max_entries);
+
+        // 全部条目已解析（或遇到损坏的条目而停止）
+        bool finished() const { return offset_ >= size_; }
+        bool corrupted() const { return corrupted_; }
+        uint64_t entryCount() const { return entry_count_; }
+
+    private:
+        CacheSnapshot(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+        const uint8_t *data_;
+        size_t size_;
+        size_t offset_{0};
+        uint64_t entry_count_{0};
+        bool corrupted_{false};
+    };
+
+}// namespace leigod::dns
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "interface/IDNSQueryStrategy.h"
+#include "interface/IEventLoop.h"
 #include "interface/ILogger.h"
+#include "SlotMap.h"
+#include "TimerQueue.h"
+#include "interface/IMetrics.h"
 #include <ares.h>
+#include <atomic>
 #include <chrono>
-#include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -16,58 +22,168 @@ namespace leigod::dns {
     class CaresQueryStrategy : public IDNSQueryStrategy, public std::enable_shared_from_this<CaresQueryStrategy> {
     public:
         CaresQueryStrategy(DNSResolverConfig config,
-                           std::shared_ptr<ILogger> logger)
-            : config_(std::move(config)), logger_(std::move(logger)) {
+                           std::shared_ptr<ILogger> logger,
+                           std::shared_ptr<IEventLoop> eventLoop = nullptr,
+                           std::shared_ptr<IMetrics> metrics = nullptr)
+            : config_(std::move(config)), logger_(std::move(logger)), eventLoop_(std::move(eventLoop)),
+              metrics_(std::move(metrics)) {
             initialize();
         }
 
-        ~CaresQueryStrategy() override = default;
+        ~CaresQueryStrategy() override;
 
         // 实现 IDNSQueryStrategy 接口
         void query(const std::string &hostname, DNSQueryCallback callback) override;
-        void processEvents() override;
+        void query(const std::string &hostname, int family, DNSQueryCallback callback) override;
+        void processEvents(std::chrono::milliseconds max_wait) override;
+        void processSocket(SocketHandle socket, bool readable, bool writable) override;
+        std::chrono::milliseconds nextTimeout(std::chrono::milliseconds max_wait) override;
+        std::shared_ptr<IEventLoop> eventLoop() const override;
         void shutdown() override;
         bool isInitialized() const override;
+        // 对冲、健康检查与服务器权重即时生效；服务器列表、超时与地址族属于通道选项，需重建解析器
+        void updateConfig(const DNSResolverConfig &config) override;
 
     private:
-        struct QueryMetrics {
+        // EWMA延迟的平滑系数：新样本占比
+        static constexpr double LATENCY_EWMA_ALPHA = 0.2;
+        // 计算p95延迟的滑动窗口样本数
+        static constexpr uint32_t LATENCY_WINDOW_SAMPLES = 256;
+        // 半开状态开始时的分流比例
+        static constexpr double HALF_OPEN_MIN_SHARE = 0.1;
+        // 探测间隔的随机抖动比例，避免多个服务器/实例同步探测
+        static constexpr double PROBE_JITTER = 0.2;
+
+        /**
+         * 断路器状态：
+         * Closed - 正常分流，连续失败超过server_error_threshold次后打开；
+         * Open - 不分配用户查询，只由后台探测查询检查服务器，连续探测成功后进入半开；
+         * HalfOpen - 分流比例随时间从HALF_OPEN_MIN_SHARE恢复到100%，期间任何失败重新打开
+         */
+        enum class CircuitState : uint8_t {
+            kClosed,
+            kOpen,
+            kHalfOpen,
+        };
+
+        /**
+         * 上游服务器：每个服务器独占一个只配置了该服务器的c-ares通道，
+         * 选中某个服务器即把查询提交到它的通道，结果也只可能来自该服务器
+         */
+        struct Upstream {
+            CaresQueryStrategy *owner{nullptr};
+            std::string name;// "地址:端口"（IPv6为"[地址]:端口"）；未配置服务器时为"system"，使用系统解析配置
+            std::atomic<uint32_t> weight{1};
+            ares_channel channel{nullptr};
+
+            // 选择依据：延迟EWMA（in microseconds，0表示尚无样本）与在途查询数
+            std::atomic<double> ewma_latency_us{0.0};
+            std::atomic<uint32_t> outstanding{0};
+
+            // 最近一个完整窗口的p95延迟（in microseconds，0表示尚无完整窗口），用作默认对冲延迟
+            LatencyHistogram latency_window;
+            uint32_t window_samples{0};
+            std::atomic<int64_t> p95_latency_us{0};
+
+            // 断路器：状态可在任意线程读取，状态迁移只在驱动事件循环的线程上进行
+            std::atomic<CircuitState> state{CircuitState::kClosed};
+            std::atomic<TimerQueue::Clock::rep> half_open_since{0};
+            uint32_t consecutive_failures{0};
+            uint32_t probe_successes{0};
+            std::chrono::milliseconds probe_interval{0};
+            // 每次状态迁移递增，使旧状态下调度的定时任务失效
+            uint64_t generation{0};
+        };
+
+        // 探测查询的回调参数，由回调释放
+        struct ProbeRequest {
+            Upstream *upstream;
+            uint64_t generation;
+        };
+
+        /**
+         * 对冲查询的共享状态：首个请求与对冲请求中先返回有效应答的一方完成查询，
+         * 另一方的结果被丢弃（c-ares不支持取消单个查询）。
+         * 首个请求由调用query()的线程发出，对冲请求与结果在驱动事件循环的线程上处理，
+         * callback、timer、pending与finished由mutex保护，其余字段创建后不再修改
+         */
+        struct HedgeState {
+            std::string hostname;
+            int family{AF_UNSPEC};
+            Upstream *primary{nullptr};
             std::chrono::steady_clock::time_point start_time;
-            uint32_t retry_count{0};
-            std::chrono::milliseconds total_time{0};
+            std::mutex mutex;
+            DNSQueryCallback callback;
+            TimerQueue::TimerId timer{0};
+            uint32_t pending{0};
+            bool finished{false};
+        };
+
+        struct CaresQueryContext;
+        using ContextMap = SlotMap<CaresQueryContext>;
+
+        // 查询上下文：记录实际发送查询的上游服务器，用于结果归属；上游的owner即所属策略，不持有策略的引用
+        struct CaresQueryContext : QueryContext {
+            ContextMap::Key key;
+            Upstream *upstream{nullptr};
+            std::shared_ptr<HedgeState> hedge;// 未启用对冲时为空
+            bool is_hedge{false};
         };
 
         void initialize();
-        void handleResult(QueryContext *context, int status, ares_addrinfo *result);
-        void cleanupCompletedContexts();
-        std::string selectServer();
-        bool verifyServerHealth(const std::string &server);
-        void updateServerMetrics(const std::string &server,
-                                 const std::chrono::milliseconds &latency);
-
-        // 配置和状态
+        void applyConfig(const DNSResolverConfig &config);
+        bool initializeUpstream(Upstream &upstream, const DNSServerConfig *server);
+        // 销毁已创建的通道并释放c-ares库，与initialized_无关：初始化中途失败与shutdown()共用
+        void releaseChannels();
+        static void onSocketStateChange(void *data, ares_socket_t socket, int readable, int writable);
+        // 套接字所属的上游通道，未知的套接字返回nullptr
+        Upstream *socketOwner(SocketHandle socket) const;
+        void sendQuery(Upstream &upstream, const std::string &hostname, int family, DNSQueryCallback callback,
+                       std::shared_ptr<HedgeState> hedge, bool is_hedge);
+        void handleResult(CaresQueryContext *context, int status, ares_addrinfo *result);
+        void completeHedged(CaresQueryContext &context, ResolveResult result);
+        void processTimeouts();
+        Upstream *selectServer(const Upstream *exclude = nullptr);
+        double effectiveWeight(const Upstream &upstream, TimerQueue::Clock::time_point now) const;
+
+        // 对冲请求
+        std::optional<std::chrono::milliseconds> hedgeDelay(const std::string &hostname, const Upstream &primary);
+        void sendHedge(const std::shared_ptr<HedgeState> &hedge);
+        void updateServerMetrics(Upstream &upstream, std::chrono::microseconds latency);
+
+        // 断路器与后台健康探测
+        void recordServerFailure(Upstream &upstream);
+        void openCircuit(Upstream &upstream);
+        void halfOpenCircuit(Upstream &upstream);
+        void closeCircuit(Upstream &upstream);
+        void scheduleProbe(Upstream &upstream);
+        void sendProbe(Upstream &upstream, uint64_t generation);
+        void handleProbeResult(Upstream &upstream, uint64_t generation, ares_status_t status);
+
+        // 配置和状态：config_的健康检查字段只在驱动事件循环的线程上读写，
+        // 查询路径上读取的对冲配置与半开时长另存为原子快照（hedging_经std::atomic_load/atomic_store访问）
         DNSResolverConfig config_;
+        std::shared_ptr<const HedgingConfig> hedging_;
+        std::atomic<uint32_t> half_open_duration_ms_{0};
         std::shared_ptr<ILogger> logger_;
-        ares_channel channel_{nullptr};
+        std::shared_ptr<IEventLoop> eventLoop_;
+        std::shared_ptr<IMetrics> metrics_;
         std::atomic<bool> initialized_{false};
 
-        // 查询上下文管理
-        std::vector<std::shared_ptr<QueryContext>> active_contexts_;
-        std::mutex contexts_mutex_;
+        // 上游服务器及其通道，初始化后不再增删
+        std::vector<std::unique_ptr<Upstream>> upstreams_;
+        // 套接字所属的上游通道：非托管模式下由调用resolve()的线程在ares_getaddrinfo()中写入，
+        // 同时被驱动事件循环的线程读取，需加锁访问
+        std::unordered_map<SocketHandle, Upstream *> socket_owners_;
+        mutable std::mutex socket_owners_mutex_;
+        // 健康探测、断路器与对冲请求的定时任务，由processEvents()执行
+        TimerQueue timers_;
+        // 对冲预算令牌桶：每个需对冲的查询补充budget_ratio个令牌，每个对冲请求消耗一个
+        std::atomic<double> hedge_tokens_{0.0};
 
-        // 服务器健康检查
-        struct ServerHealth {
-            bool healthy{true};
-            std::chrono::steady_clock::time_point last_check;
-            std::chrono::milliseconds avg_latency{0};
-            uint32_t error_count{0};
-        };
-        std::map<std::string, ServerHealth> server_health_;
-        std::mutex health_mutex_;
-
-        // 性能指标
-        std::map<std::string, std::queue<std::chrono::milliseconds>> latency_history_;
-        static constexpr size_t MAX_LATENCY_SAMPLES = 100;
-        std::mutex metrics_mutex_;
+        // 查询上下文：槽位复用且地址稳定，c-ares回调参数直接指向上下文，完成时O(1)归还
+        ContextMap contexts_;
+        std::mutex contexts_mutex_;
     };
 
 }// namespace leigod::dns
\ No newline at end of file
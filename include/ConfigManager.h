@@ -3,8 +3,10 @@
 #include "interface/IConfigManager.h"
 #include "interface/ILogger.h"
 
+#include <atomic>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -13,12 +15,15 @@ namespace leigod::dns {
     class ConfigManager : public IConfigManager {
     public:
         ConfigManager(std::shared_ptr<ILogger> logger)
-            : logger_(logger), stopHotReload_(false) {}
+            : logger_(logger), config_(std::make_shared<const DNSResolverConfig>()), stopHotReload_(false) {}
 
         ~ConfigManager() override;
 
         DNSResolverConfig getConfig() const override;
 
+        // 一次原子加载，不加锁也不复制配置
+        std::shared_ptr<const DNSResolverConfig> getConfigSnapshot() const override;
+
         void updateConfig(const DNSResolverConfig &config) override;
 
         void registerConfigChangeHandler(
@@ -39,8 +44,10 @@ namespace leigod::dns {
         void notifyConfigChange() const;
 
         std::shared_ptr<ILogger> logger_;
+        // 写方（updateConfig()、文件加载）之间互斥，读方只原子地加载当前快照；
+        // config_只经std::atomic_load/atomic_store访问
         mutable std::mutex mutex_;
-        DNSResolverConfig config_;
+        std::shared_ptr<const DNSResolverConfig> config_;
         std::function<void(const DNSResolverConfig &)> changeHandler_;
 
         // 热重载相关
@@ -1,23 +1,92 @@
 #pragma once
 
 #include "ConfigManager.h"
+#include "MpscQueue.h"
 #include "PluginManager.h"
+#include "QueryTracer.h"
+#include "TimerQueue.h"
 #include "interface/ICache.h"
 #include "interface/IDNSQueryStrategy.h"
+#include "interface/IEventLoop.h"
 #include "interface/IEventPublisher.h"
 #include "interface/ILogger.h"
 #include "interface/IMetrics.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace leigod::dns {
 
+    class CacheSnapshot;
+
     class DNSResolver : public std::enable_shared_from_this<DNSResolver> {
+        // Happy Eyeballs模式下一次解析的共享状态
+        struct DualStackState;
+        // 标记当前线程正在查询策略内分发事件，期间调用的shutdown()推迟到分发返回之后
+        class DispatchScope;
+
     public:
-        using ResolveCallback = std::function<void(ResolveResult)>;
+        using ResolveCallback = std::function<void(const ResolveResult &)>;
+        // 批量解析完成回调：结果与输入主机名按下标一一对应
+        using BatchCallback = std::function<void(std::vector<ResolveResult>)>;
+        // 完成回调执行器：接收一个任务并在调用方选择的线程上执行
+        using CompletionExecutor = std::function<void(std::function<void()>)>;
+
+        // 准入优先级：上游查询达到并发上限后按优先级出队，同一优先级先进先出；后台刷新使用kLow
+        enum class QueryPriority : uint8_t {
+            kHigh,
+            kNormal,
+            kLow,
+        };
+
+        /**
+         * resolveAsync()返回的awaiter：缓存命中等可立即完成的情况不挂起；否则挂接到进行中查询表，
+         * 由查询完成路径直接恢复协程（设置了完成回调执行器时在执行器上恢复）。
+         * stop_token被请求停止时以ARES_ECANCELLED恢复，上游查询继续进行并写入缓存。
+         * Happy Eyeballs模式下等待两个地址族的合并结果，不交付部分结果
+         */
+        class ResolveAwaiter {
+        public:
+            ResolveAwaiter(const ResolveAwaiter &) = delete;
+            ResolveAwaiter &operator=(const ResolveAwaiter &) = delete;
+
+            bool await_ready();
+            bool await_suspend(std::coroutine_handle<> handle);
+            ResolveResult await_resume();
+
+        private:
+            friend class DNSResolver;
+
+            struct CancelCallback {
+                ResolveAwaiter *awaiter;
+                void operator()() const noexcept;
+            };
+
+            ResolveAwaiter(DNSResolver &resolver, std::string hostname, std::stop_token stop)
+                : resolver_(resolver), hostname_(std::move(hostname)), stop_(std::move(stop)) {}
+
+            DNSResolver &resolver_;
+            std::string hostname_;
+            std::stop_token stop_;
+            std::optional<std::stop_callback<CancelCallback>> stop_callback_;
+            std::coroutine_handle<> handle_;
+            ResolveResult result_;
+            // Happy Eyeballs模式下的解析状态，结果由其中的result交付
+            std::shared_ptr<DualStackState> dual_;
+        };
 
         DNSResolver(std::shared_ptr<ILogger> logger,
                     std::shared_ptr<ConfigManager> configManager,
@@ -36,10 +105,43 @@ namespace leigod::dns {
         bool initialize();
         void shutdown();
 
-        // DNS 解析
-        void resolve(const std::string &hostname, const ResolveCallback &callback);
+        /**
+         * DNS 解析。启用happy_eyeballs时A与AAAA分别查询：先到达的地址族先以partial=true回调一次
+         * （A先到达时最多再等待resolution_delay_ms），两个地址族都完成后再以合并结果回调一次。
+         * 上游查询达到max_concurrent_queries时按priority进入准入队列，排队超时以ARES_ETIMEOUT失败，
+         * 队列已满时以ARES_EOF失败
+         */
+        void resolve(const std::string &hostname, const ResolveCallback &callback,
+                     QueryPriority priority = QueryPriority::kNormal);
+        /**
+         * 批量解析：一次遍历验证主机名，按缓存分片批量查询缓存，未命中的主机名一次性提交到各查询通道。
+         * 全部完成后调用一次callback；on_result不为空时每个结果就绪即回调一次（可能在不同线程上）
+         */
+        void resolveMany(std::span<const std::string> hostnames, BatchCallback callback,
+                         ResolveCallback on_result = {}, QueryPriority priority = QueryPriority::kNormal);
+        // 协程接口：ResolveResult result = co_await resolver->resolveAsync(hostname);
+        ResolveAwaiter resolveAsync(std::string hostname, std::stop_token stop = {});
+        // 供非协程调用方使用的future适配，只交付最终结果
+        std::future<ResolveResult> resolveFuture(const std::string &hostname);
         void processEvents();
 
+        // 接入外部事件循环：须在initialize()之前设置，未设置时使用平台默认实现
+        void setEventLoop(std::shared_ptr<IEventLoop> eventLoop);
+        // 由外部reactor在套接字就绪时调用
+        void processSocket(SocketHandle socket, bool readable, bool writable);
+        // 距离下一次需要调用processEvents()的时间
+        std::chrono::milliseconds nextTimeout() const;
+
+        // 设置上游查询完成回调的执行器：须在initialize()之前设置，未设置时在事件循环线程上直接回调
+        void setCompletionExecutor(CompletionExecutor executor);
+
+        // 每个查询通道已提交但尚未完成的上游查询数
+        std::vector<size_t> getChannelQueueDepths() const;
+        // 所有通道在途的上游查询数（包括退避等待重试的查询），不超过max_concurrent_queries
+        size_t getInFlightQueries() const;
+        // 在准入队列中等待的查询数
+        size_t getAdmissionQueueDepth() const;
+
         // 配置管理
         void updateConfig(const DNSResolverConfig &config);
         DNSResolverConfig getConfig() const;
@@ -49,14 +151,133 @@ namespace leigod::dns {
         std::shared_ptr<IMetrics> getMetrics() const;
         std::shared_ptr<ILogger> getLogger() const;
         std::shared_ptr<IEventPublisher> getEventPublisher() const;
+        // 查询跟踪：initialize()后可用，采样率随tracing配置热更新，未启用时不采样
+        std::shared_ptr<QueryTracer> getTracer() const;
 
     private:
+        // 被采样查询的跟踪记录，未采样时为空
+        using TracePtr = std::shared_ptr<QueryTracer::Span>;
+
+        // 进行中查询的键：主机名 + 地址族
+        struct PendingKey {
+            std::string hostname;
+            int family{};
+            bool operator==(const PendingKey &) const = default;
+        };
+
+        struct PendingKeyHash {
+            size_t operator()(const PendingKey &key) const {
+                return std::hash<std::string>{}(key.hostname) ^ (static_cast<size_t>(key.family) << 1);
+            }
+        };
+
+        // 进行中的查询：同一主机名的后续调用者挂在waiters（回调）或awaiters（协程）上，应答到达时一次性完成
+        struct PendingQuery {
+            std::vector<ResolveCallback> waiters;
+            std::vector<ResolveAwaiter *> awaiters;
+        };
+
+        // 等待通道I/O线程发起的查询
+        struct Submission {
+            PendingKey key;
+            TracePtr trace;
+        };
+
+        // 查询通道：独占一个查询策略（c-ares通道）及其事件循环，托管模式下由专属I/O线程驱动
+        struct IoWorker {
+            size_t index{0};
+            std::shared_ptr<IDNSQueryStrategy> strategy;
+            std::shared_ptr<IEventLoop> eventLoop;
+            // 重试定时器：退避期间不占用事件循环线程
+            TimerQueue retryTimers;
+            MpscQueue<Submission> submissions;
+            std::thread thread;
+            std::atomic<size_t> depth{0};
+        };
+
+        // 准入队列中的查询：deadline到期前未获得并发槽位即失败
+        struct AdmissionEntry {
+            PendingKey key;
+            std::chrono::steady_clock::time_point enqueued;
+            std::chrono::steady_clock::time_point deadline;
+            TracePtr trace;
+        };
+
+        static constexpr size_t PRIORITY_COUNT = 3;
+
         // 内部方法
-        void handleQueryResult(int retry_count, ResolveResult result, const ResolveCallback &callback);
+        // 处理无需上游查询即可完成的情况（未初始化、非法主机名、缓存命中），完成时返回true；
+        // 返回false时result.hostname为规范化的主机名
+        bool resolveLocally(const std::string &raw_hostname, ResolveResult &result, QueryTracer::Span *trace = nullptr);
+        // progressive为false时Happy Eyeballs模式下只回调最终结果
+        void resolveWith(const std::string &hostname, const ResolveCallback &callback, bool progressive,
+                         QueryPriority priority = QueryPriority::kNormal);
+        // 以缓存条目（地址或否定应答）填充result，并记录统计与发布完成事件；family用于后台刷新
+        void completeFromCache(const std::string &hostname, int family, const CacheLookup &lookup, AddressList ips,
+                               std::chrono::steady_clock::time_point start_time, ResolveResult &result);
+        // 只填充result，不记录统计与事件（Happy Eyeballs模式下由合并结果统一记录）
+        void fillFromCache(const std::string &hostname, int family, const CacheLookup &lookup, AddressList ips,
+                           std::chrono::steady_clock::time_point start_time, ResolveResult &result);
+        // 按最终结果记录缓存命中统计（来自缓存时）并发布完成事件
+        void recordCompletion(const ResolveResult &result);
+        // Happy Eyeballs：两个地址族分别查询缓存、挂接进行中查询，结果汇总到state
+        std::shared_ptr<DualStackState> makeDualStack(std::string hostname, ResolveCallback callback, bool progressive,
+                                                      QueryPriority priority = QueryPriority::kNormal);
+        void resolveDualStack(const std::shared_ptr<DualStackState> &state);
+        void completeFamily(const std::shared_ptr<DualStackState> &state, int family, const ResolveResult &result);
+        void deliverDelayedPartial(const std::shared_ptr<DualStackState> &state);
+        void cancelDualStack(DualStackState &state);
+        static void deliverPartial(DualStackState &state, const ResolveResult &result);
+        static void deliverDualStack(DualStackState &state, const ResolveResult &result);
+        static ResolveResult mergeFamilies(const DualStackState &state);
+        // 缓存键：分地址族缓存时带地址族后缀
+        std::string cacheKey(const PendingKey &key) const;
+        void cancelAwaiter(ResolveAwaiter &awaiter);
+        IoWorker &workerFor(const PendingKey &key);
+        void startQuery(IoWorker &worker, const PendingKey &key, int retry_count, const TracePtr &trace);
+        void handleQueryResult(IoWorker &worker, const PendingKey &key, int retry_count, ResolveResult result,
+                               const TracePtr &trace);
+        void completePendingQuery(const PendingKey &key, const ResolveResult &result);
+        void failPendingQueries(int status);
+        // 提交新建的进行中查询：有空闲并发槽位且准入队列为空时直接发出，否则排队。
+        // 批量提交的查询不跟踪，trace只随单个查询传递
+        void submitQuery(const PendingKey &key, QueryPriority priority = QueryPriority::kNormal,
+                         const TracePtr &trace = nullptr);
+        void submitQueries(std::span<const PendingKey> keys, QueryPriority priority = QueryPriority::kNormal,
+                           const TracePtr &trace = nullptr);
+        // 把已获得并发槽位的查询交给所属通道
+        void dispatchQuery(const PendingKey &key, const TracePtr &trace = nullptr);
+        void dispatchQueries(std::span<const PendingKey> keys, const TracePtr &trace = nullptr);
+        // 获取至多count个并发槽位，返回获得的数量
+        size_t acquireSlots(size_t count);
+        // 上游查询结束时归还槽位，并让排队的查询补上
+        void releaseSlot();
+        void enqueueAdmissions(std::span<const PendingKey> keys, QueryPriority priority, const TracePtr &trace);
+        // 丢弃已超时的排队查询，并按优先级发出能获得槽位的查询
+        void drainAdmissionQueue();
+        void failAdmission(const PendingKey &key, int status);
+        void refreshInBackground(const std::string &hostname, int family);
+        void pumpEvents(IoWorker &worker);
+        // 事件循环的最长等待时间：不超过最近一个重试或排队查询的到期时间
+        std::chrono::milliseconds maxEventWait(const IoWorker &worker) const;
+        // I/O线程只持有weak_ptr，每一轮循环临时加锁，解析器可以在任意线程上析构
+        static void runIoLoop(const std::weak_ptr<DNSResolver> &weak, IoWorker &worker);
+        void runIoIteration(IoWorker &worker);
+        void stopIoThreads();
+        // shutdown()中停止I/O线程之后的部分：关闭查询策略、取消等待者并保存缓存
+        void finishShutdown();
         void handleConfigChange(const DNSResolverConfig &config);
+        // 发布新的配置快照并重新绑定缓存的热路径字段
+        void bindConfig(std::shared_ptr<const DNSResolverConfig> config);
+        // 缓存持久化
+        void startCachePersistence(const CacheConfig &config);
+        void stopCachePersistence();
+        void runSnapshotLoop(std::unique_ptr<CacheSnapshot> snapshot, std::chrono::milliseconds interval);
+        void saveCacheSnapshot();
         void notifyAddressChange(const std::string &hostname,
-                                 const std::vector<std::string> &old_addresses,
-                                 const std::vector<std::string> &new_addresses);
+                                 const AddressList &old_addresses,
+                                 const AddressList &new_addresses,
+                                 int64_t ttl);
 
         // 核心组件
         std::shared_ptr<ILogger> logger_;
@@ -64,16 +285,57 @@ namespace leigod::dns {
         std::shared_ptr<IMetrics> metrics_;
         std::shared_ptr<IEventPublisher> eventPublisher_;
         std::shared_ptr<PluginManager> pluginManager_;
+        std::shared_ptr<IEventLoop> eventLoop_;
+        std::shared_ptr<QueryTracer> tracer_;
 
-        // 活动策略和缓存
-        std::shared_ptr<IDNSQueryStrategy> activeQueryStrategy_;
+        // 查询通道和缓存：同一主机名总是路由到同一通道
+        std::vector<std::unique_ptr<IoWorker>> workers_;
         std::shared_ptr<ICache> activeCache_;
 
-        // 活动查询上下文管理
-        std::vector<std::shared_ptr<QueryContext>> active_contexts_;
-        mutable std::mutex contexts_mutex_;
+        // 进行中查询表（single-flight）
+        std::unordered_map<PendingKey, PendingQuery, PendingKeyHash> pending_queries_;
+        std::mutex pending_mutex_;
+        int queryFamily_{0};
+        // Happy Eyeballs：A与AAAA作为独立的进行中查询并分别缓存，initialize()时确定
+        bool dualStack_{false};
+
+        // 托管模式：I/O线程独占各自的查询通道，resolve()经无锁队列提交查询
+        bool managed_{false};
+        bool pinIoThreads_{false};
+        std::atomic<bool> stopIo_{false};
+        CompletionExecutor completionExecutor_;
+
         mutable std::mutex mutex_;
 
+        /**
+         * 并发控制：inFlight_为占用槽位的上游查询数，超过上限的查询按优先级在准入队列中等待。
+         * 归还槽位的一方先递减inFlight_再检查admissionDepth_，入队的一方先递增admissionDepth_再尝试获取槽位，
+         * 两者都是顺序一致的原子操作，排队的查询不会错过空出的槽位
+         */
+        std::atomic<size_t> inFlight_{0};
+        std::atomic<size_t> admissionDepth_{0};
+        std::array<std::deque<AdmissionEntry>, PRIORITY_COUNT> admissionQueues_;
+        mutable std::mutex admission_mutex_;
+
+        /**
+         * 当前生效的配置快照：通过校验后由initialize()与handleConfigChange()整体替换，
+         * 读方一次std::atomic_load即可，不复制配置也不加锁。查询路径上逐次读取的字段另外缓存为原子变量
+         */
+        std::shared_ptr<const DNSResolverConfig> config_;
+        std::atomic<size_t> maxConcurrentQueries_{0};
+        std::atomic<size_t> maxAdmissionQueue_{0};
+        std::atomic<uint32_t> admissionTimeoutMs_{0};
+        // 每次processEvents()回收的过期缓存条目上限
+        std::atomic<size_t> cacheCleanupBatch_{0};
+
+        // 缓存持久化：后台线程先从快照预热，再周期性写回
+        std::string snapshotPath_;
+        std::thread snapshotThread_;
+        std::mutex snapshotMutex_;
+        std::condition_variable snapshotCv_;
+        bool stopSnapshot_{false};
+        std::atomic<bool> snapshotLoaded_{false};
+
         // 状态标志
         std::atomic<bool> initialized_{false};
     };
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "interface/IEventLoop.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace leigod::dns {
+
+#if defined(__linux__)
+    /**
+     * 基于epoll的事件循环（Linux）
+     */
+    class EpollEventLoop : public IEventLoop {
+    public:
+        EpollEventLoop();
+        ~EpollEventLoop() override;
+
+        void updateSocket(SocketHandle socket, bool readable, bool writable) override;
+        int wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) override;
+        size_t socketCount() const override;
+        void wakeup() override;
+
+    private:
+        static constexpr int MAX_EVENTS = 64;
+
+        int epoll_fd_{-1};
+        int wake_fd_{-1};// eventfd
+        mutable std::mutex mutex_;
+        std::unordered_map<SocketHandle, uint32_t> interests_;
+    };
+#endif
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    /**
+     * 基于kqueue的事件循环（BSD/macOS）
+     */
+    class KqueueEventLoop : public IEventLoop {
+    public:
+        KqueueEventLoop();
+        ~KqueueEventLoop() override;
+
+        void updateSocket(SocketHandle socket, bool readable, bool writable) override;
+        int wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) override;
+        size_t socketCount() const override;
+        void wakeup() override;
+
+    private:
+        static constexpr int MAX_EVENTS = 64;
+
+        struct Interest {
+            bool readable{false};
+            bool writable{false};
+        };
+
+        int kqueue_fd_{-1};
+        int wake_pipe_[2]{-1, -1};
+        mutable std::mutex mutex_;
+        std::unordered_map<SocketHandle, Interest> interests_;
+    };
+#endif
+
+    /**
+     * 基于poll()/WSAPoll()的通用事件循环，不受FD_SETSIZE限制
+     */
+    class PollEventLoop : public IEventLoop {
+    public:
+        PollEventLoop();
+        ~PollEventLoop() override;
+
+        void updateSocket(SocketHandle socket, bool readable, bool writable) override;
+        int wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) override;
+        size_t socketCount() const override;
+        void wakeup() override;
+
+    private:
+        struct Interest {
+            bool readable{false};
+            bool writable{false};
+        };
+
+        mutable std::mutex mutex_;
+        std::unordered_map<SocketHandle, Interest> interests_;
+        // 唤醒通道：POSIX上为管道，Windows上为连接到自身的回环UDP套接字
+        SocketHandle wake_read_;
+        SocketHandle wake_write_;
+    };
+
+    // 创建当前平台的默认事件循环：Linux使用epoll，BSD/macOS使用kqueue，Windows及其他平台使用WSAPoll/poll
+    std::shared_ptr<IEventLoop> createDefaultEventLoop();
+
+}// namespace leigod::dns
@@ -1,25 +1,57 @@
 #pragma once
 
+#include "MpmcRing.h"
 #include "interface/IEventPublisher.h"
+#include <atomic>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
 
 namespace leigod::dns {
 
+    /**
+     * 事件发布器
+     * 订阅列表写时复制，发布时只原子地读取当前列表，不获取锁。
+     * 默认同步模式在发布线程上直接调用订阅者；异步模式下事件写入有界无锁环形队列，
+     * 由分发线程批量投递，订阅者的耗时不会计入解析路径
+     */
     class EventPublisher : public IEventPublisher {
     public:
         using AddressChangeHandler = std::function<void(const DNSAddressEvent &)>;
         using QueryStartHandler = std::function<void(const std::string &)>;
         using QueryCompleteHandler = std::function<void(const std::string &,
-                                                        const std::vector<std::string> &,
+                                                        const AddressList &,
                                                         bool)>;
 
+        // 异步模式下队列已满时的处理方式
+        enum class OverflowPolicy : uint8_t {
+            kDropOldest,           // 丢弃队列中最旧的事件，为新事件腾出位置
+            kCoalesceAddressChanges,// 丢弃新的查询事件；地址变化事件按主机名合并，稍后投递
+        };
+
+        struct AsyncOptions {
+            size_t capacity = 4096;  // 环形队列容量，向上取整为2的幂
+            size_t batch_size = 256; // 分发线程每批投递的事件数
+            OverflowPolicy overflow = OverflowPolicy::kDropOldest;
+        };
+
+        EventPublisher();
+        explicit EventPublisher(AsyncOptions options);
+        ~EventPublisher() override;
+
+        EventPublisher(const EventPublisher &) = delete;
+        EventPublisher &operator=(const EventPublisher &) = delete;
+
         void publishAddressChanged(const DNSAddressEvent &event) override;
 
         void publishQueryStarted(const std::string &hostname) override;
 
         void publishQueryCompleted(const std::string &hostname,
-                                   const std::vector<std::string> &ips,
+                                   const AddressList &ips,
                                    bool success) override;
 
         void subscribeAddressChange(AddressChangeHandler handler);
@@ -30,11 +62,57 @@ namespace leigod::dns {
 
         void unsubscribeAll();
 
+        // 投递异步模式下所有已入队的事件后返回，同步模式下立即返回
+        void flush();
+
+        // 因队列已满而丢弃的事件数（合并的地址变化事件不计入）
+        uint64_t droppedEvents() const { return dropped_.load(std::memory_order_relaxed); }
+
     private:
-        mutable std::mutex mutex_;
-        std::vector<AddressChangeHandler> addressChangeHandlers_;
-        std::vector<QueryStartHandler> queryStartHandlers_;
-        std::vector<QueryCompleteHandler> queryCompleteHandlers_;
+        struct Handlers {
+            std::vector<AddressChangeHandler> addressChange;
+            std::vector<QueryStartHandler> queryStart;
+            std::vector<QueryCompleteHandler> queryComplete;
+        };
+
+        struct QueryStartedEvent {
+            std::string hostname;
+        };
+
+        struct QueryCompletedEvent {
+            std::string hostname;
+            AddressList ips;
+            bool success{false};
+        };
+
+        using Event = std::variant<std::monostate, QueryStartedEvent, QueryCompletedEvent, DNSAddressEvent>;
+
+        void updateHandlers(const std::function<void(Handlers &)> &update);
+        void dispatch(const Handlers &handlers, const Event &event) const;
+        void enqueue(Event event);
+        void runDispatcher();
+        size_t drainCoalesced(const Handlers &handlers);
+        static void mergeAddressChange(DNSAddressEvent &pending, const DNSAddressEvent &change);
+
+        // 当前订阅列表：发布方只读取快照，订阅方在writers_mutex_下复制并替换。
+        // 经std::atomic_load/atomic_store访问（libc++未提供std::atomic<std::shared_ptr>）
+        std::shared_ptr<const Handlers> handlers_;
+        std::mutex writers_mutex_;
+
+        // 异步模式
+        AsyncOptions options_;
+        std::unique_ptr<MpmcRing<Event>> ring_;
+        std::atomic<uint64_t> dropped_{0};
+        // 已接受与已处理（投递或被丢弃）的事件数：分发线程等待前者，flush()等待后者追上前者
+        std::atomic<uint64_t> enqueued_{0};
+        std::atomic<uint64_t> retired_{0};
+        std::atomic<bool> stop_{false};
+        std::thread dispatcher_;
+
+        // 队列满时合并的地址变化事件，仅在溢出路径上加锁
+        std::mutex coalesced_mutex_;
+        std::map<std::string, DNSAddressEvent, std::less<>> coalesced_;
+        std::atomic<bool> has_coalesced_{false};
     };
 
 }// namespace leigod::dns
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 4位计数的Count-Min Sketch，估计键的近期访问频率（上限15）
+     * 每个64位字保存16个计数器，每个键按4个独立哈希各选一个计数器，估计值取其中最小者；
+     * 累计increment()次数达到容量的SAMPLE_FACTOR倍时所有计数减半（老化），使频率反映近期的访问。
+     * 非线程安全，由调用方加锁
+     */
+    class FrequencySketch {
+    public:
+        static constexpr uint32_t MAX_FREQUENCY = 15;
+        // 每个计数周期的累计次数相对容量的倍数
+        static constexpr size_t SAMPLE_FACTOR = 10;
+
+        explicit FrequencySketch(size_t capacity) {
+            resize(capacity);
+        }
+
+        // 按新容量重建，已有计数清零
+        void resize(size_t capacity) {
+            const size_t words = std::bit_ceil(std::max<size_t>(capacity, 16) / 4);
+            table_.assign(words, 0);
+            mask_ = words - 1;
+            sample_size_ = std::max<size_t>(capacity, 1) * SAMPLE_FACTOR;
+            additions_ = 0;
+        }
+
+        uint32_t frequency(size_t hash) const {
+            uint32_t frequency = MAX_FREQUENCY;
+            for (uint32_t i = 0; i < HASH_COUNT; ++i) {
+                const auto [word, shift] = locate(hash, i);
+                frequency = std::min(frequency, static_cast<uint32_t>((table_[word] >> shift) & 0xF));
+            }
+            return frequency;
+        }
+
+        void increment(size_t hash) {
+            bool added = false;
+            for (uint32_t i = 0; i < HASH_COUNT; ++i) {
+                const auto [word, shift] = locate(hash, i);
+                if (((table_[word] >> shift) & 0xF) != MAX_FREQUENCY) {
+                    table_[word] += uint64_t{1} << shift;
+                    added = true;
+                }
+            }
+            if (added && ++additions_ >= sample_size_) {
+                age();
+            }
+        }
+
+        void clear() {
+            std::fill(table_.begin(), table_.end(), 0);
+            additions_ = 0;
+        }
+
+    private:
+        static constexpr uint32_t HASH_COUNT = 4;
+        static constexpr std::array<uint64_t, HASH_COUNT> SEEDS{0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+                                                                0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+        struct Location {
+            size_t word;
+            uint32_t shift;
+        };
+
+        // 每个哈希函数独立选择字与字内的计数器
+        Location locate(size_t hash, uint32_t i) const {
+            uint64_t h = (static_cast<uint64_t>(hash) + SEEDS[i]) * SEEDS[i];
+            h ^= h >> 29;
+            return {static_cast<size_t>(h) & mask_, static_cast<uint32_t>(h >> 60) * 4};
+        }
+
+        // 所有计数减半：每个字内的16个计数同时右移一位，并清除从相邻计数移入的位
+        void age() {
+            for (auto &word: table_) {
+                word = (word >> 1) & 0x7777777777777777ULL;
+            }
+            additions_ /= 2;
+        }
+
+        std::vector<uint64_t> table_;
+        size_t mask_{0};
+        size_t sample_size_{0};
+        size_t additions_{0};
+    };
+
+}// namespace leigod::dns
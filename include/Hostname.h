@@ -0,0 +1,22 @@
+#pragma once
+
+#include "interface/HostnameKey.h"
+#include <string>
+#include <string_view>
+
+namespace leigod::dns {
+
+    // 主机名总长度与单个标签长度上限（RFC 1035）
+    constexpr size_t MAX_HOSTNAME_LENGTH = 253;
+    constexpr size_t MAX_LABEL_LENGTH = 63;
+
+    // 校验主机名：标签由字母、数字和'-'组成，且不以'-'开头或结尾；允许一个表示FQDN的结尾'.'
+    bool isValidHostname(std::string_view hostname);
+
+    /**
+     * 校验并规范化主机名，单次遍历完成校验、转小写与去掉结尾'.'，随后计算哈希。
+     * 不合法时返回false，key的内容未定义；key可在多次调用间复用以避免重新分配
+     */
+    bool canonicalizeHostname(std::string_view hostname, HostnameKey &key);
+
+}// namespace leigod::dns
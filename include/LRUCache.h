@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <list>
+#include <map>
 #include <mutex>
 #include <unordered_map>
 
@@ -11,12 +13,29 @@ namespace leigod::dns {
 
     class LRUCache : public ICache {
     public:
-        LRUCache(size_t max_size, int64_t ttl)
-            : max_size_(max_size), ttl_(ttl), hits_(0), misses_(0) {}
+        LRUCache(size_t max_size, int64_t ttl, RefreshPolicy policy = {})
+            : max_size_(max_size), ttl_(ttl), policy_(policy), hits_(0), misses_(0) {}
 
-        bool get(const std::string &hostname, std::vector<std::string> &ips) override;
+        bool get(const std::string &hostname, AddressList &ips) override;
 
-        void update(const std::string &hostname, const std::vector<std::string> &ips) override;
+        CacheLookup lookup(const HostnameKey &key, AddressList &ips) override;
+
+        void lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                        std::span<CacheLookup> results) override;
+
+        // 只查询indices指定的下标，整批只加锁一次（供分片缓存按分片分组后调用）
+        void lookupSelected(std::span<const HostnameKey> keys, std::span<const size_t> indices,
+                            std::span<AddressList> ips, std::span<CacheLookup> results);
+
+        void update(const std::string &hostname, const AddressList &ips,
+                    std::chrono::milliseconds ttl) override;
+
+        bool exchange(const std::string &hostname, const AddressList &ips,
+                      std::chrono::milliseconds ttl, AddressList &old_ips) override;
+
+        void updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) override;
+
+        bool insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) override;
 
         void remove(const std::string &hostname) override;
 
@@ -26,27 +45,73 @@ namespace leigod::dns {
 
         double hit_rate() const override;
 
+        size_t purgeExpired(size_t max_entries) override;
+
+        void forEach(const EntryVisitor &visitor) const override;
+
+        void updateConfig(const CacheConfig &config) override;
+
+        // 替换容量、默认TTL与刷新策略；容量缩小时立即淘汰多出的条目
+        void reconfigure(size_t max_size, std::chrono::milliseconds ttl, RefreshPolicy policy);
+
+        // 原始计数器，供分片缓存汇总
+        size_t hits() const { return hits_.load(std::memory_order_relaxed); }
+        size_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
     private:
+        // 过期索引：按移除时间（expire_time加serve-stale窗口）排序，值指向cache_中的键（unordered_map节点的键地址稳定）
+        using ExpiryIndex = std::multimap<std::chrono::system_clock::time_point, const std::string *>;
+
         struct CacheEntry {
-            std::vector<std::string> ips;
+            AddressList ips;
             std::chrono::system_clock::time_point expire_time;
+            std::chrono::system_clock::time_point next_refresh;// 此后的访问（热点条目）提示后台刷新
+            uint32_t hits{0};                                  // 当前TTL周期内的访问次数
+            CacheEntryKind kind{CacheEntryKind::kAddresses};
             std::list<std::string>::iterator lru_iterator;
+            ExpiryIndex::iterator expiry_iterator;
         };
 
-        void cleanup();
+        // 透明哈希：以HostnameKey查找时直接使用其预先计算的哈希
+        using EntryMap = std::unordered_map<std::string, CacheEntry, HostnameHash, HostnameEqual>;
+
+        // 回收最多max_entries个已到期条目，只访问过期索引头部，复杂度O(k log N)
+        size_t cleanup(size_t max_entries);
 
         void evict();
 
+        void erase(EntryMap::iterator it);
+
+        template<typename Key>
+        CacheLookup lookupLocked(const Key &key, AddressList &ips, bool allow_stale);
+
+        // 在持有锁的情况下写入条目，返回条目此前是否为未过期（或仍可作为过期地址返回）的地址条目
+        bool updateLocked(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl,
+                          AddressList *old_ips, CacheEntryKind kind = CacheEntryKind::kAddresses);
+
+        // 条目从过期索引中移除的时间：地址条目保留serve-stale窗口，否定条目到期即移除
+        std::chrono::system_clock::time_point removalTime(std::chrono::system_clock::time_point expire_time,
+                                                          CacheEntryKind kind) const {
+            return kind == CacheEntryKind::kAddresses ? expire_time + policy_.serve_stale : expire_time;
+        }
+
+        // 缓存写满时顺带回收的过期条目数上限
+        static constexpr size_t EVICTION_PURGE_BATCH = 16;
+        // 后台刷新提示后，刷新未完成（或失败）时再次提示的间隔
+        static constexpr auto REFRESH_RETRY_INTERVAL = std::chrono::seconds(1);
+
         size_t max_size_;
         std::chrono::milliseconds ttl_;
+        RefreshPolicy policy_;
         mutable std::mutex mutex_;
 
-        std::unordered_map<std::string, CacheEntry> cache_;
+        EntryMap cache_;
         std::list<std::string> lru_list_;// MRU at front, LRU at back
+        ExpiryIndex expiry_index_;       // 最早过期的条目在头部
 
-        // 统计信息
-        size_t hits_;
-        size_t misses_;
+        // 统计信息（relaxed原子计数，hit_rate()无需加锁）
+        std::atomic<size_t> hits_;
+        std::atomic<size_t> misses_;
     };
 
 }// namespace leigod::dns
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace leigod::dns {
+
+    /**
+     * 有界无锁多生产者多消费者环形队列（Vyukov bounded MPMC）
+     * 容量向上取整为2的幂，每个槽位以序号标记可写/可读状态，push()/pop()均不加锁也不分配内存
+     */
+    template<typename T>
+    class MpmcRing {
+    public:
+        explicit MpmcRing(size_t capacity)
+            : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+              cells_(std::make_unique<Cell[]>(mask_ + 1)) {
+            for (size_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpmcRing(const MpmcRing &) = delete;
+        MpmcRing &operator=(const MpmcRing &) = delete;
+
+        // 队列已满时返回false，value保持不变
+        bool push(T &value) {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = cells_[pos & mask_];
+                const size_t seq = cell.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 队列为空时返回false
+        bool pop(T &value) {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = cells_[pos & mask_];
+                const size_t seq = cell.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence{0};
+            T value{};
+        };
+
+        const size_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};// 生产者端
+        alignas(64) std::atomic<size_t> dequeue_pos_{0};// 消费者端
+    };
+
+}// namespace leigod::dns
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace leigod::dns {
+
+    /**
+     * 无锁多生产者单消费者队列（Vyukov MPSC）
+     * push()可在任意线程调用且不会阻塞，pop()只允许由唯一的消费者线程调用
+     */
+    template<typename T>
+    class MpscQueue {
+    public:
+        MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+        ~MpscQueue() {
+            T value;
+            while (pop(value)) {
+            }
+            if (tail_ != &stub_) {
+                delete tail_;
+            }
+        }
+
+        void push(T value) {
+            auto *node = new Node();
+            node->value = std::move(value);
+            Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // 生产者正在链接节点时可能暂时返回false，消费者下一轮会取到
+        bool pop(T &value) {
+            Node *tail = tail_;
+            Node *next = tail->next.load(std::memory_order_acquire);
+            if (!next) {
+                return false;
+            }
+
+            value = std::move(next->value);
+            tail_ = next;
+            if (tail != &stub_) {
+                delete tail;
+            }
+            return true;
+        }
+
+        bool empty() const {
+            return tail_->next.load(std::memory_order_acquire) == nullptr;
+        }
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+
+    private:
+        struct Node {
+            std::atomic<Node *> next{nullptr};
+            T value{};
+        };
+
+        alignas(64) std::atomic<Node *> head_;// 生产者端
+        alignas(64) Node *tail_;              // 消费者端
+        Node stub_;
+    };
+
+}// namespace leigod::dns
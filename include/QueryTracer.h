@@ -0,0 +1,107 @@
+#pragma once
+
+#include "interface/Common.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 按采样率记录单次解析各阶段的时间戳
+     * 被采样的resolve()调用携带一个Span，沿校验、缓存查询、准入、提交上游、收到应答、解析完成到回调
+     * 逐个阶段写入steady_clock纳秒时间戳；完成时复制进当前线程的环形缓冲区（只有所属线程写入，
+     * 导出时逐个加锁读取），缓冲区写满后覆盖最早的记录。未被采样的调用只多一次随机数比较。
+     * 记录可导出为Chrome trace JSON（chrome://tracing、Perfetto）或OTLP/JSON（ExportTraceServiceRequest）
+     */
+    class QueryTracer {
+    public:
+        enum class Stage : uint8_t {
+            kValidate,    // 主机名校验与规范化完成
+            kCacheProbe,  // 缓存查询完成
+            kAdmission,   // 获得上游并发槽位（排队的查询为出队时）
+            kSubmit,      // 提交给查询策略
+            kFirstPacket, // 收到第一个应答报文（查询策略提供时）
+            kAnswerParsed,// 应答解析完成
+            kCallback,    // 开始调用完成回调
+        };
+        static constexpr size_t STAGE_COUNT = 7;
+        static constexpr size_t MAX_HOSTNAME = 63;
+
+        // 一次解析的记录，定长可平凡复制，直接存入环形缓冲区
+        struct Span {
+            uint64_t trace_id[2]{};
+            uint64_t span_id{0};
+            int64_t start_ns{0};                    // resolve()入口
+            std::array<int64_t, STAGE_COUNT> stages{};// 各阶段时间戳，0表示未经过该阶段
+            int32_t status{0};
+            uint32_t thread{0};
+            bool from_cache{false};
+            bool coalesced{false};// 合并到已有的同名查询，上游阶段属于首个调用者
+            char hostname[MAX_HOSTNAME + 1]{};
+
+            // 重试等多次经过的阶段以最后一次为准
+            void mark(Stage stage, int64_t timestamp = now()) { stages[static_cast<size_t>(stage)] = timestamp; }
+        };
+
+        QueryTracer(double sample_rate, size_t ring_size);
+
+        QueryTracer(const QueryTracer &) = delete;
+        QueryTracer &operator=(const QueryTracer &) = delete;
+
+        static int64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+        }
+
+        // 按采样率决定是否跟踪本次解析，未采样时返回nullptr
+        std::shared_ptr<Span> sample(const std::string &hostname);
+
+        // 填写结果并写入当前线程的环形缓冲区
+        void finish(Span &span, const ResolveResult &result);
+
+        void setSampleRate(double sample_rate);
+        double sampleRate() const { return sample_rate_.load(std::memory_order_relaxed); }
+
+        // 所有线程缓冲区中的记录，按开始时间排序
+        std::vector<Span> collect() const;
+        void clear();
+
+        std::string exportChromeTrace() const;
+        std::string exportOtlpJson() const;
+
+    private:
+        struct Ring {
+            explicit Ring(size_t capacity, uint32_t thread) : spans(capacity), thread(thread) {}
+            std::vector<Span> spans;
+            size_t next{0};
+            size_t size{0};
+            uint32_t thread;
+            mutable std::mutex mutex;
+            // 所属线程退出后置为false，由下一个新线程接管
+            std::atomic<bool> owned{true};
+        };
+
+        Ring &localRing();
+        std::shared_ptr<Ring> acquireRing();
+        // steady_clock纳秒时间戳换算为Unix纳秒
+        int64_t toUnixNanos(int64_t steady_ns) const;
+
+        const uint64_t id_;
+        const size_t ring_size_;
+        std::atomic<double> sample_rate_;
+        // 采样阈值：64位随机数小于该值时采样，与sample_rate_一同更新
+        std::atomic<uint64_t> threshold_;
+        const int64_t unix_offset_ns_;
+
+        std::vector<std::shared_ptr<Ring>> rings_;
+        mutable std::mutex rings_mutex_;
+    };
+
+}// namespace leigod::dns
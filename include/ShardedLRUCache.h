@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "LRUCache.h"
+#include "interface/ICache.h"
+
+namespace leigod::dns {
+
+    /**
+     * 分片LRU缓存
+     * 按主机名哈希分散到N个独立加锁的LRUCache分片上，降低多线程resolve()时的锁竞争
+     */
+    class ShardedLRUCache : public ICache {
+    public:
+        ShardedLRUCache(size_t max_size, int64_t ttl, size_t shard_count, RefreshPolicy policy = {});
+
+        bool get(const std::string &hostname, AddressList &ips) override;
+
+        // 分片选择与分片内查找都复用key.hash
+        CacheLookup lookup(const HostnameKey &key, AddressList &ips) override;
+
+        // 先按分片分组，每个分片只加锁一次
+        void lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                        std::span<CacheLookup> results) override;
+
+        void update(const std::string &hostname, const AddressList &ips,
+                    std::chrono::milliseconds ttl) override;
+
+        bool exchange(const std::string &hostname, const AddressList &ips,
+                      std::chrono::milliseconds ttl, AddressList &old_ips) override;
+
+        void updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) override;
+
+        bool insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) override;
+
+        void remove(const std::string &hostname) override;
+
+        void clear() override;
+
+        size_t size() const override;
+
+        double hit_rate() const override;
+
+        size_t purgeExpired(size_t max_entries) override;
+
+        // 逐个分片遍历，同一时刻只复制一个分片的条目
+        void forEach(const EntryVisitor &visitor) const override;
+
+        // 分片数在构造后不变，新容量同样平分到各分片
+        void updateConfig(const CacheConfig &config) override;
+
+        size_t shard_count() const { return shards_.size(); }
+
+    private:
+        size_t shardIndex(size_t hash) const;
+        LRUCache &shardFor(const std::string &hostname) const;
+
+        std::vector<std::unique_ptr<LRUCache>> shards_;
+    };
+
+}// namespace leigod::dns
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "interface/ICache.h"
+
+namespace leigod::dns {
+
+    /**
+     * 跨进程共享的DNS缓存
+     * 缓存表放在命名共享内存段中（POSIX shm_open/mmap，Windows文件映射），同一主机上打开同名段的
+     * 所有进程共享条目，新启动的进程直接使用已预热的缓存。
+     *
+     * 段内是固定大小的开放寻址桶数组，主机名按哈希落在连续PROBE_LIMIT个桶组成的探测窗口内，
+     * 窗口写满时覆盖最早过期的条目。每个桶带一个序号锁（seqlock）：写方以CAS把序号置为奇数后写入，
+     * 读方只复制桶内容并检查序号前后一致，从不阻塞。写方在桶内记下自己的进程ID，在写入中途崩溃的
+     * 进程留下的桶由下一个写方发现持锁进程已退出后接管清空；这依赖各进程位于同一PID命名空间，
+     * 加锁与记录进程ID之间的极短窗口内崩溃，或进程ID已被复用时，该桶在期间一直不可用。
+     * 桶内只有定长字段，不含指针，
+     * 各进程映射到不同地址也能直接访问。段的尺寸与布局写在段头中，由创建（或接管未完成初始化的段）的
+     * 进程在初始化锁内确定，持锁进程崩溃时锁自动释放，下一个打开者重新初始化。
+     *
+     * 与LRUCache的区别：容量在段创建后固定；每个条目最多保存MAX_ADDRESSES个地址；
+     * 访问次数与刷新提示的去重也跨进程共享；命中率统计只针对本进程
+     */
+    class SharedMemoryCache : public ICache {
+    public:
+        // 每个主机名可以落在的连续桶数
+        static constexpr size_t PROBE_LIMIT = 8;
+        // 主机名（含分地址族缓存的后缀）最大长度
+        static constexpr size_t MAX_KEY_LENGTH = 264;
+        static constexpr size_t MAX_ADDRESSES = 8;
+
+        /**
+         * 打开名为name的共享内存段，不存在时按max_size创建；已存在的段沿用其容量。
+         * 段布局不兼容（不同版本或不同的主机名哈希）或系统调用失败时返回nullptr
+         */
+        static std::shared_ptr<SharedMemoryCache> open(const std::string &name, size_t max_size, int64_t ttl,
+                                                       RefreshPolicy policy = {});
+
+        // 删除段的名称：已映射的进程继续使用原来的段，之后打开的进程创建新段
+        static bool unlink(const std::string &name);
+
+        ~SharedMemoryCache() override;
+
+        SharedMemoryCache(const SharedMemoryCache &) = delete;
+        SharedMemoryCache &operator=(const SharedMemoryCache &) = delete;
+
+        bool get(const std::string &hostname, AddressList &ips) override;
+
+        CacheLookup lookup(const HostnameKey &key, AddressList &ips) override;
+
+        void update(const std::string &hostname, const AddressList &ips,
+                    std::chrono::milliseconds ttl) override;
+
+        bool exchange(const std::string &hostname, const AddressList &ips,
+                      std::chrono::milliseconds ttl, AddressList &old_ips) override;
+
+        void updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) override;
+
+        bool insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) override;
+
+        void remove(const std::string &hostname) override;
+
+        // 清空整个段，对所有进程生效
+        void clear() override;
+
+        // 所有进程写入的已占用桶数（近似值）
+        size_t size() const override;
+
+        double hit_rate() const override;
+
+        // 从本进程的扫描位置起检查最多max_entries个桶，回收其中已过期的条目
+        size_t purgeExpired(size_t max_entries) override;
+
+        void forEach(const EntryVisitor &visitor) const override;
+
+        // 段的容量不可变，只应用默认TTL与刷新策略
+        void updateConfig(const CacheConfig &config) override;
+
+        size_t capacity() const { return bucket_count_; }
+
+    private:
+        struct SegmentHeader;
+        struct Bucket;
+        struct Entry;
+
+        SharedMemoryCache(void *base, size_t mapped_size, int64_t ttl, RefreshPolicy policy);
+
+        Bucket &bucketAt(size_t index) const;
+        // 读取桶的一致快照：tag非0时只读取标签相同的桶；桶为空或持续被写入时返回false
+        static bool readSnapshot(Bucket &bucket, uint64_t tag, Entry &entry);
+        // 读取与hostname匹配的快照
+        static bool readEntry(Bucket &bucket, uint64_t tag, std::string_view hostname, Entry &entry);
+        // 以CAS把序号置为奇数；桶正被其他写方占用时返回false，不等待。
+        // 持锁进程已退出时由reclaim()接管并清空该桶
+        bool tryLock(Bucket &bucket, uint32_t &seq);
+        bool reclaim(Bucket &bucket, uint32_t &seq);
+        // 桶正被写入且持锁进程已退出
+        static bool abandoned(Bucket &bucket);
+        static void unlock(Bucket &bucket, uint32_t seq);
+        static void copyLocked(const Bucket &bucket, Entry &entry);
+        // 清空持有写锁的桶并维护占用计数，返回桶此前是否被占用
+        bool clearLocked(Bucket &bucket);
+        CacheLookup lookupImpl(std::string_view hostname, size_t hash, AddressList &ips, bool allow_stale);
+        // 写入条目，返回是否写入（桶正被其他写方占用或ttl为0时不写入）；
+        // fresh返回条目此前是否为未过期（或仍可作为过期地址返回）的地址条目
+        bool write(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl,
+                   AddressList *old_ips, CacheEntryKind kind, bool *fresh = nullptr);
+        void setPolicy(std::chrono::milliseconds ttl, const RefreshPolicy &policy);
+
+        void *base_;
+        size_t mapped_size_;
+        SegmentHeader *header_;
+        Bucket *buckets_;
+        size_t bucket_count_;
+
+        // 默认TTL与刷新策略：可在其他线程更新，逐个字段原子读取
+        std::atomic<int64_t> ttl_ms_;
+        std::atomic<int64_t> serve_stale_ms_;
+        std::atomic<double> refresh_ahead_ratio_;
+        std::atomic<uint32_t> min_hits_;
+
+        // 本进程的统计与过期扫描位置
+        std::atomic<size_t> hits_{0};
+        std::atomic<size_t> misses_{0};
+        std::atomic<size_t> purge_cursor_{0};
+    };
+
+}// namespace leigod::dns
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 带代数的槽位表
+     * 元素存放在按块分配的槽中，地址在删除前保持不变，插入与删除都是O(1)且不逐个分配内存；
+     * 删除后槽位代数递增，持有旧Key的访问返回nullptr。非线程安全，由调用方加锁
+     */
+    template<typename T, size_t ChunkSize = 256>
+    class SlotMap {
+    public:
+        struct Key {
+            uint32_t index{UINT32_MAX};
+            uint32_t generation{0};
+        };
+
+        SlotMap() = default;
+        SlotMap(const SlotMap &) = delete;
+        SlotMap &operator=(const SlotMap &) = delete;
+
+        // 构造一个新元素，优先复用空闲槽位
+        template<typename... Args>
+        std::pair<Key, T *> emplace(Args &&...args) {
+            if (free_head_ == UINT32_MAX) {
+                grow();
+            }
+            const uint32_t index = free_head_;
+            auto &slot = slotAt(index);
+            free_head_ = slot.next_free;
+            slot.value.emplace(std::forward<Args>(args)...);
+            ++size_;
+            return {Key{index, slot.generation}, &*slot.value};
+        }
+
+        T *get(Key key) {
+            if (key.index >= capacity()) {
+                return nullptr;
+            }
+            auto &slot = slotAt(key.index);
+            return slot.value && slot.generation == key.generation ? &*slot.value : nullptr;
+        }
+
+        // 删除元素并归还槽位，Key已失效时返回false
+        bool erase(Key key) {
+            if (!get(key)) {
+                return false;
+            }
+            auto &slot = slotAt(key.index);
+            slot.value.reset();
+            ++slot.generation;
+            slot.next_free = free_head_;
+            free_head_ = key.index;
+            --size_;
+            return true;
+        }
+
+        // 遍历所有元素，复杂度与容量成正比，只用于关闭等低频路径
+        template<typename F>
+        void forEach(F &&fn) {
+            for (uint32_t index = 0; index < capacity(); ++index) {
+                auto &slot = slotAt(index);
+                if (slot.value) {
+                    fn(Key{index, slot.generation}, *slot.value);
+                }
+            }
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        size_t capacity() const { return chunks_.size() * ChunkSize; }
+
+    private:
+        struct Slot {
+            std::optional<T> value;
+            uint32_t generation{0};
+            uint32_t next_free{UINT32_MAX};
+        };
+
+        Slot &slotAt(uint32_t index) {
+            return chunks_[index / ChunkSize][index % ChunkSize];
+        }
+
+        void grow() {
+            const auto base = static_cast<uint32_t>(capacity());
+            chunks_.push_back(std::make_unique<Slot[]>(ChunkSize));
+            // 新块的槽位按下标顺序串入空闲链表
+            for (size_t i = ChunkSize; i-- > 0;) {
+                chunks_.back()[i].next_free = free_head_;
+                free_head_ = base + static_cast<uint32_t>(i);
+            }
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> chunks_;
+        uint32_t free_head_{UINT32_MAX};
+        size_t size_{0};
+    };
+
+}// namespace leigod::dns
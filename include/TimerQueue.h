@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 定时任务队列
+     * 以截止时间为键的最小堆，由事件循环线程调用runDue()执行到期任务，
+     * 并通过timeUntilNext()把最近的截止时间合并进select()/ares_timeout()的等待时长
+     */
+    class TimerQueue {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Task = std::function<void()>;
+        using TimerId = uint64_t;
+
+        TimerId schedule(Clock::time_point deadline, Task task);
+
+        TimerId scheduleAfter(Clock::duration delay, Task task) {
+            return schedule(Clock::now() + delay, std::move(task));
+        }
+
+        // 取消尚未执行的任务，返回任务是否仍在队列中
+        bool cancel(TimerId id);
+
+        // 执行所有已到期的任务（在锁外执行，任务中可以再次调度），返回执行数量
+        size_t runDue(Clock::time_point now = Clock::now());
+
+        // 距离最近一个任务到期的时间，队列为空时返回std::nullopt
+        std::optional<std::chrono::milliseconds> timeUntilNext(Clock::time_point now = Clock::now()) const;
+
+        size_t size() const;
+
+        void clear();
+
+    private:
+        struct Entry {
+            Clock::time_point deadline;
+            TimerId id;
+            Task task;
+        };
+
+        // 截止时间相同时按调度顺序执行
+        struct Later {
+            bool operator()(const Entry &a, const Entry &b) const {
+                return a.deadline != b.deadline ? a.deadline > b.deadline : a.id > b.id;
+            }
+        };
+
+        // 丢弃堆顶已取消的任务
+        void dropCancelledHead();
+
+        mutable std::mutex mutex_;
+        std::priority_queue<Entry, std::vector<Entry>, Later> heap_;
+        std::unordered_set<TimerId> pending_;// 堆中尚未取消的任务
+        TimerId next_id_{1};
+    };
+
+}// namespace leigod::dns
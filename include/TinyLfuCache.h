@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FrequencySketch.h"
+#include "interface/ICache.h"
+
+namespace leigod::dns {
+
+    /**
+     * W-TinyLFU缓存
+     * 新条目先进入容量约1%的窗口LRU；窗口溢出的条目只有在估计频率高于主区域淘汰候选时才被接纳，
+     * 一次性的突发名称（爬虫扫描等）因此无法冲掉稳定的热点集合。主区域为分段LRU：
+     * probation中再次被访问的条目晋升到protected（约占主区域80%），protected溢出的条目降回probation。
+     *
+     * 条目存放在连续的节点数组中，各区域的LRU链表以节点下标链接；主机名只保存一份，
+     * 由线性探测的开放寻址索引（槽位带哈希标签，删除时后移补位）按哈希定位节点。
+     * 过期与刷新语义与LRUCache相同
+     */
+    class TinyLfuCache : public ICache {
+    public:
+        TinyLfuCache(size_t max_size, int64_t ttl, RefreshPolicy policy = {});
+
+        bool get(const std::string &hostname, AddressList &ips) override;
+
+        CacheLookup lookup(const HostnameKey &key, AddressList &ips) override;
+
+        void lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                        std::span<CacheLookup> results) override;
+
+        void update(const std::string &hostname, const AddressList &ips,
+                    std::chrono::milliseconds ttl) override;
+
+        bool exchange(const std::string &hostname, const AddressList &ips,
+                      std::chrono::milliseconds ttl, AddressList &old_ips) override;
+
+        void updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) override;
+
+        bool insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) override;
+
+        void remove(const std::string &hostname) override;
+
+        void clear() override;
+
+        size_t size() const override;
+
+        double hit_rate() const override;
+
+        size_t purgeExpired(size_t max_entries) override;
+
+        void forEach(const EntryVisitor &visitor) const override;
+
+        void updateConfig(const CacheConfig &config) override;
+
+        // 替换容量、默认TTL与刷新策略；容量变化时重建频率统计与索引并淘汰多出的条目
+        void reconfigure(size_t max_size, std::chrono::milliseconds ttl, RefreshPolicy policy);
+
+    private:
+        using TimePoint = std::chrono::system_clock::time_point;
+
+        static constexpr uint32_t NIL = UINT32_MAX;
+        // 窗口占总容量的比例与protected占主区域的比例
+        static constexpr double WINDOW_RATIO = 0.01;
+        static constexpr double PROTECTED_RATIO = 0.8;
+        // 缓存写满时顺带回收的过期条目数上限
+        static constexpr size_t EVICTION_PURGE_BATCH = 16;
+        // 后台刷新提示后，刷新未完成（或失败）时再次提示的间隔
+        static constexpr auto REFRESH_RETRY_INTERVAL = std::chrono::seconds(1);
+
+        enum class Region : uint8_t {
+            kFree,
+            kWindow,
+            kProbation,
+            kProtected,
+        };
+
+        struct Node {
+            std::string hostname;
+            size_t hash{0};
+            AddressList ips;
+            TimePoint expire_time;
+            TimePoint next_refresh;// 此后的访问（热点条目）提示后台刷新
+            uint32_t hits{0};      // 当前TTL周期内的访问次数
+            // 每次写入或释放时递增，使过期堆中的旧记录失效
+            uint32_t generation{0};
+            CacheEntryKind kind{CacheEntryKind::kAddresses};
+            Region region{Region::kFree};
+            uint32_t prev{NIL};
+            uint32_t next{NIL};// 空闲节点以next串成空闲链表
+        };
+
+        // 按下标链接的LRU链表：head为MRU，tail为LRU
+        struct List {
+            uint32_t head{NIL};
+            uint32_t tail{NIL};
+            size_t size{0};
+        };
+
+        // 索引槽位：tag为哈希的高32位，先比较标签再访问节点
+        struct Slot {
+            uint32_t node{NIL};
+            uint32_t tag{0};
+        };
+
+        // 过期堆记录：条目重写后旧记录按代数识别并跳过，不在堆中查找删除
+        struct ExpiryRecord {
+            TimePoint removal_time;
+            uint32_t node;
+            uint32_t generation;
+        };
+
+        static uint32_t tagOf(size_t hash) {
+            return static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32);
+        }
+
+        // 索引
+        uint32_t find(std::string_view hostname, size_t hash) const;
+        void indexInsert(uint32_t node);
+        void indexErase(uint32_t node);
+        void rebuildIndex(size_t max_size);
+
+        // 链表与区域
+        List &listOf(Region region);
+        void unlink(uint32_t node);
+        void pushFront(Region region, uint32_t node);
+        void onHit(uint32_t node);
+
+        // 接纳与淘汰
+        void admit();
+        void evictOne();
+        void erase(uint32_t node);
+        uint32_t allocateNode();
+        void resizeRegions(size_t max_size);
+
+        // 过期
+        void scheduleExpiry(uint32_t node);
+        size_t cleanup(size_t max_entries);
+        void rebuildExpiryHeap();
+        TimePoint removalTime(const Node &node) const {
+            return node.kind == CacheEntryKind::kAddresses ? node.expire_time + policy_.serve_stale
+                                                           : node.expire_time;
+        }
+
+        CacheLookup lookupLocked(std::string_view hostname, size_t hash, AddressList &ips, bool allow_stale);
+
+        // 在持有锁的情况下写入条目，返回条目此前是否为未过期（或仍可作为过期地址返回）的地址条目
+        bool updateLocked(const std::string &hostname, size_t hash, const AddressList &ips,
+                          std::chrono::milliseconds ttl, AddressList *old_ips,
+                          CacheEntryKind kind = CacheEntryKind::kAddresses);
+
+        size_t max_size_;
+        size_t window_max_{0};
+        size_t protected_max_{0};
+        std::chrono::milliseconds ttl_;
+        RefreshPolicy policy_;
+        mutable std::mutex mutex_;
+
+        std::vector<Node> nodes_;
+        uint32_t free_head_{NIL};
+        size_t count_{0};
+        std::vector<Slot> slots_;// 容量为2的幂，负载不超过1/2
+        size_t slot_mask_{0};
+        List window_;
+        List probation_;
+        List protected_;
+        FrequencySketch sketch_;
+        std::vector<ExpiryRecord> expiry_heap_;// 最早移除的记录在堆顶
+
+        // 统计信息（relaxed原子计数，hit_rate()无需加锁）
+        std::atomic<size_t> hits_{0};
+        std::atomic<size_t> misses_{0};
+    };
+
+}// namespace leigod::dns
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "interface/IDNSQueryStrategy.h"
+#include "interface/IEventLoop.h"
+#include "interface/ILogger.h"
+#include "interface/IMetrics.h"
+#include "MpscQueue.h"
+#include "SlotMap.h"
+#include <ares.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 批量UDP查询策略（"udp_batch"）
+     * 面向每秒数十万名称的批量解析（爬虫、日志补全等）：不经过ares_getaddrinfo，跳过搜索域与hosts文件，
+     * 直接向配置的上游服务器发送A/AAAA查询。查询报文构造在事务自带的缓冲区中，重传时直接复用；
+     * 驱动事件循环的线程以sendmmsg/recvmmsg成批收发（其他平台逐个收发），
+     * 一小组各自绑定内核随机源端口的UDP套接字轮流承载查询。
+     *
+     * 应答必须来自所查询的服务器，且ID与问题段（含DNS 0x20随机大小写）逐字节一致，否则丢弃并继续等待；
+     * 应答解析直接把地址写入AddressList构建器。只有截断（TC）的应答改用TCP重新查询。
+     *
+     * query()可在任意线程调用：请求进入无锁队列并唤醒事件循环，其余状态只在驱动事件循环的线程上访问。
+     * 不支持对冲与断路器；超时或SERVFAIL/REFUSED时按retry.max_attempts轮流换下一个服务器重发
+     */
+    class UdpBatchQueryStrategy : public IDNSQueryStrategy {
+    public:
+        UdpBatchQueryStrategy(DNSResolverConfig config,
+                              std::shared_ptr<ILogger> logger,
+                              std::shared_ptr<IEventLoop> eventLoop = nullptr,
+                              std::shared_ptr<IMetrics> metrics = nullptr);
+
+        ~UdpBatchQueryStrategy() override;
+
+        UdpBatchQueryStrategy(const UdpBatchQueryStrategy &) = delete;
+        UdpBatchQueryStrategy &operator=(const UdpBatchQueryStrategy &) = delete;
+
+        // 实现 IDNSQueryStrategy 接口
+        void query(const std::string &hostname, DNSQueryCallback callback) override;
+        void query(const std::string &hostname, int family, DNSQueryCallback callback) override;
+        void processEvents(std::chrono::milliseconds max_wait) override;
+        void processSocket(SocketHandle socket, bool readable, bool writable) override;
+        std::chrono::milliseconds nextTimeout(std::chrono::milliseconds max_wait) override;
+        std::shared_ptr<IEventLoop> eventLoop() const override;
+        void shutdown() override;
+        bool isInitialized() const override;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // 查询报文上限：头部 + 最长的QNAME + QTYPE/QCLASS + EDNS OPT记录
+        static constexpr size_t MAX_QUERY_SIZE = 12 + 255 + 4 + 11;
+        // EDNS通告的UDP应答大小（DNS Flag Day 2020建议值），也是每个接收缓冲区的大小
+        static constexpr size_t EDNS_UDP_SIZE = 1232;
+        // UDP套接字的接收缓冲区，容纳批量应答的突发
+        static constexpr int SOCKET_BUFFER_SIZE = 4 << 20;
+
+        struct Submission {
+            std::string hostname;
+            int family{AF_UNSPEC};
+            DNSQueryCallback callback;
+        };
+
+        struct Server {
+            sockaddr_storage address{};
+            socklen_t address_length{0};
+            int family{AF_INET};
+            std::string name;
+            std::chrono::milliseconds timeout{0};
+        };
+
+        struct Request;
+        struct Transaction;
+        using RequestMap = SlotMap<Request>;
+        using TransactionMap = SlotMap<Transaction>;
+
+        /**
+         * 一次query()调用：AF_UNSPEC同时发出A与AAAA两个事务，全部完成后合并回调
+         */
+        struct Request {
+            std::string hostname;
+            DNSQueryCallback callback;
+            Clock::time_point start_time;
+            AddressList::Builder addresses;
+            int64_t ttl{-1};         // 地址与CNAME记录中最小的TTL（秒），-1表示尚无记录
+            int64_t negative_ttl{-1};// 否定应答的SOA最小TTL（秒）
+            int failure{ARES_SUCCESS};// 第一个非否定应答的失败
+            Clock::time_point first_packet;// 收到第一个匹配的应答报文，供查询跟踪使用
+            uint8_t pending{0};
+            bool nxdomain{false};
+        };
+
+        /**
+         * 一个A或AAAA查询及其报文；重发时换服务器与ID，问题段不变
+         */
+        struct Transaction {
+            RequestMap::Key request;
+            Clock::time_point deadline;
+            uint32_t socket{0};   // 当前占用ID的UDP套接字下标
+            uint32_t server{0};
+            uint32_t attempt{0};
+            uint16_t id{0};
+            uint16_t qtype{0};
+            uint16_t length{0};         // 报文长度
+            uint16_t question_length{0};// 头部之后问题段的长度（QNAME + QTYPE + QCLASS）
+            bool has_id{false};
+            bool queued{false};// 已在套接字的发送队列中（重发到其他套接字后旧队列中的记录失效）
+            bool over_tcp{false};
+            SocketHandle tcp{0};
+            std::array<uint8_t, MAX_QUERY_SIZE> packet{};
+        };
+
+        struct UdpSocket {
+            SocketHandle handle{0};
+            int family{AF_INET};
+            bool want_write{false};
+            std::vector<TransactionMap::Key> ids;     // DNS ID -> 在途事务，65536项，初始化时一次分配
+            std::vector<TransactionMap::Key> outbox;  // 等待发送的事务
+        };
+
+        // TCP回退连接：发送2字节长度前缀的查询，读取完整应答
+        struct TcpConnection {
+            TransactionMap::Key transaction;
+            std::vector<uint8_t> out;
+            size_t written{0};
+            std::vector<uint8_t> in;
+        };
+
+        // 事务的超时记录：事务重发或完成后旧记录按截止时间识别并跳过
+        struct Deadline {
+            Clock::time_point deadline;
+            TransactionMap::Key transaction;
+            bool operator>(const Deadline &other) const { return deadline > other.deadline; }
+        };
+
+        // 应答的解析结果
+        struct Answer {
+            int status{ARES_SUCCESS};
+            int64_t ttl{-1};// 成功时为记录的最小TTL，否定应答为SOA最小TTL（秒），-1表示未知
+        };
+
+        // 批量收发的消息头与缓冲区，平台相关，定义在实现文件中
+        struct BatchBuffers;
+
+        void initialize();
+        bool openSockets();
+        void closeSockets();
+
+        // 请求与事务
+        void drainSubmissions();
+        void startRequest(Submission submission);
+        void startTransaction(RequestMap::Key request_key, const std::string &hostname, uint16_t qtype,
+                              uint32_t server);
+        void dispatch(TransactionMap::Key key, Transaction &transaction);
+        bool assignId(Transaction &transaction, TransactionMap::Key key);
+        void releaseId(Transaction &transaction);
+        void retryOrFail(TransactionMap::Key key, Transaction &transaction, int status);
+        void completeTransaction(TransactionMap::Key key, Transaction &transaction, const Answer &answer);
+        void deliver(RequestMap::Key key);
+
+        // 收发
+        void flushSends();
+        void flushSocket(uint32_t index);
+        void receive(uint32_t index);
+        void handleResponse(TransactionMap::Key key, Transaction &transaction, const uint8_t *data, size_t length,
+                            bool truncated, Clock::time_point received);
+        bool matchesQuestion(const Transaction &transaction, const uint8_t *data, size_t length) const;
+        void onSocketEvent(SocketHandle socket, bool readable, bool writable);
+
+        // TCP回退
+        void startTcp(TransactionMap::Key key, Transaction &transaction);
+        void onTcpEvent(SocketHandle socket, bool readable, bool writable);
+        void closeTcp(Transaction &transaction);
+
+        void processTimeouts(Clock::time_point now);
+
+        // 解析问题段之后的记录：先校验整个报文并取得TTL，成功时再把地址写入addresses
+        static Answer parseResponse(const uint8_t *data, size_t length, size_t offset, uint16_t qtype,
+                                    AddressList::Builder &addresses);
+
+        DNSResolverConfig config_;
+        std::shared_ptr<ILogger> logger_;
+        std::shared_ptr<IEventLoop> eventLoop_;
+        std::shared_ptr<IMetrics> metrics_;
+        std::atomic<bool> initialized_{false};
+        // 每个事务的最大尝试次数（retry.max_attempts × 服务器数，与c-ares的tries语义一致）
+        uint32_t max_attempts_{1};
+
+        // 其他线程提交的查询；queued_为已入队未取出的数量，从0变为非0时才唤醒事件循环
+        MpscQueue<Submission> submissions_;
+        std::atomic<int64_t> queued_{0};
+
+        // 以下状态只在驱动事件循环的线程上访问
+        std::vector<Server> servers_;
+        std::vector<uint32_t> server_schedule_;// 服务器下标按权重重复，新请求轮流选择
+        std::vector<UdpSocket> sockets_;
+        std::unordered_map<SocketHandle, uint32_t> socket_index_;
+        std::unordered_map<SocketHandle, TcpConnection> tcp_connections_;
+        RequestMap requests_;
+        TransactionMap transactions_;
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines_;
+        std::unique_ptr<BatchBuffers> buffers_;
+        std::mt19937 rng_{std::random_device{}()};
+        uint32_t next_server_{0};
+        uint32_t next_socket_{0};
+    };
+
+}// namespace leigod::dns
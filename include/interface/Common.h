@@ -1,5 +1,6 @@
 #pragma once
 
+#include "IPAddress.h"
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
@@ -14,11 +15,18 @@ namespace leigod {
         struct ResolveResult {
             int status{};
             std::string hostname{};
-            std::vector<std::string> ip_addresses{};
-            int64_t resolution_time{};
+            AddressList ip_addresses{};
+            int64_t resolution_time{};// in microseconds
             std::string error{};
             bool from_cache = false;
-            NLOHMANN_DEFINE_TYPE_INTRUSIVE(ResolveResult, status, hostname, ip_addresses, resolution_time, error, from_cache)
+            bool stale = false;// 来自缓存中已过期的条目（serve-stale），后台正在刷新
+            int64_t ttl = -1;// 应答记录中最小的TTL（否定应答为SOA最小TTL，RFC 2308），in milliseconds，-1表示未知，0表示不应缓存
+            bool partial = false;// Happy Eyeballs模式下只包含先到达的地址族，另一地址族到达后会再回调一次完整结果
+            // 查询策略提供的阶段时间戳（steady_clock纳秒），供查询跟踪使用，0表示未提供
+            int64_t first_packet_ns{};// 收到第一个应答报文
+            int64_t answer_parsed_ns{};// 应答解析完成
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(ResolveResult, status, hostname, ip_addresses, resolution_time, error, from_cache,
+                                           stale, ttl, partial, first_packet_ns, answer_parsed_ns)
         };
 
         struct PluginConfig {
@@ -44,9 +52,25 @@ namespace leigod {
             bool enabled = true;
             int64_t ttl = 300 * 1000;// in milliseconds
             size_t max_size = 10000;
-            bool persistent = false;
+            bool persistent = false;             // 启用缓存快照：启动时从cache_file预热，运行期间与关闭时写回
             std::string cache_file{};
-            NLOHMANN_DEFINE_TYPE_INTRUSIVE(CacheConfig, enabled, ttl, max_size, persistent, cache_file)
+            int64_t snapshot_interval_ms = 300 * 1000;// 周期性写入快照的间隔，0表示只在关闭时写入
+            std::string type = "lru";// 缓存插件名称，如 "lru"、"sharded_lru"、"tinylfu"、"shm"
+            size_t shard_count = 16; // sharded_lru 的分片数量
+            std::string shm_name = "/leigod_dns_cache";// shm 的共享内存段名称，同名的进程共享缓存
+            size_t cleanup_batch_size = 256;// processEvents() 每次最多回收的过期条目数
+            int64_t min_ttl = 0;                // 记录TTL下限，in milliseconds
+            int64_t max_ttl = 24 * 3600 * 1000; // 记录TTL上限，in milliseconds
+            int64_t serve_stale_ms = 0;         // 热点条目过期后仍返回旧地址并后台刷新的时长，0表示禁用
+            double refresh_ahead_ratio = 0.0;   // 热点条目经过TTL的该比例后提前后台刷新，0表示禁用
+            uint32_t refresh_min_hits = 2;      // 一个TTL周期内访问达到该次数视为热点条目
+            bool negative_cache = true;            // 缓存NXDOMAIN/NODATA否定应答
+            int64_t negative_ttl = 60 * 1000;      // 上游未给出SOA最小TTL时否定应答的TTL，in milliseconds
+            int64_t max_negative_ttl = 3600 * 1000;// 否定应答TTL上限，in milliseconds
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(CacheConfig, enabled, ttl, max_size, persistent, cache_file, type, shard_count,
+                                           cleanup_batch_size, min_ttl, max_ttl, serve_stale_ms, refresh_ahead_ratio,
+                                           refresh_min_hits, snapshot_interval_ms, negative_cache, negative_ttl,
+                                           max_negative_ttl, shm_name)
         };
 
         struct RetryConfig {
@@ -56,6 +80,54 @@ namespace leigod {
             NLOHMANN_DEFINE_TYPE_INTRUSIVE(RetryConfig, max_attempts, base_delay_ms, max_delay_ms)
         };
 
+        struct HealthCheckConfig {
+            bool enabled = true;                   // 启用上游服务器断路器与后台探测
+            std::string probe_hostname = ".";      // 探测查询的域名，服务器给出任何应答（含NXDOMAIN）都视为存活
+            uint32_t probe_interval_ms = 1000;     // 断路器打开后的探测间隔
+            uint32_t max_probe_interval_ms = 30000;// 探测连续失败时指数退避的上限
+            uint32_t success_threshold = 2;        // 连续探测成功多少次后进入半开状态
+            uint32_t half_open_duration_ms = 10000;// 半开状态持续时间，期间分流比例逐步恢复，无失败则关闭断路器
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(HealthCheckConfig, enabled, probe_hostname, probe_interval_ms,
+                                           max_probe_interval_ms, success_threshold, half_open_duration_ms)
+        };
+
+        struct HedgingConfig {
+            bool enabled = false;               // 启用对冲请求：首个服务器迟迟未应答时向第二个服务器发出同样的查询
+            uint32_t delay_ms = 0;              // 对冲延迟，0表示使用首个服务器观测到的p95延迟
+            uint32_t min_delay_ms = 5;          // 对冲延迟下限
+            double budget_ratio = 0.05;         // 对冲请求数占（需对冲域名）查询数的比例上限
+            uint32_t budget_burst = 10;         // 对冲预算令牌桶容量
+            std::vector<std::string> hostnames{};// 只对这些域名及其子域名对冲，为空时对所有域名生效
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(HedgingConfig, enabled, delay_ms, min_delay_ms, budget_ratio, budget_burst,
+                                           hostnames)
+        };
+
+        struct HappyEyeballsConfig {
+            bool enabled = false;              // 启用ipv6_enabled时分别查询A与AAAA并分别缓存，先到达的地址族先交付部分结果
+            uint32_t resolution_delay_ms = 50; // A先于AAAA到达时等待AAAA的时间（RFC 8305 Resolution Delay），0表示立即交付
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(HappyEyeballsConfig, enabled, resolution_delay_ms)
+        };
+
+        struct AdmissionConfig {
+            uint32_t max_queue_size = 1000;  // 上游查询达到max_concurrent_queries后最多排队的查询数，0表示直接拒绝
+            uint32_t queue_timeout_ms = 1000;// 查询在准入队列中的最长等待时间，超时后以ARES_ETIMEOUT失败
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(AdmissionConfig, max_queue_size, queue_timeout_ms)
+        };
+
+        struct UdpBatchConfig {
+            uint32_t sockets = 4;     // 每个地址族的UDP套接字数，各自使用内核分配的随机源端口
+            uint32_t batch_size = 64; // 每次sendmmsg/recvmmsg调用处理的最大报文数
+            bool use_0x20 = true;     // 随机化查询名的字母大小写（DNS 0x20），应答必须原样回显
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(UdpBatchConfig, sockets, batch_size, use_0x20)
+        };
+
+        struct TracingConfig {
+            bool enabled = false;     // 启用查询跟踪：按采样率记录resolve()各阶段的时间戳
+            double sample_rate = 0.01;// 被跟踪的resolve()调用比例，可热更新
+            uint32_t ring_size = 1024;// 每个线程保留的最近记录数
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(TracingConfig, enabled, sample_rate, ring_size)
+        };
+
         struct MetricsConfig {
             bool enabled = true;
             std::string metrics_file{};
@@ -67,15 +139,27 @@ namespace leigod {
             std::vector<DNSServerConfig> servers{};
             CacheConfig cache;
             RetryConfig retry;
+            HealthCheckConfig health_check;
+            HedgingConfig hedging;
+            HappyEyeballsConfig happy_eyeballs;
+            UdpBatchConfig udp_batch;
+            AdmissionConfig admission;
+            TracingConfig tracing;
             MetricsConfig metrics;
             PluginConfig plugins;
+            std::string query_strategy = "cares";// 查询策略插件名（"cares"或"udp_batch"），初始化时选定
             uint32_t query_timeout_ms = 5000;
-            uint32_t max_concurrent_queries = 100;
+            uint32_t max_concurrent_queries = 100;// 同时在途的上游查询上限（缓存命中与合并的同名查询不占用）
             bool ipv6_enabled = false;
-            uint32_t server_error_threshold = 10;
+            uint32_t server_error_threshold = 10;// 连续失败多少次后打开该服务器的断路器
+            bool managed_io = false;// 由DNSResolver内部的I/O线程驱动事件循环，调用方无需调用processEvents()
+            uint32_t io_threads = 1;        // 托管模式下的I/O线程数，每个线程独占一个c-ares通道
+            bool io_thread_affinity = false;// 将第i个I/O线程绑定到第i个CPU核心
 
-            NLOHMANN_DEFINE_TYPE_INTRUSIVE(DNSResolverConfig, servers, cache, retry, metrics, plugins, query_timeout_ms,
-                                           max_concurrent_queries, ipv6_enabled, server_error_threshold)
+            NLOHMANN_DEFINE_TYPE_INTRUSIVE(DNSResolverConfig, servers, cache, retry, health_check, hedging, happy_eyeballs,
+                                           udp_batch, admission, tracing, metrics, plugins, query_strategy, query_timeout_ms,
+                                           max_concurrent_queries, ipv6_enabled, server_error_threshold, managed_io,
+                                           io_threads, io_thread_affinity)
         };
 
         class IDNSQueryStrategy;
@@ -83,9 +167,9 @@ namespace leigod {
         // 查询上下文
         struct QueryContext {
             std::string hostname;
-            std::function<void(ResolveResult)> callback = nullptr;
+            std::function<void(const ResolveResult &)> callback = nullptr;
             std::chrono::steady_clock::time_point start_time{};
-            std::vector<std::string> old_addresses;
+            AddressList old_addresses;
             std::shared_ptr<IDNSQueryStrategy> strategy;
             uint32_t retry_count{};
             std::atomic_bool completed = false;
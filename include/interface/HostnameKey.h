@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace leigod::dns {
+
+    // 主机名哈希：缓存的键与HostnameKey::hash必须使用同一个哈希函数
+    inline size_t hostnameHash(std::string_view hostname) {
+        return std::hash<std::string_view>{}(hostname);
+    }
+
+    /**
+     * 规范化的主机名：小写、去掉结尾的'.'，并附带预先计算的哈希，
+     * 缓存查找（分片选择与哈希表查找）直接复用hash，不再重新计算
+     */
+    struct HostnameKey {
+        std::string name;
+        size_t hash{0};
+
+        HostnameKey() = default;
+        // name必须已经是规范形式
+        explicit HostnameKey(std::string canonical_name)
+            : name(std::move(canonical_name)), hash(hostnameHash(name)) {}
+    };
+
+    // 透明哈希与比较：以std::string为键的哈希表可直接用HostnameKey或std::string_view查找
+    struct HostnameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view hostname) const { return hostnameHash(hostname); }
+        size_t operator()(const std::string &hostname) const { return hostnameHash(hostname); }
+        size_t operator()(const HostnameKey &key) const { return key.hash; }
+    };
+
+    struct HostnameEqual {
+        using is_transparent = void;
+        template<typename L, typename R>
+        bool operator()(const L &lhs, const R &rhs) const { return view(lhs) == view(rhs); }
+
+    private:
+        static std::string_view view(std::string_view hostname) { return hostname; }
+        static std::string_view view(const HostnameKey &key) { return key.name; }
+    };
+
+}// namespace leigod::dns
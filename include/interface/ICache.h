@@ -1,21 +1,108 @@
 #pragma once
 
 #include "Common.h"
+#include "HostnameKey.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace leigod::dns {
+    /**
+     * 过期与后台刷新策略
+     * 两种刷新都只针对当前TTL周期内访问次数达到min_hits的热点条目，冷门条目照常过期
+     */
+    struct RefreshPolicy {
+        // 过期后仍可返回旧地址的时长（RFC 8767 serve-stale），0表示禁用
+        std::chrono::milliseconds serve_stale{0};
+        // 条目经过TTL的该比例后建议提前刷新（refresh-ahead），0表示禁用
+        double refresh_ahead_ratio{0.0};
+        uint32_t min_hits{2};
+    };
+
+    inline RefreshPolicy refreshPolicy(const CacheConfig &config) {
+        return {.serve_stale = std::chrono::milliseconds(std::max<int64_t>(config.serve_stale_ms, 0)),
+                .refresh_ahead_ratio = config.refresh_ahead_ratio,
+                .min_hits = config.refresh_min_hits};
+    }
+
+    // 缓存条目类型：否定应答（RFC 2308）与地址存放在同一缓存中，共享容量与LRU淘汰
+    enum class CacheEntryKind : uint8_t {
+        kAddresses,
+        kNxDomain,// 域名不存在
+        kNoData,  // 域名存在但没有所查询类型的记录
+    };
+
+    // lookup()的结果
+    struct CacheLookup {
+        bool hit{false};    // 命中；否定条目的ips为空
+        bool stale{false};  // 返回的是已过期的旧地址
+        bool refresh{false};// 调用方应在后台重新解析该主机名（同一条目短时间内只提示一次）
+        CacheEntryKind kind{CacheEntryKind::kAddresses};
+    };
+
     /**
      * DNS缓存接口
      */
     class ICache {
     public:
+        // 遍历回调：主机名、地址与绝对过期时间
+        using EntryVisitor = std::function<void(const std::string &hostname, const AddressList &ips,
+                                                std::chrono::system_clock::time_point expire_time)>;
+
         virtual ~ICache() = default;
-        virtual bool get(const std::string &hostname, std::vector<std::string> &ips) = 0;
-        virtual void update(const std::string &hostname, const std::vector<std::string> &ips) = 0;
+        // 命中时ips与缓存条目共享同一地址快照，不复制地址；否定条目不算命中
+        virtual bool get(const std::string &hostname, AddressList &ips) = 0;
+        // 与get()相同，但以规范化的主机名查询（实现可复用key.hash），按刷新策略返回过期的热点条目并给出刷新提示；
+        // 默认实现不支持刷新
+        virtual CacheLookup lookup(const HostnameKey &key, AddressList &ips) {
+            return {.hit = get(key.name, ips)};
+        }
+        // 批量lookup()：ips与results按下标与keys对应，实现应尽量合并加锁；默认实现逐个查询
+        virtual void lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                                std::span<CacheLookup> results) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                results[i] = lookup(keys[i], ips[i]);
+            }
+        }
+        // ttl为该条目的生存时间，负值表示使用缓存的默认TTL；0表示不缓存（RFC 1035），同名的旧条目被移除
+        virtual void update(const std::string &hostname, const AddressList &ips,
+                            std::chrono::milliseconds ttl) = 0;
+        // 写入新地址并通过old_ips返回旧地址（仅在旧条目存在且未过期或仍可作为过期地址返回时返回true），
+        // 只加锁一次且不计入命中统计
+        virtual bool exchange(const std::string &hostname, const AddressList &ips,
+                              std::chrono::milliseconds ttl, AddressList &old_ips) = 0;
+        // 写入否定条目（替换同名的地址条目），ttl必须为正；否定条目不参与serve-stale与后台刷新。
+        // 默认实现不缓存否定应答
+        virtual void updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) {
+            (void) hostname;
+            (void) kind;
+            (void) ttl;
+        }
+        // 仅在条目不存在或已过期时写入（快照预热等不应覆盖较新应答的场景），返回是否写入
+        virtual bool insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) {
+            AddressList existing;
+            if (get(hostname, existing)) {
+                return false;
+            }
+            update(hostname, ips, ttl);
+            return ttl.count() != 0;
+        }
         virtual void remove(const std::string &hostname) = 0;
         virtual void clear() = 0;
         virtual size_t size() const = 0;
         virtual double hit_rate() const = 0;
+        // 批量回收已过期条目（单次最多max_entries个），由processEvents()周期性调用，返回回收数量
+        virtual size_t purgeExpired(size_t max_entries) = 0;
+        // 遍历未过期的地址条目（用于持久化快照），回调不在缓存锁内执行；默认实现不支持遍历
+        virtual void forEach(const EntryVisitor &visitor) const {
+            (void) visitor;
+        }
+        // 运行时应用新的容量、默认TTL与刷新策略，已缓存的条目保留；默认实现忽略配置变更
+        virtual void updateConfig(const CacheConfig &config) {
+            (void) config;
+        }
     };
 }// namespace leigod::dns
@@ -2,6 +2,7 @@
 
 #include "Common.h"
 #include <functional>
+#include <memory>
 
 namespace leigod::dns {
     struct DNSResolverConfig;
@@ -13,6 +14,10 @@ namespace leigod::dns {
     public:
         virtual ~IConfigManager() = default;
         virtual DNSResolverConfig getConfig() const = 0;
+        // 不可变的配置快照，热路径上以此代替按值复制整个配置；默认实现每次复制一份
+        virtual std::shared_ptr<const DNSResolverConfig> getConfigSnapshot() const {
+            return std::make_shared<const DNSResolverConfig>(getConfig());
+        }
         virtual void updateConfig(const DNSResolverConfig &config) = 0;
         virtual void registerConfigChangeHandler(
                 std::function<void(const DNSResolverConfig &)> handler) = 0;
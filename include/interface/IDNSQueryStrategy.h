@@ -1,17 +1,36 @@
 #pragma once
 
 #include "Common.h"
+#include "IEventLoop.h"
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace leigod::dns {
     class IDNSQueryStrategy {
     public:
-        using DNSQueryCallback = std::function<void(ResolveResult)>;
+        using DNSQueryCallback = std::function<void(const ResolveResult &)>;
         virtual ~IDNSQueryStrategy() = default;
         virtual void query(const std::string &hostname, DNSQueryCallback callback) = 0;
-        virtual void processEvents() = 0;
+        // 只查询指定地址族（AF_INET、AF_INET6或AF_UNSPEC）；默认实现忽略family，按策略自身的配置查询
+        virtual void query(const std::string &hostname, int family, DNSQueryCallback callback) {
+            (void) family;
+            query(hostname, std::move(callback));
+        }
+        // 处理网络事件，最多阻塞max_wait（调用方据此合并自身定时器的截止时间）
+        virtual void processEvents(std::chrono::milliseconds max_wait) = 0;
+        // 处理外部reactor报告的单个套接字就绪事件
+        virtual void processSocket(SocketHandle socket, bool readable, bool writable) = 0;
+        // 距离下一个内部超时的时间，不超过max_wait
+        virtual std::chrono::milliseconds nextTimeout(std::chrono::milliseconds max_wait) = 0;
+        // 驱动该策略的事件循环，托管模式通过它阻塞等待与唤醒
+        virtual std::shared_ptr<IEventLoop> eventLoop() const = 0;
         virtual void shutdown() = 0;
         virtual bool isInitialized() const = 0;
+        // 运行时应用配置变更，可在任意线程调用；默认实现忽略变更
+        virtual void updateConfig(const DNSResolverConfig &config) {
+            (void) config;
+        }
     };
 }// namespace leigod::dns
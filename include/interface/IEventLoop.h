@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace leigod::dns {
+
+#ifdef _WIN32
+    using SocketHandle = uintptr_t;
+#else
+    using SocketHandle = int;
+#endif
+
+    /**
+     * 事件循环接口
+     * 查询策略通过c-ares的套接字状态回调把关注的事件同步到事件循环中。
+     * 接入调用方自有的reactor时：updateSocket()把套接字注册到该reactor，wait()立即返回，
+     * reactor在套接字就绪时调用DNSResolver::processSocket()，并按DNSResolver::nextTimeout()设置定时器调用processEvents()
+     */
+    class IEventLoop {
+    public:
+        using ReadyHandler = std::function<void(SocketHandle socket, bool readable, bool writable)>;
+
+        virtual ~IEventLoop() = default;
+
+        // 注册、更新或注销（readable与writable均为false）套接字关注的事件，需线程安全
+        virtual void updateSocket(SocketHandle socket, bool readable, bool writable) = 0;
+
+        // 等待至多timeout，对每个就绪的套接字调用handler，返回就绪套接字数量
+        virtual int wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) = 0;
+
+        // 当前关注的套接字数量
+        virtual size_t socketCount() const = 0;
+
+        // 从其他线程唤醒阻塞中的wait()，需线程安全
+        virtual void wakeup() = 0;
+    };
+
+}// namespace leigod::dns
@@ -11,11 +11,11 @@ namespace leigod::dns {
      */
     struct DNSAddressEvent {
         std::string hostname;
-        std::vector<std::string> old_addresses;
-        std::vector<std::string> new_addresses;
+        AddressList old_addresses;
+        AddressList new_addresses;
         std::chrono::system_clock::time_point timestamp;
         std::string source;
-        int64_t ttl;
+        int64_t ttl;// 缓存实际使用的TTL，in milliseconds
         std::string record_type;
         bool is_authoritative;
     };
@@ -25,7 +25,7 @@ namespace leigod::dns {
         virtual ~IEventPublisher() = default;
         virtual void publishAddressChanged(const DNSAddressEvent &event) = 0;
         virtual void publishQueryStarted(const std::string &hostname) = 0;
-        virtual void publishQueryCompleted(const std::string &hostname, const std::vector<std::string> &ips,
+        virtual void publishQueryCompleted(const std::string &hostname, const AddressList &ips,
                                            bool success) = 0;
     };
 }// namespace leigod::dns
@@ -22,6 +22,12 @@ namespace leigod::dns {
 
         virtual void log(int level, const char *file, const char *func, int line, const std::string &message) const = 0;
 
+        // 该级别的日志是否会被输出：DNS_LOGGER_*宏在格式化消息之前调用，实现方按自身的级别过滤覆盖
+        virtual bool shouldLog(int level) const {
+            (void) level;
+            return true;
+        }
+
         void trace(const char *file, const char *func, int line, const std::string &message) const {
             log(Level::kTRACE, file, func, line, message);
         }
@@ -50,26 +56,48 @@ namespace leigod::dns {
 }// namespace leigod::dns
 
 
+// 编译期最低日志级别：低于该级别的日志语句连同参数求值与格式化一起被编译器消除
+#ifndef DNS_LOGGER_MIN_LEVEL
+#define DNS_LOGGER_MIN_LEVEL 0
+#endif
+
+// 先按编译期与运行期级别过滤，通过后才格式化消息
+#define DNS_LOGGER_LOG_IMPL(log, level, method, fmt, ...)                                                   \
+    do {                                                                                                     \
+        if constexpr ((level) >= DNS_LOGGER_MIN_LEVEL) {                                                     \
+            const auto &dns_logger_ = (log);                                                                 \
+            if (dns_logger_ && dns_logger_->shouldLog(level)) {                                              \
+                dns_logger_->method(__FILE__, __func__, __LINE__, std::format(fmt __VA_OPT__(, ) __VA_ARGS__)); \
+            }                                                                                                \
+        }                                                                                                    \
+    } while (0)
+
 #ifndef DNS_LOGGER_TRACE
-#define DNS_LOGGER_TRACE(log, fmt, ...) (log)->trace(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_TRACE(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kTRACE, trace, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #ifndef DNS_LOGGER_DEBUG
-#define DNS_LOGGER_DEBUG(log, fmt, ...) (log)->debug(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_DEBUG(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kDEBUG, debug, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #ifndef DNS_LOGGER_INFO
-#define DNS_LOGGER_INFO(log, fmt, ...) (log)->info(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_INFO(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kINFO, info, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #ifndef DNS_LOGGER_WARN
-#define DNS_LOGGER_WARN(log, fmt, ...) (log)->warn(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_WARN(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kWARNING, warn, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #ifndef DNS_LOGGER_ERROR
-#define DNS_LOGGER_ERROR(log, fmt, ...) (log)->error(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_ERROR(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kERROR, error, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #ifndef DNS_LOGGER_CRITICAL
-#define DNS_LOGGER_CRITICAL(log, fmt, ...) (log)->critical(__FILE__, __func__, __LINE__, std::format(fmt, __VA_ARGS__))
+#define DNS_LOGGER_CRITICAL(log, fmt, ...) \
+    DNS_LOGGER_LOG_IMPL(log, ::leigod::dns::ILogger::kCRITICAL, critical, fmt __VA_OPT__(, ) __VA_ARGS__)
 #endif
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Common.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -37,6 +41,24 @@ namespace leigod::dns {
         double min() const { return min_; }
         double max() const { return max_; }
 
+        // 合并另一组统计（Chan并行算法），用于汇总各线程分片
+        void merge(const RunningStats &other) {
+            if (other.count_ == 0) {
+                return;
+            }
+            if (count_ == 0) {
+                *this = other;
+                return;
+            }
+            const double count = count_ + other.count_;
+            const double delta = other.mean_ - mean_;
+            mean_ += delta * other.count_ / count;
+            m2_ += other.m2_ + delta * delta * count_ * other.count_ / count;
+            count_ = count;
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+
         void reset() {
             count_ = 0;
             mean_ = 0;
@@ -46,6 +68,146 @@ namespace leigod::dns {
         }
     };
 
+    /**
+     * 对数-线性延迟直方图（in microseconds）
+     * 每个2的幂区间再线性划分为SUB_BUCKETS个子桶，相对误差不超过1/SUB_BUCKETS；
+     * 内存固定，记录只做relaxed原子自增（无锁），多个直方图及其快照可以合并
+     */
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+        // 可区分的最大值为2^MAX_EXPONENT-1微秒（约19小时），更大的值计入最后一个桶
+        static constexpr unsigned MAX_EXPONENT = 36;
+        static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+        static constexpr size_t bucketIndex(uint64_t value) {
+            if (value < SUB_BUCKETS) {
+                return static_cast<size_t>(value);
+            }
+            const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+            if (exponent >= MAX_EXPONENT) {
+                return BUCKET_COUNT - 1;
+            }
+            const unsigned shift = exponent - SUB_BUCKET_BITS;
+            return static_cast<size_t>(SUB_BUCKETS + shift * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+        }
+
+        // 桶i覆盖的取值范围为[bucketLowerBound(i), bucketUpperBound(i))
+        static constexpr uint64_t bucketLowerBound(size_t index) {
+            if (index < SUB_BUCKETS) {
+                return index;
+            }
+            const size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+            const uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+            return (SUB_BUCKETS + sub) << shift;
+        }
+
+        static constexpr uint64_t bucketUpperBound(size_t index) {
+            if (index < SUB_BUCKETS) {
+                return index + 1;
+            }
+            return bucketLowerBound(index) + (uint64_t{1} << ((index - SUB_BUCKETS) / SUB_BUCKETS));
+        }
+
+        /**
+         * 直方图的非原子快照，可拷贝、可合并，用于查询分位数与导出
+         */
+        struct Snapshot {
+            std::vector<uint64_t> buckets = std::vector<uint64_t>(BUCKET_COUNT, 0);
+            uint64_t count{0};
+            uint64_t sum{0};
+            uint64_t min{std::numeric_limits<uint64_t>::max()};
+            uint64_t max{0};
+
+            void merge(const Snapshot &other) {
+                for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                    buckets[i] += other.buckets[i];
+                }
+                count += other.count;
+                sum += other.sum;
+                min = std::min(min, other.min);
+                max = std::max(max, other.max);
+            }
+
+            double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+
+            // 分位数q∈[0,1]，返回所在桶的中点并钳制到观测到的[min, max]
+            uint64_t percentile(double q) const {
+                if (count == 0) {
+                    return 0;
+                }
+                const auto rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * count));
+                uint64_t seen = 0;
+                for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                    seen += buckets[i];
+                    if (seen >= std::max<uint64_t>(rank, 1)) {
+                        const uint64_t mid = bucketLowerBound(i) + (bucketUpperBound(i) - bucketLowerBound(i) - 1) / 2;
+                        return std::clamp(mid, min, max);
+                    }
+                }
+                return max;
+            }
+
+            // 不超过value的样本数：只计入整个区间都不超过value的桶，误差不超过一个桶宽
+            uint64_t countAtOrBelow(uint64_t value) const {
+                uint64_t result = 0;
+                for (size_t i = 0; i < BUCKET_COUNT && bucketUpperBound(i) - 1 <= value; ++i) {
+                    result += buckets[i];
+                }
+                return result;
+            }
+        };
+
+        LatencyHistogram() = default;
+        LatencyHistogram(const LatencyHistogram &) = delete;
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+        void record(uint64_t value) {
+            buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+
+            auto current_min = min_.load(std::memory_order_relaxed);
+            while (value < current_min && !min_.compare_exchange_weak(current_min, value, std::memory_order_relaxed)) {
+            }
+            auto current_max = max_.load(std::memory_order_relaxed);
+            while (value > current_max && !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        // 并发记录时快照的各字段之间可能相差正在进行中的少量样本
+        Snapshot snapshot() const {
+            Snapshot result;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+                result.count += result.buckets[i];
+            }
+            result.sum = sum_.load(std::memory_order_relaxed);
+            result.min = min_.load(std::memory_order_relaxed);
+            result.max = max_.load(std::memory_order_relaxed);
+            return result;
+        }
+
+        void mergeInto(Snapshot &target) const {
+            target.merge(snapshot());
+        }
+
+        void reset() {
+            for (auto &bucket: buckets_) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            sum_.store(0, std::memory_order_relaxed);
+            min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+        std::atomic<uint64_t> max_{0};
+    };
+
     /**
      * DNS解析器度量指标接口
      */
@@ -62,7 +224,7 @@ namespace leigod::dns {
             std::chrono::system_clock::time_point last_cache_miss_time;
             std::chrono::system_clock::time_point last_retry_time;
             RunningStats running_stats{};
-            double avg_resolution_time{};
+            double avg_resolution_time{};// in microseconds
         };
 
         // 服务器延迟统计信息
@@ -83,6 +245,21 @@ namespace leigod::dns {
             std::string last_detail;
         };
 
+        // 对冲请求事件
+        enum class HedgeOutcome : uint8_t {
+            kSent,           // 首个请求超过对冲延迟未应答，已向第二个服务器发出对冲请求
+            kWon,            // 对冲请求先于首个请求返回应答
+            kBudgetExhausted,// 达到对冲延迟但对冲预算已耗尽，未发出对冲请求
+        };
+
+        // 准入队列事件
+        enum class AdmissionOutcome : uint8_t {
+            kQueued,  // 上游查询已达并发上限，进入准入队列
+            kAdmitted,// 出队并发出上游查询
+            kExpired, // 排队超过queue_timeout_ms，以ARES_ETIMEOUT失败
+            kRejected,// 准入队列已满（或被更高优先级的查询挤出），以ARES_EOF失败
+        };
+
         // 综合统计信息
         struct Stats {
             uint64_t total_queries{0};
@@ -90,14 +267,28 @@ namespace leigod::dns {
             uint64_t failed_queries{0};
             uint64_t cache_hits{0};
             uint64_t cache_misses{0};
+            uint64_t negative_cache_hits{0};// 命中否定条目（NXDOMAIN/NODATA），不计入cache_hits
             uint64_t total_retries{0};
+            uint64_t hedged_queries{0};
+            uint64_t hedge_wins{0};
+            uint64_t hedges_suppressed{0};
+            uint64_t admission_queued{0};
+            uint64_t admission_expired{0};
+            uint64_t admission_rejected{0};
+            uint64_t admission_queue_depth{0};// 最近一次准入队列事件后的队列深度
             double cache_hit_rate{0.0};
             double avg_query_time_ms{0.0};
             double query_time_stddev_ms{0.0};
             int min_query_time_ms{0};
             int max_query_time_ms{0};
 
-            std::map<std::string, double> server_latencies;
+            // 延迟分布（in microseconds），可直接查询分位数
+            LatencyHistogram::Snapshot query_time_us;
+            LatencyHistogram::Snapshot cache_hit_time_us;
+            LatencyHistogram::Snapshot admission_wait_us;// 出队查询在准入队列中的等待时间
+            std::map<std::string, LatencyHistogram::Snapshot> server_latency_us;
+
+            std::map<std::string, double> server_latencies;// 平均延迟，in milliseconds
             std::map<std::string, std::vector<uint32_t>> retry_attempts;
             std::map<std::string, ErrorStats> error_stats;
             std::map<std::string, HostStats> hostname_stats;
@@ -106,12 +297,17 @@ namespace leigod::dns {
         virtual ~IMetrics() = default;
 
         // 核心记录方法
+        // 耗时与延迟均为微秒
         virtual void recordQuery(const std::string &hostname, int64_t duration, bool success) = 0;
-        virtual void recordCacheHit(const std::string &hostname) = 0;
+        virtual void recordCacheHit(const std::string &hostname, int64_t duration) = 0;
         virtual void recordCacheMiss(const std::string &hostname) = 0;
+        virtual void recordNegativeCacheHit(const std::string &hostname, int64_t duration) = 0;
         virtual void recordServerLatency(const std::string &server, int64_t latency) = 0;
         virtual void recordError(const std::string &type, const std::string &detail) = 0;
         virtual void recordRetry(const std::string &hostname, uint32_t attempt) = 0;
+        virtual void recordHedge(HedgeOutcome outcome) = 0;
+        // queue_depth为事件发生后的队列深度；wait_time为排队时间（微秒），kQueued与kRejected时为0
+        virtual void recordAdmission(AdmissionOutcome outcome, size_t queue_depth, int64_t wait_time) = 0;
 
         // 统计查询方法
         virtual Stats getStats() const = 0;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <format>
+#include <initializer_list>
+#include <iosfwd>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace leigod::dns {
+
+    /**
+     * 二进制IP地址：16字节地址 + 地址族，可平凡拷贝
+     * 只在需要时（日志、事件输出、序列化）才格式化为字符串
+     */
+    class IPAddress {
+    public:
+        enum class Family : uint8_t {
+            kNone,
+            kIPv4,
+            kIPv6,
+        };
+
+        // 最长的文本形式（含结尾'\0'），与INET6_ADDRSTRLEN一致
+        static constexpr size_t MAX_STRING_LENGTH = 46;
+
+        IPAddress() = default;
+
+        // 从网络字节序的in_addr / in6_addr构造
+        static IPAddress fromIPv4(const void *in_addr);
+        static IPAddress fromIPv6(const void *in6_addr);
+        // 解析文本形式的地址，失败时返回空
+        static std::optional<IPAddress> parse(std::string_view text);
+
+        Family family() const { return family_; }
+        bool isIPv4() const { return family_ == Family::kIPv4; }
+        bool isIPv6() const { return family_ == Family::kIPv6; }
+        // 对应的AF_INET / AF_INET6，未设置时返回AF_UNSPEC
+        int addressFamily() const;
+        // 地址字节：IPv4占前4字节，IPv6占全部16字节
+        const uint8_t *data() const { return bytes_.data(); }
+        size_t length() const { return isIPv4() ? 4 : isIPv6() ? 16 : 0; }
+
+        // 格式化到调用方提供的缓冲区，不分配内存
+        std::string_view format(std::array<char, MAX_STRING_LENGTH> &buffer) const;
+        std::string toString() const;
+
+        bool operator==(const IPAddress &) const = default;
+        auto operator<=>(const IPAddress &) const = default;
+
+    private:
+        std::array<uint8_t, 16> bytes_{};
+        Family family_{Family::kNone};
+    };
+
+    /**
+     * 不可变的地址列表快照
+     * 地址以内联数组保存在单个引用计数块中，拷贝只增加引用计数；
+     * 缓存条目、解析结果和事件共享同一快照，缓存命中不产生堆分配
+     */
+    class AddressList {
+    public:
+        using value_type = IPAddress;
+        using const_iterator = const IPAddress *;
+
+        // 单个快照块内联保存的地址数，超出时溢出到堆上的数组
+        static constexpr size_t INLINE_CAPACITY = 8;
+
+    private:
+        struct Storage {
+            std::array<IPAddress, INLINE_CAPACITY> inline_addresses{};
+            std::vector<IPAddress> overflow;
+            size_t size{0};
+
+            const IPAddress *data() const {
+                return size <= INLINE_CAPACITY ? inline_addresses.data() : overflow.data();
+            }
+        };
+
+    public:
+        /**
+         * 地址列表构建器：逐个追加地址后通过build()生成快照
+         */
+        class Builder {
+        public:
+            Builder() : storage_(std::make_shared<Storage>()) {}
+            void push_back(const IPAddress &address);
+            size_t size() const { return storage_->size; }
+            AddressList build() && { return AddressList(std::move(storage_)); }
+
+        private:
+            std::shared_ptr<Storage> storage_;
+        };
+
+        AddressList() = default;
+        AddressList(std::initializer_list<IPAddress> addresses);
+
+        // 文本形式与二进制形式的互相转换，无法解析的地址被忽略
+        static AddressList fromStrings(const std::vector<std::string> &addresses);
+        std::vector<std::string> toStrings() const;
+
+        const_iterator begin() const { return storage_ ? storage_->data() : nullptr; }
+        const_iterator end() const { return storage_ ? storage_->data() + storage_->size : nullptr; }
+        size_t size() const { return storage_ ? storage_->size : 0; }
+        bool empty() const { return size() == 0; }
+        const IPAddress &operator[](size_t index) const { return begin()[index]; }
+        const IPAddress &front() const { return *begin(); }
+
+        // 共享同一快照时无需逐个比较
+        bool operator==(const AddressList &other) const;
+
+    private:
+        explicit AddressList(std::shared_ptr<const Storage> storage) : storage_(std::move(storage)) {}
+
+        std::shared_ptr<const Storage> storage_;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const IPAddress &address);
+
+    // JSON中以文本形式表示
+    void to_json(nlohmann::json &j, const IPAddress &address);
+    void from_json(const nlohmann::json &j, IPAddress &address);
+    void to_json(nlohmann::json &j, const AddressList &addresses);
+    void from_json(const nlohmann::json &j, AddressList &addresses);
+
+}// namespace leigod::dns
+
+template<>
+struct std::formatter<leigod::dns::IPAddress> : std::formatter<std::string_view> {
+    auto format(const leigod::dns::IPAddress &address, std::format_context &ctx) const {
+        std::array<char, leigod::dns::IPAddress::MAX_STRING_LENGTH> buffer{};
+        return std::formatter<std::string_view>::format(address.format(buffer), ctx);
+    }
+};
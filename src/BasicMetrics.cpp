@@ -1,75 +1,307 @@
 #include "BasicMetrics.h"
 #include <algorithm>
+#include <array>
 #include <format>
 #include <sstream>
 
 namespace leigod::dns {
 
+    namespace {
+        // 实例ID从1开始分配，0表示线程本地缓存尚未绑定实例
+        std::atomic<uint64_t> next_metrics_id{1};
+
+        // 分片计数器只有所属线程写入，普通的读-写即可，无需原子读改写指令
+        template<typename T>
+        void add(std::atomic<T> &counter, T value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        void increment(std::atomic<uint64_t> &counter) {
+            add<uint64_t>(counter, 1);
+        }
+
+        uint64_t hostWeight(const IMetrics::HostStats &stats) {
+            return stats.query_count + stats.cache_hits + stats.cache_misses + stats.retry_count;
+        }
+
+        uint64_t toHistogramValue(int64_t duration) {
+            return static_cast<uint64_t>(std::max<int64_t>(duration, 0));
+        }
+
+        // Prometheus直方图的桶上界（in microseconds），从100us到5s
+        constexpr std::array<uint64_t, 15> PROMETHEUS_BUCKETS_US = {
+                100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+                100000, 250000, 500000, 1000000, 2500000, 5000000};
+
+        void writeHistogram(std::stringstream &ss, const std::string &name, const std::string &labels,
+                            const LatencyHistogram::Snapshot &snapshot) {
+            const auto prefix = labels.empty() ? std::string{} : labels + ",";
+            for (auto bound: PROMETHEUS_BUCKETS_US) {
+                ss << name << "_bucket{" << prefix << "le=\"" << bound << "\"} "
+                   << snapshot.countAtOrBelow(bound) << "\n";
+            }
+            ss << name << "_bucket{" << prefix << "le=\"+Inf\"} " << snapshot.count << "\n";
+
+            const auto suffix = labels.empty() ? std::string{} : "{" + labels + "}";
+            ss << name << "_sum" << suffix << " " << snapshot.sum << "\n"
+               << name << "_count" << suffix << " " << snapshot.count << "\n";
+        }
+    }// namespace
+
+    BasicMetrics::HeavyHitters::HeavyHitters(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {
+        entries_.reserve(capacity_);
+        index_.reserve(capacity_);
+        heap_.reserve(capacity_);
+        position_.reserve(capacity_);
+    }
+
+    IMetrics::HostStats &BasicMetrics::HeavyHitters::touch(const std::string &hostname) {
+        if (auto it = index_.find(hostname); it != index_.end()) {
+            auto &entry = entries_[it->second];
+            ++entry.weight;
+            siftDown(position_[it->second]);
+            return entry.stats;
+        }
+
+        if (entries_.size() < capacity_) {
+            const size_t slot = entries_.size();
+            auto &entry = entries_.emplace_back();
+            entry.hostname = hostname;
+            entry.weight = 1;
+            index_.emplace(entry.hostname, slot);
+            position_.push_back(heap_.size());
+            heap_.push_back(slot);
+            siftUp(heap_.size() - 1);
+            return entry.stats;
+        }
+
+        // 替换计数最小的条目（堆顶），新条目继承其计数
+        const size_t slot = heap_.front();
+        auto &victim = entries_[slot];
+        index_.erase(victim.hostname);
+        victim.error = victim.weight;
+        victim.weight += 1;
+        victim.hostname = hostname;
+        victim.stats = HostStats{};
+        index_.emplace(victim.hostname, slot);
+        siftDown(0);
+        return victim.stats;
+    }
+
+    void BasicMetrics::HeavyHitters::clear() {
+        index_.clear();
+        entries_.clear();
+        heap_.clear();
+        position_.clear();
+    }
+
+    void BasicMetrics::HeavyHitters::swapHeap(size_t a, size_t b) {
+        std::swap(heap_[a], heap_[b]);
+        position_[heap_[a]] = a;
+        position_[heap_[b]] = b;
+    }
+
+    void BasicMetrics::HeavyHitters::siftUp(size_t position) {
+        while (position > 0) {
+            const size_t parent = (position - 1) / 2;
+            if (weightAt(parent) <= weightAt(position)) {
+                return;
+            }
+            swapHeap(parent, position);
+            position = parent;
+        }
+    }
+
+    void BasicMetrics::HeavyHitters::siftDown(size_t position) {
+        for (;;) {
+            const size_t left = 2 * position + 1;
+            const size_t right = left + 1;
+            size_t smallest = position;
+            if (left < heap_.size() && weightAt(left) < weightAt(smallest)) {
+                smallest = left;
+            }
+            if (right < heap_.size() && weightAt(right) < weightAt(smallest)) {
+                smallest = right;
+            }
+            if (smallest == position) {
+                return;
+            }
+            swapHeap(position, smallest);
+            position = smallest;
+        }
+    }
+
+    BasicMetrics::BasicMetrics(std::shared_ptr<ILogger> logger)
+        : id_(next_metrics_id.fetch_add(1, std::memory_order_relaxed)),
+          max_latency_us_(std::chrono::duration_cast<std::chrono::microseconds>(AlertThresholds{}.max_latency).count()),
+          last_performance_update_(std::chrono::steady_clock::now()),
+          logger_(std::move(logger)) {}
+
+    BasicMetrics::Shard &BasicMetrics::localShard() {
+        // 最近使用的实例缓存：通常整个进程只有一个BasicMetrics实例
+        thread_local uint64_t cached_id = 0;
+        thread_local Shard *cached_shard = nullptr;
+
+        if (cached_id != id_) {
+            // 本线程持有的分片，线程退出时交还
+            struct ThreadShards {
+                std::unordered_map<uint64_t, std::shared_ptr<Shard>> shards;
+
+                ~ThreadShards() {
+                    for (const auto &[id, shard]: shards) {
+                        shard->owned.store(false, std::memory_order_release);
+                    }
+                }
+            };
+            thread_local ThreadShards thread_shards;
+
+            auto it = thread_shards.shards.find(id_);
+            if (it == thread_shards.shards.end()) {
+                // 所属实例已销毁的分片只剩本线程引用，顺带释放，避免实例更替时表无限增长
+                std::erase_if(thread_shards.shards, [](const auto &entry) { return entry.second.use_count() == 1; });
+                it = thread_shards.shards.emplace(id_, acquireShard()).first;
+            }
+            cached_id = id_;
+            cached_shard = it->second.get();
+        }
+
+        // resetStats()之后的第一次记录：由所属线程自行清零分片
+        auto &shard = *cached_shard;
+        const auto epoch = epoch_.load(std::memory_order_acquire);
+        if (shard.epoch.load(std::memory_order_relaxed) != epoch) {
+            shard.total_queries.store(0, std::memory_order_relaxed);
+            shard.successful_queries.store(0, std::memory_order_relaxed);
+            shard.failed_queries.store(0, std::memory_order_relaxed);
+            shard.cache_hits.store(0, std::memory_order_relaxed);
+            shard.cache_misses.store(0, std::memory_order_relaxed);
+            shard.negative_cache_hits.store(0, std::memory_order_relaxed);
+            shard.total_retries.store(0, std::memory_order_relaxed);
+            shard.hedged_queries.store(0, std::memory_order_relaxed);
+            shard.hedge_wins.store(0, std::memory_order_relaxed);
+            shard.hedges_suppressed.store(0, std::memory_order_relaxed);
+            shard.admission_queued.store(0, std::memory_order_relaxed);
+            shard.admission_expired.store(0, std::memory_order_relaxed);
+            shard.admission_rejected.store(0, std::memory_order_relaxed);
+            shard.duration_sum.store(0, std::memory_order_relaxed);
+            shard.duration_sq_sum.store(0, std::memory_order_relaxed);
+            shard.duration_min.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+            shard.duration_max.store(0, std::memory_order_relaxed);
+            shard.query_time.reset();
+            shard.cache_hit_time.reset();
+            shard.hosts.clear();
+            shard.records_since_publish = 0;
+            {
+                std::lock_guard<std::mutex> lock(shard.published_mutex);
+                shard.published_hosts.clear();
+            }
+            shard.epoch.store(epoch, std::memory_order_release);
+        }
+        return shard;
+    }
+
+    std::shared_ptr<BasicMetrics::Shard> BasicMetrics::acquireShard() {
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        // 接管的分片保留原有计数（继续计入汇总结果），统计周期不同时由localShard()清零
+        for (const auto &shard: shards_) {
+            if (!shard->owned.load(std::memory_order_acquire)) {
+                shard->owned.store(true, std::memory_order_relaxed);
+                return shard;
+            }
+        }
+        shards_.push_back(std::make_shared<Shard>(epoch_.load(std::memory_order_acquire)));
+        return shards_.back();
+    }
+
+    IMetrics::HostStats &BasicMetrics::touchHost(Shard &shard, const std::string &hostname) {
+        ++shard.records_since_publish;
+        return shard.hosts.touch(hostname);
+    }
+
+    void BasicMetrics::publishHosts(Shard &shard, bool force) {
+        if (!force && shard.records_since_publish < HOST_PUBLISH_INTERVAL) {
+            return;
+        }
+
+        // 读取方持有锁时跳过本次发布，记录路径从不等待
+        if (!shard.published_mutex.try_lock()) {
+            return;
+        }
+        shard.published_hosts = shard.hosts.entries();
+        shard.published_mutex.unlock();
+        shard.records_since_publish = 0;
+    }
+
     void BasicMetrics::recordQuery(const std::string &hostname, int64_t duration, bool success) {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
+            auto &shard = localShard();
 
             // 更新基本计数器
-            ++total_queries_;
-            if (success) {
-                ++successful_queries_;
-            } else {
-                ++failed_queries_;
-            }
-
-            auto duration_ms = static_cast<double>(duration);
+            increment(shard.total_queries);
+            increment(success ? shard.successful_queries : shard.failed_queries);
 
             // 更新查询时间统计
-            query_stats_.update(duration_ms);
+            const auto duration_us = static_cast<double>(duration);
+            add(shard.duration_sum, duration_us);
+            add(shard.duration_sq_sum, duration_us * duration_us);
+            if (duration < shard.duration_min.load(std::memory_order_relaxed)) {
+                shard.duration_min.store(duration, std::memory_order_relaxed);
+            }
+            if (duration > shard.duration_max.load(std::memory_order_relaxed)) {
+                shard.duration_max.store(duration, std::memory_order_relaxed);
+            }
+            shard.query_time.record(toHistogramValue(duration));
 
             // 更新域名级别统计
-            auto &host_stats = hostname_stats_[hostname];
+            auto &host_stats = touchHost(shard, hostname);
             host_stats.query_count++;
             host_stats.last_query_time = std::chrono::system_clock::now();
-            host_stats.running_stats.update(duration_ms);
+            host_stats.running_stats.update(duration_us);
+            host_stats.avg_resolution_time = host_stats.running_stats.mean();
+            publishHosts(shard, false);
 
-            // 保持最近样本数量
-            query_durations_.push_back(duration_ms);
-            if (query_durations_.size() > MAX_SAMPLES) {
-                query_durations_.pop_front();
-            }
-
-            // 定期清理和更新
-            cleanupOldStats();
-            updatePerformanceMetrics();
-
-            DNS_LOGGER_DEBUG(logger_, "Recorded query for {} - duration: {}ms, success: {}",
+            DNS_LOGGER_DEBUG(logger_, "Recorded query for {} - duration: {}us, success: {}",
                              hostname, duration, success);
         } catch (const std::exception &e) {
             DNS_LOGGER_ERROR(logger_, "Error recording query: {}", e.what());
         }
     }
 
-    void BasicMetrics::recordCacheHit(const std::string &hostname) {
+    void BasicMetrics::recordCacheHit(const std::string &hostname, int64_t duration) {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
-            ++cache_hits_;
+            auto &shard = localShard();
+            increment(shard.cache_hits);
+            shard.cache_hit_time.record(toHistogramValue(duration));
 
-            auto &host_stats = hostname_stats_[hostname];
+            auto &host_stats = touchHost(shard, hostname);
             host_stats.cache_hits++;
             host_stats.last_cache_hit_time = std::chrono::system_clock::now();
-
-            updatePerformanceMetrics();
+            publishHosts(shard, false);
         } catch (const std::exception &e) {
             DNS_LOGGER_ERROR(logger_, "Error recording cache hit: {}", e.what());
         }
     }
 
+    void BasicMetrics::recordNegativeCacheHit(const std::string &hostname, int64_t duration) {
+        try {
+            // 否定命中同样走缓存路径，耗时计入缓存命中耗时分布；计数单独统计，不按主机名统计
+            (void) hostname;
+            auto &shard = localShard();
+            increment(shard.negative_cache_hits);
+            shard.cache_hit_time.record(toHistogramValue(duration));
+        } catch (const std::exception &e) {
+            DNS_LOGGER_ERROR(logger_, "Error recording negative cache hit: {}", e.what());
+        }
+    }
+
     void BasicMetrics::recordCacheMiss(const std::string &hostname) {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
-            ++cache_misses_;
+            auto &shard = localShard();
+            increment(shard.cache_misses);
 
-            auto &host_stats = hostname_stats_[hostname];
+            auto &host_stats = touchHost(shard, hostname);
             host_stats.cache_misses++;
             host_stats.last_cache_miss_time = std::chrono::system_clock::now();
-
-            updatePerformanceMetrics();
+            publishHosts(shard, false);
         } catch (const std::exception &e) {
             DNS_LOGGER_ERROR(logger_, "Error recording cache miss: {}", e.what());
         }
@@ -77,22 +309,28 @@ namespace leigod::dns {
 
     void BasicMetrics::recordServerLatency(const std::string &server, int64_t latency) {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto svr_latency = static_cast<double>(latency);
-            auto &server_stats = server_stats_[server];
-            server_stats.avg_latency = svr_latency;
-            server_stats.last_update_time = std::chrono::system_clock::now();
-
-            auto &latencies = server_latencies_[server];
-            latencies.push_back(svr_latency);
-            if (latencies.size() > MAX_SAMPLES) {
-                latencies.erase(latencies.begin());
+            const auto value = toHistogramValue(latency);
+            bool recorded = false;
+            {
+                std::shared_lock<std::shared_mutex> lock(server_mutex_);
+                if (auto it = server_latencies_.find(server); it != server_latencies_.end()) {
+                    it->second->record(value);
+                    recorded = true;
+                }
+            }
+            if (!recorded) {
+                std::unique_lock<std::shared_mutex> lock(server_mutex_);
+                auto &histogram = server_latencies_[server];
+                if (!histogram) {
+                    histogram = std::make_unique<LatencyHistogram>();
+                }
+                histogram->record(value);
             }
 
-            if (latency > alert_thresholds_.max_latency.count()) {
-                DNS_LOGGER_WARN(logger_, "Server {} latency ({} ms) exceeded threshold ({} ms)",
-                                server, latency,
-                                alert_thresholds_.max_latency.count());
+            const auto threshold = max_latency_us_.load(std::memory_order_relaxed);
+            if (latency > threshold) {
+                DNS_LOGGER_WARN(logger_, "Server {} latency ({} us) exceeded threshold ({} us)",
+                                server, latency, threshold);
             }
         } catch (const std::exception &e) {
             DNS_LOGGER_ERROR(logger_, "Error recording server latency: {}", e.what());
@@ -108,7 +346,7 @@ namespace leigod::dns {
             error_stats.last_occurrence = std::chrono::system_clock::now();
             error_stats.last_detail = detail;
 
-            updatePerformanceMetrics();
+            refreshPerformanceLocked();
 
             if (current_performance_.error_rate > alert_thresholds_.max_error_rate) {
                 DNS_LOGGER_WARN(logger_, "Error rate ({:.2f}%) exceeded threshold ({:.2f}%)",
@@ -122,20 +360,28 @@ namespace leigod::dns {
 
     void BasicMetrics::recordRetry(const std::string &hostname, uint32_t attempt) {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
-            ++total_retries_;
+            auto &shard = localShard();
+            increment(shard.total_retries);
 
-            auto &host_stats = hostname_stats_[hostname];
+            auto &host_stats = touchHost(shard, hostname);
             host_stats.retry_count++;
             host_stats.last_retry_time = std::chrono::system_clock::now();
+            publishHosts(shard, false);
 
-            retry_attempts_[hostname].push_back(attempt);
+            // 重试历史属于冷路径，主机数量有上限
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = retry_attempts_.find(hostname);
+            if (it == retry_attempts_.end()) {
+                if (retry_attempts_.size() >= MAX_RETRY_HOSTS) {
+                    retry_attempts_.erase(retry_attempts_.begin());
+                }
+                it = retry_attempts_.try_emplace(hostname).first;
+            }
 
-            if (retry_attempts_[hostname].size() > MAX_RETRY_HISTORY) {
-                retry_attempts_[hostname].erase(
-                        retry_attempts_[hostname].begin(),
-                        retry_attempts_[hostname].begin() +
-                                (retry_attempts_[hostname].size() - MAX_RETRY_HISTORY));
+            auto &attempts = it->second;
+            attempts.push_back(attempt);
+            if (attempts.size() > MAX_RETRY_HISTORY) {
+                attempts.erase(attempts.begin(), attempts.begin() + (attempts.size() - MAX_RETRY_HISTORY));
             }
 
             if (attempt > alert_thresholds_.max_retry_count) {
@@ -147,44 +393,199 @@ namespace leigod::dns {
         }
     }
 
+    void BasicMetrics::recordHedge(HedgeOutcome outcome) {
+        try {
+            auto &shard = localShard();
+            switch (outcome) {
+                case HedgeOutcome::kSent:
+                    increment(shard.hedged_queries);
+                    break;
+                case HedgeOutcome::kWon:
+                    increment(shard.hedge_wins);
+                    break;
+                case HedgeOutcome::kBudgetExhausted:
+                    increment(shard.hedges_suppressed);
+                    break;
+            }
+        } catch (const std::exception &e) {
+            DNS_LOGGER_ERROR(logger_, "Error recording hedge: {}", e.what());
+        }
+    }
+
+    void BasicMetrics::recordAdmission(AdmissionOutcome outcome, size_t queue_depth, int64_t wait_time) {
+        try {
+            auto &shard = localShard();
+            switch (outcome) {
+                case AdmissionOutcome::kQueued:
+                    increment(shard.admission_queued);
+                    break;
+                case AdmissionOutcome::kAdmitted:
+                    admission_wait_.record(toHistogramValue(wait_time));
+                    break;
+                case AdmissionOutcome::kExpired:
+                    increment(shard.admission_expired);
+                    break;
+                case AdmissionOutcome::kRejected:
+                    increment(shard.admission_rejected);
+                    break;
+            }
+            admission_queue_depth_.store(queue_depth, std::memory_order_relaxed);
+        } catch (const std::exception &e) {
+            DNS_LOGGER_ERROR(logger_, "Error recording admission: {}", e.what());
+        }
+    }
+
+    BasicMetrics::Totals BasicMetrics::aggregate() const {
+        Totals totals;
+        const auto epoch = epoch_.load(std::memory_order_acquire);
+
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        for (const auto &shard: shards_) {
+            // 尚未在当前统计周期内记录过的分片视为空
+            if (shard->epoch.load(std::memory_order_acquire) != epoch) {
+                continue;
+            }
+            totals.total_queries += shard->total_queries.load(std::memory_order_relaxed);
+            totals.successful_queries += shard->successful_queries.load(std::memory_order_relaxed);
+            totals.failed_queries += shard->failed_queries.load(std::memory_order_relaxed);
+            totals.cache_hits += shard->cache_hits.load(std::memory_order_relaxed);
+            totals.cache_misses += shard->cache_misses.load(std::memory_order_relaxed);
+            totals.negative_cache_hits += shard->negative_cache_hits.load(std::memory_order_relaxed);
+            totals.total_retries += shard->total_retries.load(std::memory_order_relaxed);
+            totals.hedged_queries += shard->hedged_queries.load(std::memory_order_relaxed);
+            totals.hedge_wins += shard->hedge_wins.load(std::memory_order_relaxed);
+            totals.hedges_suppressed += shard->hedges_suppressed.load(std::memory_order_relaxed);
+            totals.admission_queued += shard->admission_queued.load(std::memory_order_relaxed);
+            totals.admission_expired += shard->admission_expired.load(std::memory_order_relaxed);
+            totals.admission_rejected += shard->admission_rejected.load(std::memory_order_relaxed);
+            totals.duration_sum += shard->duration_sum.load(std::memory_order_relaxed);
+            totals.duration_sq_sum += shard->duration_sq_sum.load(std::memory_order_relaxed);
+            totals.duration_min = std::min(totals.duration_min, shard->duration_min.load(std::memory_order_relaxed));
+            totals.duration_max = std::max(totals.duration_max, shard->duration_max.load(std::memory_order_relaxed));
+        }
+        return totals;
+    }
+
+    void BasicMetrics::collectHistograms(LatencyHistogram::Snapshot &query_time,
+                                         LatencyHistogram::Snapshot &cache_hit_time) const {
+        const auto epoch = epoch_.load(std::memory_order_acquire);
+
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        for (const auto &shard: shards_) {
+            if (shard->epoch.load(std::memory_order_acquire) != epoch) {
+                continue;
+            }
+            shard->query_time.mergeInto(query_time);
+            shard->cache_hit_time.mergeInto(cache_hit_time);
+        }
+    }
+
+    std::map<std::string, LatencyHistogram::Snapshot> BasicMetrics::collectServerLatencies() const {
+        std::map<std::string, LatencyHistogram::Snapshot> result;
+        std::shared_lock<std::shared_mutex> lock(server_mutex_);
+        for (const auto &[server, histogram]: server_latencies_) {
+            result.emplace(server, histogram->snapshot());
+        }
+        return result;
+    }
+
+    std::map<std::string, IMetrics::HostStats> BasicMetrics::collectHostStats() const {
+        // 合并各分片发布的热点快照
+        std::unordered_map<std::string, HostStats> merged;
+        const auto epoch = epoch_.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            for (const auto &shard: shards_) {
+                if (shard->epoch.load(std::memory_order_acquire) != epoch) {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> published_lock(shard->published_mutex);
+                for (const auto &entry: shard->published_hosts) {
+                    auto &stats = merged[entry.hostname];
+                    stats.query_count += entry.stats.query_count;
+                    stats.cache_hits += entry.stats.cache_hits;
+                    stats.cache_misses += entry.stats.cache_misses;
+                    stats.retry_count += entry.stats.retry_count;
+                    stats.last_query_time = std::max(stats.last_query_time, entry.stats.last_query_time);
+                    stats.last_cache_hit_time = std::max(stats.last_cache_hit_time, entry.stats.last_cache_hit_time);
+                    stats.last_cache_miss_time = std::max(stats.last_cache_miss_time, entry.stats.last_cache_miss_time);
+                    stats.last_retry_time = std::max(stats.last_retry_time, entry.stats.last_retry_time);
+                    stats.running_stats.merge(entry.stats.running_stats);
+                    stats.avg_resolution_time = stats.running_stats.mean();
+                }
+            }
+        }
+
+        // 只保留全局最热的HOST_TOP_K个主机名
+        std::vector<std::pair<uint64_t, const std::string *>> ranked;
+        ranked.reserve(merged.size());
+        for (const auto &[hostname, stats]: merged) {
+            ranked.emplace_back(hostWeight(stats), &hostname);
+        }
+        if (ranked.size() > HOST_TOP_K) {
+            std::nth_element(ranked.begin(), ranked.begin() + HOST_TOP_K, ranked.end(),
+                             [](const auto &a, const auto &b) { return a.first > b.first; });
+            ranked.resize(HOST_TOP_K);
+        }
+
+        std::map<std::string, HostStats> result;
+        for (const auto &[weight, hostname]: ranked) {
+            result.emplace(*hostname, merged.at(*hostname));
+        }
+        return result;
+    }
+
     IMetrics::Stats BasicMetrics::getStats() const {
         try {
             Stats stats;
-            std::lock_guard<std::mutex> lock(mutex_);
+            const auto totals = aggregate();
 
             // 基本统计
-            stats.total_queries = total_queries_;
-            stats.successful_queries = successful_queries_;
-            stats.failed_queries = failed_queries_;
-            stats.cache_hits = cache_hits_;
-            stats.cache_misses = cache_misses_;
-            stats.total_retries = total_retries_;
+            stats.total_queries = totals.total_queries;
+            stats.successful_queries = totals.successful_queries;
+            stats.failed_queries = totals.failed_queries;
+            stats.cache_hits = totals.cache_hits;
+            stats.cache_misses = totals.cache_misses;
+            stats.negative_cache_hits = totals.negative_cache_hits;
+            stats.total_retries = totals.total_retries;
+            stats.hedged_queries = totals.hedged_queries;
+            stats.hedge_wins = totals.hedge_wins;
+            stats.hedges_suppressed = totals.hedges_suppressed;
+            stats.admission_queued = totals.admission_queued;
+            stats.admission_expired = totals.admission_expired;
+            stats.admission_rejected = totals.admission_rejected;
+            stats.admission_queue_depth = admission_queue_depth_.load(std::memory_order_relaxed);
 
             // 缓存命中率
             const double total = stats.cache_hits + stats.cache_misses;
             stats.cache_hit_rate = total > 0 ? static_cast<double>(stats.cache_hits) / total : 0;
 
             // 查询时间统计
-            if (query_stats_.count() > 0) {
-                stats.avg_query_time_ms = query_stats_.mean();
-                stats.query_time_stddev_ms = query_stats_.stddev();
-                stats.min_query_time_ms = static_cast<int>(query_stats_.min());
-                stats.max_query_time_ms = static_cast<int>(query_stats_.max());
+            if (totals.total_queries > 0) {
+                const auto count = static_cast<double>(totals.total_queries);
+                const auto mean = totals.duration_sum / count;
+                const auto variance = count > 1 ? (totals.duration_sq_sum - count * mean * mean) / (count - 1) : 0.0;
+                stats.avg_query_time_ms = mean / 1000.0;
+                stats.query_time_stddev_ms = std::sqrt(std::max(variance, 0.0)) / 1000.0;
+                stats.min_query_time_ms = static_cast<int>(totals.duration_min / 1000);
+                stats.max_query_time_ms = static_cast<int>(totals.duration_max / 1000);
             }
 
-            // 服务器延迟统计
-            for (const auto &[server, server_stat]: server_stats_) {
-                ServerStats lat_stats;
-                lat_stats.avg_latency = server_stat.avg_latency;
-                lat_stats.stddev = 0.0;// 需要计算标准差
-                lat_stats.sample_count = server_latencies_.at(server).size();
-                lat_stats.last_update_time = std::chrono::system_clock::now();
-                stats.server_latencies[server] = server_stat.avg_latency;
+            // 延迟分布
+            collectHistograms(stats.query_time_us, stats.cache_hit_time_us);
+            stats.admission_wait_us = admission_wait_.snapshot();
+            stats.server_latency_us = collectServerLatencies();
+            for (const auto &[server, snapshot]: stats.server_latency_us) {
+                stats.server_latencies[server] = snapshot.mean() / 1000.0;
             }
 
+            stats.hostname_stats = collectHostStats();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+
             // 复制其他统计数据
             stats.error_stats = error_stats_;
-            stats.hostname_stats = hostname_stats_;
             stats.retry_attempts = retry_attempts_;
 
             return stats;
@@ -196,31 +597,25 @@ namespace leigod::dns {
 
     void BasicMetrics::resetStats() {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
+            // 开始新的统计周期，各线程分片在下次记录时自行清零
+            epoch_.fetch_add(1, std::memory_order_acq_rel);
 
-            // 重置所有计数器
-            total_queries_ = 0;
-            successful_queries_ = 0;
-            failed_queries_ = 0;
-            cache_hits_ = 0;
-            cache_misses_ = 0;
-            total_retries_ = 0;
+            {
+                std::unique_lock<std::shared_mutex> server_lock(server_mutex_);
+                server_latencies_.clear();
+            }
+            admission_wait_.reset();
+
+            std::lock_guard<std::mutex> lock(mutex_);
 
             // 清空统计数据
-            query_durations_.clear();
             error_stats_.clear();
-            server_latencies_.clear();
             retry_attempts_.clear();
-            hostname_stats_.clear();
-            server_stats_.clear();
-
-            // 重置运行时统计
-            query_stats_ = RunningStats();
 
             // 重置性能指标
             current_performance_ = PerformanceMetrics{};
+            last_total_queries_ = 0;
             last_performance_update_ = std::chrono::steady_clock::now();
-            last_cleanup_ = std::chrono::steady_clock::now();
 
             DNS_LOGGER_INFO(logger_, "All metrics have been reset");
         } catch (const std::exception &e) {
@@ -231,45 +626,56 @@ namespace leigod::dns {
     std::string BasicMetrics::getPrometheusMetrics() const {
         try {
             std::stringstream ss;
-            std::lock_guard<std::mutex> lock(mutex_);
+            const auto totals = aggregate();
 
             // 基本计数器
             ss << "# TYPE dns_total_queries counter\n"
-               << "dns_total_queries " << total_queries_ << "\n"
+               << "dns_total_queries " << totals.total_queries << "\n"
                << "# TYPE dns_successful_queries counter\n"
-               << "dns_successful_queries " << successful_queries_ << "\n"
+               << "dns_successful_queries " << totals.successful_queries << "\n"
                << "# TYPE dns_failed_queries counter\n"
-               << "dns_failed_queries " << failed_queries_ << "\n"
+               << "dns_failed_queries " << totals.failed_queries << "\n"
                << "# TYPE dns_cache_hits counter\n"
-               << "dns_cache_hits " << cache_hits_ << "\n"
+               << "dns_cache_hits " << totals.cache_hits << "\n"
                << "# TYPE dns_cache_misses counter\n"
-               << "dns_cache_misses " << cache_misses_ << "\n"
+               << "dns_cache_misses " << totals.cache_misses << "\n"
+               << "# TYPE dns_negative_cache_hits counter\n"
+               << "dns_negative_cache_hits " << totals.negative_cache_hits << "\n"
                << "# TYPE dns_total_retries counter\n"
-               << "dns_total_retries " << total_retries_ << "\n";
-
-            // 查询时间直方图
-            ss << "# TYPE dns_query_time_ms histogram\n";
-            if (!query_durations_.empty()) {
-                std::vector<double> sorted_durations(query_durations_.begin(),
-                                                     query_durations_.end());
-                std::sort(sorted_durations.begin(), sorted_durations.end());
-
-                auto p50 = sorted_durations[sorted_durations.size() * 0.5];
-                auto p90 = sorted_durations[sorted_durations.size() * 0.9];
-                auto p99 = sorted_durations[sorted_durations.size() * 0.99];
-
-                ss << "dns_query_time_ms{quantile=\"0.50\"} " << p50 << "\n"
-                   << "dns_query_time_ms{quantile=\"0.90\"} " << p90 << "\n"
-                   << "dns_query_time_ms{quantile=\"0.99\"} " << p99 << "\n"
-                   << "dns_query_time_ms_count " << query_durations_.size() << "\n";
+               << "dns_total_retries " << totals.total_retries << "\n"
+               << "# TYPE dns_hedged_queries counter\n"
+               << "dns_hedged_queries " << totals.hedged_queries << "\n"
+               << "# TYPE dns_hedge_wins counter\n"
+               << "dns_hedge_wins " << totals.hedge_wins << "\n"
+               << "# TYPE dns_hedges_suppressed counter\n"
+               << "dns_hedges_suppressed " << totals.hedges_suppressed << "\n"
+               << "# TYPE dns_admission_queued counter\n"
+               << "dns_admission_queued " << totals.admission_queued << "\n"
+               << "# TYPE dns_admission_expired counter\n"
+               << "dns_admission_expired " << totals.admission_expired << "\n"
+               << "# TYPE dns_admission_rejected counter\n"
+               << "dns_admission_rejected " << totals.admission_rejected << "\n"
+               << "# TYPE dns_admission_queue_depth gauge\n"
+               << "dns_admission_queue_depth " << admission_queue_depth_.load(std::memory_order_relaxed) << "\n";
+
+            // 查询时间和缓存命中路径耗时直方图
+            LatencyHistogram::Snapshot query_time;
+            LatencyHistogram::Snapshot cache_hit_time;
+            collectHistograms(query_time, cache_hit_time);
+            ss << "# TYPE dns_query_time_us histogram\n";
+            writeHistogram(ss, "dns_query_time_us", "", query_time);
+            ss << "# TYPE dns_cache_hit_time_us histogram\n";
+            writeHistogram(ss, "dns_cache_hit_time_us", "", cache_hit_time);
+            ss << "# TYPE dns_admission_wait_us histogram\n";
+            writeHistogram(ss, "dns_admission_wait_us", "", admission_wait_.snapshot());
+
+            // 服务器延迟直方图
+            ss << "# TYPE dns_server_latency_us histogram\n";
+            for (const auto &[server, snapshot]: collectServerLatencies()) {
+                writeHistogram(ss, "dns_server_latency_us", "server=\"" + server + "\"", snapshot);
             }
 
-            // 服务器延迟
-            ss << "# TYPE dns_server_latency_ms gauge\n";
-            for (const auto &[server, stats]: server_stats_) {
-                ss << "dns_server_latency_ms{server=\"" << server
-                   << "\",type=\"avg\"} " << stats.avg_latency << "\n";
-            }
+            std::lock_guard<std::mutex> lock(mutex_);
 
             // 错误统计
             ss << "# TYPE dns_errors counter\n";
@@ -287,23 +693,22 @@ namespace leigod::dns {
 
     BasicMetrics::PerformanceMetrics BasicMetrics::getPerformanceMetrics(std::chrono::seconds window) const {
         std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        if (now - last_performance_update_ < PERFORMANCE_UPDATE_INTERVAL) {
-            return current_performance_;
-        }
-
+        refreshPerformanceLocked();
         return current_performance_;
     }
 
     void BasicMetrics::setAlertThresholds(const AlertThresholds &thresholds) {
         std::lock_guard<std::mutex> lock(mutex_);
         alert_thresholds_ = thresholds;
+        max_latency_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(thresholds.max_latency).count(),
+                              std::memory_order_relaxed);
         DNS_LOGGER_INFO(logger_, "Alert thresholds updated");
     }
 
     std::vector<std::string> BasicMetrics::checkAlertConditions() const {
         std::vector<std::string> alerts;
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshPerformanceLocked();
 
         // 检查错误率
         if (current_performance_.error_rate > alert_thresholds_.max_error_rate) {
@@ -324,7 +729,7 @@ namespace leigod::dns {
         return alerts;
     }
 
-    void BasicMetrics::updatePerformanceMetrics() {
+    void BasicMetrics::refreshPerformanceLocked() const {
         auto now = std::chrono::steady_clock::now();
         if (now - last_performance_update_ < PERFORMANCE_UPDATE_INTERVAL) {
             return;
@@ -335,57 +740,20 @@ namespace leigod::dns {
                                  .count();
 
         if (time_diff > 0) {
-            current_performance_.queries_per_second = total_queries_ * 1.0 / time_diff;
-            const auto total = cache_hits_ + cache_misses_;
-            current_performance_.cache_hit_rate = total > 0 ? cache_hits_ * 1.0 / total : 0;
-            current_performance_.avg_response_time = query_stats_.mean();
-            current_performance_.error_rate = total_queries_ > 0 ? failed_queries_ * 1.0 / total_queries_ : 0;
+            const auto totals = aggregate();
+            current_performance_.queries_per_second =
+                    static_cast<double>(totals.total_queries - std::min(last_total_queries_, totals.total_queries)) /
+                    time_diff;
+            const auto total = totals.cache_hits + totals.cache_misses;
+            current_performance_.cache_hit_rate = total > 0 ? totals.cache_hits * 1.0 / total : 0;
+            current_performance_.avg_response_time =
+                    totals.total_queries > 0 ? totals.duration_sum / totals.total_queries / 1000.0 : 0;
+            current_performance_.error_rate =
+                    totals.total_queries > 0 ? totals.failed_queries * 1.0 / totals.total_queries : 0;
             current_performance_.measurement_time = std::chrono::system_clock::now();
+            last_total_queries_ = totals.total_queries;
         }
 
         last_performance_update_ = now;
     }
-
-    void BasicMetrics::cleanupOldStats() {
-        auto now = std::chrono::steady_clock::now();
-        auto sys_now = std::chrono::system_clock::now();
-
-        if (now - last_cleanup_ < CLEANUP_INTERVAL) {
-            return;
-        }
-
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        // 清理过期的主机名统计
-        auto host_it = hostname_stats_.begin();
-        while (host_it != hostname_stats_.end()) {
-            if (sys_now - host_it->second.last_query_time > CLEANUP_INTERVAL) {
-                host_it = hostname_stats_.erase(host_it);
-            } else {
-                ++host_it;
-            }
-        }
-
-        // 清理过期的重试记录
-        auto retry_it = retry_attempts_.begin();
-        while (retry_it != retry_attempts_.end()) {
-            if (!hostname_stats_.contains(retry_it->first)) {
-                retry_it = retry_attempts_.erase(retry_it);
-            } else {
-                ++retry_it;
-            }
-        }
-
-        // 清理过期的服务器统计
-        auto server_it = server_stats_.begin();
-        while (server_it != server_stats_.end()) {
-            if (sys_now - server_it->second.last_update_time > CLEANUP_INTERVAL) {
-                server_it = server_stats_.erase(server_it);
-            } else {
-                ++server_it;
-            }
-        }
-
-        last_cleanup_ = now;
-    }
-}// namespace leigod::dns
\ No newline at end of file
+}// namespace leigod::dns
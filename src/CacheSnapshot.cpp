@@ -0,0 +1,255 @@
+#include "CacheSnapshot.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace leigod::dns {
+
+    namespace {
+        constexpr std::array<char, 8> SNAPSHOT_MAGIC = {'L', 'D', 'N', 'S', 'S', 'N', 'P', '1'};
+        constexpr size_t HEADER_SIZE = SNAPSHOT_MAGIC.size() + sizeof(uint64_t);
+        // 过期时间 + 主机名长度 + 地址数 + 保留字节
+        constexpr size_t ENTRY_HEADER_SIZE = sizeof(int64_t) + sizeof(uint16_t) + 2;
+        constexpr size_t MAX_ADDRESSES = UINT8_MAX;
+
+        template<typename T>
+        void writeValue(std::ostream &out, T value) {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        template<typename T>
+        T readValue(const uint8_t *data) {
+            T value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        void unmap(const uint8_t *data, size_t size) {
+#if defined(_WIN32)
+            (void) size;
+            UnmapViewOfFile(data);
+#else
+            munmap(const_cast<uint8_t *>(data), size);
+#endif
+        }
+
+        // 把文件内容刷到磁盘；directory为true时刷新目录项（Windows上rename的元数据由文件系统日志保证，跳过）
+        bool syncToDisk(const std::string &path, bool directory) {
+#if defined(_WIN32)
+            if (directory) {
+                return true;
+            }
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+            const bool synced = FlushFileBuffers(file) != 0;
+            CloseHandle(file);
+            return synced;
+#else
+            const int fd = ::open(path.c_str(), (directory ? O_RDONLY | O_DIRECTORY : O_WRONLY) | O_CLOEXEC);
+            if (fd < 0) {
+                return false;
+            }
+            const bool synced = fsync(fd) == 0;
+            close(fd);
+            return synced;
+#endif
+        }
+    }// namespace
+
+    CacheSnapshot::~CacheSnapshot() {
+        if (data_) {
+            unmap(data_, size_);
+        }
+    }
+
+    std::optional<size_t> CacheSnapshot::write(const std::string &path, const ICache &cache) {
+        const auto tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return std::nullopt;
+        }
+
+        out.write(SNAPSHOT_MAGIC.data(), SNAPSHOT_MAGIC.size());
+        writeValue<uint64_t>(out, 0);// 条目数在写完后回填
+
+        uint64_t count = 0;
+        cache.forEach([&](const std::string &hostname, const AddressList &ips,
+                          std::chrono::system_clock::time_point expire_time) {
+            if (hostname.size() > UINT16_MAX || ips.empty()) {
+                return;
+            }
+            const auto address_count = std::min(ips.size(), MAX_ADDRESSES);
+            const auto expire_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           expire_time.time_since_epoch())
+                                           .count();
+
+            writeValue<int64_t>(out, expire_ms);
+            writeValue<uint16_t>(out, static_cast<uint16_t>(hostname.size()));
+            writeValue<uint8_t>(out, static_cast<uint8_t>(address_count));
+            writeValue<uint8_t>(out, 0);
+            out.write(hostname.data(), static_cast<std::streamsize>(hostname.size()));
+            for (size_t i = 0; i < address_count; ++i) {
+                writeValue<uint8_t>(out, static_cast<uint8_t>(ips[i].family()));
+                out.write(reinterpret_cast<const char *>(ips[i].data()), static_cast<std::streamsize>(ips[i].length()));
+            }
+            ++count;
+        });
+
+        out.seekp(SNAPSHOT_MAGIC.size());
+        writeValue<uint64_t>(out, count);
+        out.close();
+        // rename之前先落盘：否则掉电后可能留下指向未写完数据的新文件名
+        if (!out || !syncToDisk(tmp_path, false)) {
+            std::error_code ec;
+            std::filesystem::remove(tmp_path, ec);
+            return std::nullopt;
+        }
+
+        // 同一目录内rename是原子的，读方要么看到旧快照，要么看到完整的新快照
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp_path, ec);
+            return std::nullopt;
+        }
+        // 再刷新所在目录，让rename本身持久化；失败时新快照已完整就位，只是掉电后可能回到旧快照
+        const auto directory = std::filesystem::path(path).parent_path();
+        syncToDisk(directory.empty() ? "." : directory.string(), true);
+        return count;
+    }
+
+    std::unique_ptr<CacheSnapshot> CacheSnapshot::open(const std::string &path) {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER file_size{};
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < static_cast<LONGLONG>(HEADER_SIZE)) {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            return nullptr;
+        }
+        // 视图保持对映射对象的引用，可以立即关闭句柄
+        data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (!data) {
+            return nullptr;
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+            ::close(fd);
+            return nullptr;
+        }
+        size = static_cast<size_t>(st.st_size);
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return nullptr;
+        }
+        // 条目按顺序解析，提示内核预读
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t *>(mapped);
+#endif
+
+        std::unique_ptr<CacheSnapshot> snapshot(new CacheSnapshot(data, size));
+        if (std::memcmp(data, SNAPSHOT_MAGIC.data(), SNAPSHOT_MAGIC.size()) != 0) {
+            return nullptr;
+        }
+        snapshot->entry_count_ = readValue<uint64_t>(data + SNAPSHOT_MAGIC.size());
+        snapshot->offset_ = HEADER_SIZE;
+        return snapshot;
+    }
+
+    size_t CacheSnapshot::loadInto(ICache &cache, size_t max_entries) {
+        const auto now = std::chrono::system_clock::now();
+        size_t loaded = 0;
+
+        for (size_t parsed = 0; parsed < max_entries && !finished(); ++parsed) {
+            // 任何越界都视为文件损坏（如写入中途被截断），停止解析
+            if (size_ - offset_ < ENTRY_HEADER_SIZE) {
+                corrupted_ = true;
+                offset_ = size_;
+                break;
+            }
+            const uint8_t *entry = data_ + offset_;
+            const auto expire_ms = readValue<int64_t>(entry);
+            const auto hostname_length = readValue<uint16_t>(entry + sizeof(int64_t));
+            const auto address_count = entry[sizeof(int64_t) + sizeof(uint16_t)];
+
+            size_t cursor = offset_ + ENTRY_HEADER_SIZE;
+            if (size_ - cursor < hostname_length) {
+                corrupted_ = true;
+                offset_ = size_;
+                break;
+            }
+            const std::string_view hostname(reinterpret_cast<const char *>(data_ + cursor), hostname_length);
+            cursor += hostname_length;
+
+            AddressList::Builder builder;
+            bool valid = true;
+            for (size_t i = 0; i < address_count; ++i) {
+                if (cursor >= size_) {
+                    valid = false;
+                    break;
+                }
+                const auto family = static_cast<IPAddress::Family>(data_[cursor++]);
+                const size_t length = family == IPAddress::Family::kIPv4 ? 4 : family == IPAddress::Family::kIPv6 ? 16 : 0;
+                if (length == 0 || size_ - cursor < length) {
+                    valid = false;
+                    break;
+                }
+                builder.push_back(family == IPAddress::Family::kIPv4 ? IPAddress::fromIPv4(data_ + cursor)
+                                                                     : IPAddress::fromIPv6(data_ + cursor));
+                cursor += length;
+            }
+            if (!valid) {
+                corrupted_ = true;
+                offset_ = size_;
+                break;
+            }
+            offset_ = cursor;
+
+            const auto expire_time = std::chrono::system_clock::time_point(std::chrono::milliseconds(expire_ms));
+            if (expire_time <= now || builder.size() == 0) {
+                continue;
+            }
+            const auto ttl = std::chrono::ceil<std::chrono::milliseconds>(expire_time - now);
+            if (cache.insert(std::string(hostname), std::move(builder).build(), ttl)) {
+                ++loaded;
+            }
+        }
+        return loaded;
+    }
+
+}// namespace leigod::dns
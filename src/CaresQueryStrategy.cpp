@@ -1,12 +1,44 @@
 #include "CaresQueryStrategy.h"
+#include "EventLoop.h"
 #include <algorithm>
 #include <mutex>
+#include <optional>
+#include <random>
 #include <ranges>
 #include <vector>
 
 namespace leigod::dns {
 
+    namespace {
+        // 由服务器本身导致的失败；NXDOMAIN/NODATA等正常应答说明服务器可用
+        bool isServerFailure(int status) {
+            switch (status) {
+                case ARES_ETIMEOUT:
+                case ARES_ECONNREFUSED:
+                case ARES_ESERVFAIL:
+                case ARES_EREFUSED:
+                case ARES_EBADRESP:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        std::string upstreamName(const DNSServerConfig &server) {
+            const bool ipv6 = server.address.find(':') != std::string::npos;
+            return ipv6 ? std::format("[{}]:{}", server.address, server.port)
+                        : std::format("{}:{}", server.address, server.port);
+        }
+    }// namespace
+
+    CaresQueryStrategy::~CaresQueryStrategy() {
+        if (initialized_) {
+            shutdown();
+        }
+    }
+
     void CaresQueryStrategy::initialize() {
+        // 初始化期间initialized_已置位，每个失败分支都要先释放已创建的资源再复位
         bool expected = false;
         if (!initialized_.compare_exchange_strong(expected, true)) {
             DNS_LOGGER_ERROR(logger_, "C-ares already initialized");
@@ -16,184 +48,376 @@ namespace leigod::dns {
         int status = ares_library_init(ARES_LIB_INIT_ALL);
         if (status != ARES_SUCCESS) {
             DNS_LOGGER_ERROR(logger_, "Failed to initialize c-ares library: {}", ares_strerror(status));
+            initialized_ = false;
             return;
         }
 
         if (!ares_threadsafety()) {
             DNS_LOGGER_ERROR(logger_, "c-ares not compiled with thread support");
+            ares_library_cleanup();
+            initialized_ = false;
             return;
         }
 
         DNS_LOGGER_INFO(logger_, "c-ares library version: {}", ares_version(NULL));
 
+        // 未提供外部事件循环时使用平台默认实现（epoll/kqueue/WSAPoll）
+        if (!eventLoop_) {
+            try {
+                eventLoop_ = createDefaultEventLoop();
+            } catch (const std::exception &e) {
+                DNS_LOGGER_WARN(logger_, "Falling back to poll() event loop: {}", e.what());
+                eventLoop_ = std::make_shared<PollEventLoop>();
+            }
+        }
+
+        std::atomic_store_explicit(&hedging_, std::make_shared<const HedgingConfig>(config_.hedging),
+                                   std::memory_order_release);
+        half_open_duration_ms_.store(config_.health_check.half_open_duration_ms, std::memory_order_relaxed);
+
+        // 每个启用的上游服务器一个通道；未配置服务器时沿用系统解析配置
+        for (const auto &server: config_.servers) {
+            if (server.enabled) {
+                auto upstream = std::make_unique<Upstream>();
+                upstream->name = upstreamName(server);
+                upstream->weight.store(std::max<uint32_t>(server.weight, 1), std::memory_order_relaxed);
+                upstreams_.push_back(std::move(upstream));
+                if (!initializeUpstream(*upstreams_.back(), &server)) {
+                    releaseChannels();
+                    initialized_ = false;
+                    return;
+                }
+            }
+        }
+        if (upstreams_.empty()) {
+            auto upstream = std::make_unique<Upstream>();
+            upstream->name = "system";
+            upstreams_.push_back(std::move(upstream));
+            if (!initializeUpstream(*upstreams_.back(), nullptr)) {
+                releaseChannels();
+                initialized_ = false;
+                return;
+            }
+        }
+
+        DNS_LOGGER_INFO(logger_, "C-ares initialized successfully with {} upstream channel(s)", upstreams_.size());
+    }
+
+    bool CaresQueryStrategy::initializeUpstream(Upstream &upstream, const DNSServerConfig *server) {
+        upstream.owner = this;
+
         ares_options options{};
         int optmask = 0;
 
-        // 设置c-ares选项
+        // 设置c-ares选项；每次尝试的超时取服务器配置，不超过整体查询超时
         memset(&options, 0, sizeof(options));
         options.flags = ARES_FLAG_NOCHECKRESP;
-        options.timeout = config_.query_timeout_ms;
+        options.timeout = static_cast<int>(server && server->timeout_ms > 0
+                                                   ? std::min(server->timeout_ms, config_.query_timeout_ms)
+                                                   : config_.query_timeout_ms);
         options.tries = config_.retry.max_attempts;
         options.ndots = 1;
-        optmask = ARES_OPT_FLAGS | ARES_OPT_TIMEOUT | ARES_OPT_TRIES | ARES_OPT_NDOTS;
+        // 通过套接字状态回调把c-ares关注的套接字同步到事件循环
+        options.sock_state_cb = &CaresQueryStrategy::onSocketStateChange;
+        options.sock_state_cb_data = &upstream;
+        optmask = ARES_OPT_FLAGS | ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES | ARES_OPT_NDOTS | ARES_OPT_SOCK_STATE_CB;
 
-        status = ares_init_options(&channel_, &options, optmask);
+        int status = ares_init_options(&upstream.channel, &options, optmask);
         if (status != ARES_SUCCESS) {
             DNS_LOGGER_ERROR(logger_, "Failed to set c-ares option: {}", ares_strerror(status));
-            return;
+            upstream.channel = nullptr;
+            return false;
         }
 
-        // 初始化服务器健康状态
-        std::lock_guard<std::mutex> lock(health_mutex_);
-        for (const auto &server: config_.servers) {
-            if (server.enabled) {
-                server_health_[server.address] = ServerHealth{};
+        if (server) {
+            status = ares_set_servers_ports_csv(upstream.channel, upstream.name.c_str());
+            if (status != ARES_SUCCESS) {
+                DNS_LOGGER_ERROR(logger_, "Failed to set DNS server {}: {}", upstream.name, ares_strerror(status));
+                return false;
             }
         }
-
-        initialized_ = true;
-        DNS_LOGGER_INFO(logger_, "C-ares initialized successfully");
+        return true;
     }
 
     void CaresQueryStrategy::query(const std::string &hostname, DNSQueryCallback callback) {
+        query(hostname, config_.ipv6_enabled ? AF_UNSPEC : AF_INET, std::move(callback));
+    }
 
+    void CaresQueryStrategy::query(const std::string &hostname, int family, DNSQueryCallback callback) {
+        // ares_getaddrinfo()可能同步回调，回调中释放的最后一个引用推迟到返回之后
+        const auto self = weak_from_this().lock();
         if (!initialized_) {
             DNS_LOGGER_ERROR(logger_, "C-ares not initialized, cannot query: {}", hostname);
             callback({.status = ARES_ENOTINITIALIZED});
             return;
         }
 
-        // 创建查询上下文
-        auto context = std::make_shared<QueryContext>();
-        context->hostname = hostname;
-        context->callback = callback;
-        context->strategy = shared_from_this();
-        context->start_time = std::chrono::steady_clock::now();
-
-        // 选择最佳服务器
-        std::string selected_server = selectServer();
-        if (selected_server.empty()) {
-            DNS_LOGGER_ERROR(logger_, "No healthy DNS servers available");
+        // 选择服务器：查询提交到该服务器的通道
+        auto *upstream = selectServer();
+        if (!upstream) {
+            DNS_LOGGER_WARN(logger_, "No DNS servers available for {}: all circuits are open", hostname);
             callback({.status = ARES_ESERVFAIL});
             return;
         }
 
-        // 设置查询参数
-        struct ares_addrinfo_hints hints = {};
-        hints.ai_family = config_.ipv6_enabled ? AF_UNSPEC : AF_INET;
-        hints.ai_flags = ARES_AI_CANONNAME;
+        // 需要对冲的查询：首个请求超过对冲延迟未应答时再向另一个服务器发出同样的查询
+        std::shared_ptr<HedgeState> hedge;
+        if (auto delay = hedgeDelay(hostname, *upstream)) {
+            hedge = std::make_shared<HedgeState>();
+            hedge->hostname = hostname;
+            hedge->family = family;
+            hedge->callback = std::move(callback);
+            hedge->primary = upstream;
+            hedge->start_time = std::chrono::steady_clock::now();
+            // 先计入首个请求并记下定时器，再允许定时器在事件循环线程上触发
+            std::lock_guard<std::mutex> lock(hedge->mutex);
+            hedge->pending = 1;
+            hedge->timer = timers_.scheduleAfter(*delay, [this, hedge] { sendHedge(hedge); });
+        }
+
+        sendQuery(*upstream, hostname, family, hedge ? nullptr : std::move(callback), hedge, false);
+    }
 
+    void CaresQueryStrategy::sendQuery(Upstream &upstream, const std::string &hostname, int family,
+                                       DNSQueryCallback callback, std::shared_ptr<HedgeState> hedge, bool is_hedge) {
+        // 从上下文槽位表中分配查询上下文
+        CaresQueryContext *context;
         {
-            // 保存上下文
             std::lock_guard<std::mutex> lock(contexts_mutex_);
-            active_contexts_.push_back(context);
+            auto [key, slot] = contexts_.emplace();
+            context = slot;
+            context->key = key;
         }
+        context->hostname = hostname;
+        context->callback = std::move(callback);
+        context->upstream = &upstream;
+        context->hedge = std::move(hedge);
+        context->is_hedge = is_hedge;
 
-        // 开始查询计时
-        auto query_metrics = std::make_shared<QueryMetrics>();
-        query_metrics->start_time = std::chrono::steady_clock::now();
+        // 设置查询参数
+        struct ares_addrinfo_hints hints = {};
+        hints.ai_family = family;
+        hints.ai_flags = ARES_AI_CANONNAME;
 
         // 执行查询
-        ares_getaddrinfo(channel_, hostname.c_str(), nullptr, &hints, [](void *arg, int status, int timeouts, struct ares_addrinfo *result) {
-            auto* ctx = static_cast<QueryContext*>(arg);
-            if (ctx && ctx->strategy) {
-                auto* strategy = reinterpret_cast<CaresQueryStrategy*>(ctx->strategy.get());
-                strategy->handleResult(ctx, status, result);
-            }
+        upstream.outstanding.fetch_add(1, std::memory_order_relaxed);
+        context->start_time = std::chrono::steady_clock::now();
+        ares_getaddrinfo(upstream.channel, hostname.c_str(), nullptr, &hints, [](void *arg, int status, int timeouts, struct ares_addrinfo *result) {
+            auto* ctx = static_cast<CaresQueryContext*>(arg);
+            ctx->upstream->owner->handleResult(ctx, status, result);
             if (result) {
                 ares_freeaddrinfo(result);
-            } }, context.get());
+            } }, context);
     }
 
-    void CaresQueryStrategy::handleResult(QueryContext *context, int status, struct ares_addrinfo *result) {
-        std::vector<std::string> ips;
+    void CaresQueryStrategy::handleResult(CaresQueryContext *context, int status, struct ares_addrinfo *result) {
+        AddressList::Builder ips;
+        // 取所有地址与CNAME记录中最小的TTL（秒）
+        std::optional<int> min_ttl;
         if (status == ARES_SUCCESS && result) {
-            for (auto *node = result->nodes; node != nullptr; node = node->ai_next) {
-                char ip[INET6_ADDRSTRLEN];
-                const void *addr;
+            for (auto *cname = result->cnames; cname != nullptr; cname = cname->next) {
+                min_ttl = std::min(min_ttl.value_or(cname->ttl), cname->ttl);
+            }
 
+            // 直接保存二进制地址，字符串形式只在需要时生成
+            for (auto *node = result->nodes; node != nullptr; node = node->ai_next) {
                 if (node->ai_family == AF_INET) {
                     const auto *addr_in = reinterpret_cast<struct sockaddr_in *>(node->ai_addr);
-                    addr = &(addr_in->sin_addr);
+                    ips.push_back(IPAddress::fromIPv4(&addr_in->sin_addr));
                 } else if (node->ai_family == AF_INET6) {
                     const auto *addr_in6 = reinterpret_cast<struct sockaddr_in6 *>(node->ai_addr);
-                    addr = &(addr_in6->sin6_addr);
+                    ips.push_back(IPAddress::fromIPv6(&addr_in6->sin6_addr));
                 } else {
                     continue;
                 }
-
-                if (inet_ntop(node->ai_family, addr, ip, sizeof(ip))) {
-                    ips.emplace_back(ip);
-                }
+                min_ttl = std::min(min_ttl.value_or(node->ai_ttl), node->ai_ttl);
             }
         }
 
-        // 更新服务器性能指标
+        // 更新应答服务器的性能指标
         auto query_end = std::chrono::steady_clock::now();
-        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(query_end - context->start_time);
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(query_end - context->start_time);
+        auto &upstream = *context->upstream;
+        upstream.outstanding.fetch_sub(1, std::memory_order_relaxed);
 
         if (status == ARES_SUCCESS) {
-            updateServerMetrics(selectServer(), latency);
-        } else {
+            updateServerMetrics(upstream, latency);
+        } else if (status != ARES_ECANCELLED && status != ARES_EDESTRUCTION) {
             DNS_LOGGER_DEBUG(logger_, "DNS query for {} failed: {}", context->hostname, ares_strerror(status));
 
-            // 更新服务器健康状态
-            auto selected_server = selectServer();
-            {
-                std::lock_guard<std::mutex> lock(health_mutex_);
-                auto &health = server_health_[selected_server];
-                health.error_count++;
-                if (health.error_count > config_.server_error_threshold) {
-                    health.healthy = false;
-                    DNS_LOGGER_WARN(logger_, "Server {} marked as unhealthy", selected_server);
-                }
+            // 更新服务器断路器状态
+            if (isServerFailure(status)) {
+                recordServerFailure(upstream);
+            } else {
+                upstream.consecutive_failures = 0;
             }
         }
 
         // 调用回调
-        if (context->callback) {
+        if (context->hedge || context->callback) {
             ResolveResult result_ = {
                     .status = status,
                     .hostname = context->hostname,
-                    .ip_addresses = ips,
+                    .ip_addresses = std::move(ips).build(),
                     .resolution_time = latency.count(),
                     .error = ares_strerror(status),
                     .from_cache = false,
+                    .ttl = min_ttl ? static_cast<int64_t>(std::max(*min_ttl, 0)) * 1000 : -1,
+                    // c-ares不暴露收到应答报文的时间，只提供解析完成时间
+                    .answer_parsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                query_end.time_since_epoch())
+                                                .count(),
             };
-            context->callback(result_);
+            if (context->hedge) {
+                completeHedged(*context, std::move(result_));
+            } else {
+                context->callback(result_);
+            }
         }
 
-        // 标记为已完成
-        context->completed = true;
+        // 归还上下文槽位；回调与对冲状态移到锁外析构。回调可能持有解析器的最后一个引用，
+        // 此时仍在ares_process_fd()之内，由各入口持有的self推迟策略与通道的销毁
+        auto callback = std::move(context->callback);
+        auto hedge = std::move(context->hedge);
+        std::lock_guard<std::mutex> lock(contexts_mutex_);
+        contexts_.erase(context->key);
     }
 
-    void CaresQueryStrategy::processEvents() {
-        if (!initialized_) return;
+    void CaresQueryStrategy::completeHedged(CaresQueryContext &context, ResolveResult result) {
+        auto &hedge = *context.hedge;
+        const bool answered = !isServerFailure(result.status);
+        DNSQueryCallback callback;
+        TimerQueue::TimerId timer;
+        {
+            std::lock_guard<std::mutex> lock(hedge.mutex);
+            --hedge.pending;
+            if (hedge.finished) {
+                // 另一个请求已先完成查询，丢弃较慢的结果
+                return;
+            }
 
-        fd_set readers, writers;
-        int nfds = 0;
-        struct timeval tv{};
+            // 服务器故障时若另一个请求仍在途，等待它的结果
+            if (!answered && hedge.pending > 0) {
+                return;
+            }
+
+            hedge.finished = true;
+            callback = std::move(hedge.callback);
+            timer = hedge.timer;
+        }
+
+        timers_.cancel(timer);
+        if (answered && context.is_hedge && metrics_) {
+            metrics_->recordHedge(IMetrics::HedgeOutcome::kWon);
+        }
+
+        // 解析耗时从首个请求发出时算起
+        result.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::steady_clock::now() - hedge.start_time)
+                                         .count();
+        if (callback) {
+            callback(result);
+        }
+    }
+
+    void CaresQueryStrategy::onSocketStateChange(void *data, ares_socket_t socket, int readable, int writable) {
+        auto *upstream = static_cast<Upstream *>(data);
+        auto *strategy = upstream->owner;
+        const auto handle = static_cast<SocketHandle>(socket);
+        {
+            std::lock_guard<std::mutex> lock(strategy->socket_owners_mutex_);
+            if (readable || writable) {
+                strategy->socket_owners_[handle] = upstream;
+            } else {
+                strategy->socket_owners_.erase(handle);
+            }
+        }
+        strategy->eventLoop_->updateSocket(handle, readable != 0, writable != 0);
+    }
 
-        FD_ZERO(&readers);
-        FD_ZERO(&writers);
+    CaresQueryStrategy::Upstream *CaresQueryStrategy::socketOwner(SocketHandle socket) const {
+        // 只在查找期间持有锁：ares_process_fd()中的回调会再次进入onSocketStateChange()
+        std::lock_guard<std::mutex> lock(socket_owners_mutex_);
+        auto it = socket_owners_.find(socket);
+        return it != socket_owners_.end() ? it->second : nullptr;
+    }
 
-        // 获取超时设置
-        const struct timeval *tvp = ares_timeout(channel_, nullptr, &tv);
+    void CaresQueryStrategy::processEvents(std::chrono::milliseconds max_wait) {
+        if (!initialized_) return;
+        // 处理期间保持策略存活：完成回调释放最后一个引用时，通道在ares_process_fd()返回后才销毁
+        const auto self = weak_from_this().lock();
 
-        nfds = ares_fds(channel_, &readers, &writers);
+        // 没有待处理的套接字时只处理超时，不阻塞调用方
+        if (eventLoop_->socketCount() == 0) {
+            processTimeouts();
+            timers_.runDue();
+            return;
+        }
 
-        if (nfds == 0) return;
+        const int ready = eventLoop_->wait(nextTimeout(max_wait), [this](SocketHandle socket, bool readable, bool writable) {
+            auto *upstream = socketOwner(socket);
+            if (!upstream) {
+                return;
+            }
+            ares_process_fd(upstream->channel,
+                            readable ? static_cast<ares_socket_t>(socket) : ARES_SOCKET_BAD,
+                            writable ? static_cast<ares_socket_t>(socket) : ARES_SOCKET_BAD);
+        });
 
-        int select_result = select(nfds, &readers, &writers, nullptr, tvp);
-        if (select_result < 0) {
-            DNS_LOGGER_ERROR(logger_, "select() failed: {}", errno);
+        if (ready < 0) {
+            DNS_LOGGER_ERROR(logger_, "Event loop wait failed: {}", errno);
             return;
         }
 
-        ares_process(channel_, &readers, &writers);
+        // 本轮没有就绪套接字的通道也可能有查询到期
+        processTimeouts();
+        timers_.runDue();
+    }
+
+    void CaresQueryStrategy::processSocket(SocketHandle socket, bool readable, bool writable) {
+        if (!initialized_) return;
+        const auto self = weak_from_this().lock();
+
+        if (auto *upstream = socketOwner(socket)) {
+            ares_process_fd(upstream->channel,
+                            readable ? static_cast<ares_socket_t>(socket) : ARES_SOCKET_BAD,
+                            writable ? static_cast<ares_socket_t>(socket) : ARES_SOCKET_BAD);
+        } else {
+            processTimeouts();
+        }
+        timers_.runDue();
+    }
+
+    void CaresQueryStrategy::processTimeouts() {
+        for (const auto &upstream: upstreams_) {
+            ares_process_fd(upstream->channel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+        }
+    }
+
+    std::chrono::milliseconds CaresQueryStrategy::nextTimeout(std::chrono::milliseconds max_wait) {
+        if (!initialized_) return max_wait;
+
+        if (auto probe = timers_.timeUntilNext()) {
+            max_wait = std::min(max_wait, *probe);
+        }
+
+        struct timeval tv{};
+        struct timeval maxtv{};
+        maxtv.tv_sec = static_cast<decltype(maxtv.tv_sec)>(max_wait.count() / 1000);
+        maxtv.tv_usec = static_cast<decltype(maxtv.tv_usec)>((max_wait.count() % 1000) * 1000);
+
+        // 取所有通道中最近的超时（不超过调用方给定的最长等待时间）
+        for (const auto &upstream: upstreams_) {
+            if (const struct timeval *tvp = ares_timeout(upstream->channel, &maxtv, &tv)) {
+                maxtv = *tvp;
+            }
+        }
+        // 向上取整，避免在超时到期前空转
+        return std::chrono::milliseconds(static_cast<int64_t>(maxtv.tv_sec) * 1000 + (maxtv.tv_usec + 999) / 1000);
+    }
 
-        // 清理已完成的上下文
-        cleanupCompletedContexts();
+    std::shared_ptr<IEventLoop> CaresQueryStrategy::eventLoop() const {
+        return eventLoop_;
     }
 
     void CaresQueryStrategy::shutdown() {
@@ -204,118 +428,392 @@ namespace leigod::dns {
         }
 
         // 取消所有未完成的查询
-        ares_cancel(channel_);
+        for (const auto &upstream: upstreams_) {
+            if (upstream->channel) {
+                ares_cancel(upstream->channel);
+            }
+        }
 
-        // 清理所有活动上下文
+        // 清理仍未完成的上下文（ares_cancel()已通过回调完成了在途查询），回调在锁外执行
+        std::vector<DNSQueryCallback> cancelled;
         {
             std::lock_guard<std::mutex> lock(contexts_mutex_);
-            for (const auto &context: active_contexts_) {
-                if (context->callback) {
-                    context->callback({.status = ARES_ECANCELLED});
+            contexts_.forEach([&](ContextMap::Key key, CaresQueryContext &context) {
+                if (context.callback) {
+                    cancelled.push_back(std::move(context.callback));
                 }
-            }
-            active_contexts_.clear();
+                contexts_.erase(key);
+            });
+        }
+        for (const auto &callback: cancelled) {
+            callback({.status = ARES_ECANCELLED});
         }
 
-        ares_destroy(channel_);
-        ares_library_cleanup();
+        releaseChannels();
         initialized_ = false;
         DNS_LOGGER_INFO(logger_, "C-ares shutdown completed");
     }
 
+    void CaresQueryStrategy::releaseChannels() {
+        timers_.clear();
+        for (const auto &upstream: upstreams_) {
+            if (upstream->channel) {
+                ares_destroy(upstream->channel);
+                upstream->channel = nullptr;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(socket_owners_mutex_);
+            socket_owners_.clear();
+        }
+        ares_library_cleanup();
+    }
+
     bool CaresQueryStrategy::isInitialized() const {
         return initialized_;
     }
 
-    std::string CaresQueryStrategy::selectServer() {
-        if (config_.servers.empty()) {
-            return "";
+    CaresQueryStrategy::Upstream *CaresQueryStrategy::selectServer(const Upstream *exclude) {
+        if (upstreams_.empty()) {
+            return nullptr;
         }
 
-        std::vector<std::pair<std::string, double>> available_servers;
-        {
-            std::lock_guard<std::mutex> lock(health_mutex_);
-            for (const auto &server: config_.servers) {
-                if (server.enabled && server_health_.contains(server.address) && server_health_.at(server.address).healthy) {
-                    // 计算服务器得分（基于延迟和权重）
-                    double score = server.weight / (1.0 + server_health_.at(server.address).avg_latency.count());
-                    available_servers.emplace_back(server.address, score);
+        // 按有效权重随机抽取：断路器打开的服务器不参与，半开的按恢复进度降低权重
+        const auto now = TimerQueue::Clock::now();
+        auto weightOf = [&](const Upstream &upstream) {
+            return &upstream == exclude ? 0.0 : effectiveWeight(upstream, now);
+        };
+        double total_weight = 0;
+        for (const auto &upstream: upstreams_) {
+            total_weight += weightOf(*upstream);
+        }
+        if (total_weight <= 0) {
+            // 所有服务器的断路器都已打开：快速失败，由后台探测负责恢复
+            return nullptr;
+        }
+        if (upstreams_.size() == 1) {
+            return upstreams_.front().get();
+        }
+
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        auto pick = [&]() -> Upstream * {
+            auto target = std::uniform_real_distribution<double>(0, total_weight)(rng);
+            Upstream *last = nullptr;
+            for (const auto &upstream: upstreams_) {
+                const auto weight = weightOf(*upstream);
+                if (weight <= 0) {
+                    continue;
                 }
+                last = upstream.get();
+                if (target < weight) {
+                    break;
+                }
+                target -= weight;
             }
+            return last;
+        };
+
+        // 加权二选一：两个候选中选择 延迟 × 在途查询数 代价较小者，
+        // 慢的或积压的服务器逐渐少分流量，但不会像总选最优那样把全部流量压到一个服务器上
+        auto *first = pick();
+        auto *second = pick();
+        if (first == second) {
+            return first;
         }
+        auto cost = [](const Upstream &upstream) {
+            return (1.0 + upstream.ewma_latency_us.load(std::memory_order_relaxed)) *
+                   (1.0 + upstream.outstanding.load(std::memory_order_relaxed));
+        };
+        return cost(*second) < cost(*first) ? second : first;
+    }
 
-        if (available_servers.empty()) {
-            // 如果没有健康的服务器，重置所有服务器状态
-            std::lock_guard<std::mutex> lock(health_mutex_);
-            for (auto &health: server_health_ | std::views::values) {
-                health.healthy = true;
-                health.error_count = 0;
+    double CaresQueryStrategy::effectiveWeight(const Upstream &upstream, TimerQueue::Clock::time_point now) const {
+        switch (upstream.state.load(std::memory_order_acquire)) {
+            case CircuitState::kOpen:
+                return 0;
+            case CircuitState::kHalfOpen: {
+                const auto since = TimerQueue::Clock::time_point(
+                        TimerQueue::Clock::duration(upstream.half_open_since.load(std::memory_order_relaxed)));
+                const auto elapsed = std::chrono::duration<double, std::milli>(now - since).count();
+                const auto duration = std::max<double>(half_open_duration_ms_.load(std::memory_order_relaxed), 1);
+                return upstream.weight.load(std::memory_order_relaxed) *
+                       std::clamp(elapsed / duration, HALF_OPEN_MIN_SHARE, 1.0);
             }
-            return config_.servers.front().address;
+            default:
+                return upstream.weight.load(std::memory_order_relaxed);
         }
+    }
 
-        // 根据得分选择服务器
-        std::ranges::sort(available_servers,
-                          [](const auto &a, const auto &b) { return a.second > b.second; });
+    std::optional<std::chrono::milliseconds> CaresQueryStrategy::hedgeDelay(const std::string &hostname,
+                                                                           const Upstream &primary) {
+        const auto hedging_config = std::atomic_load_explicit(&hedging_, std::memory_order_acquire);
+        const auto &hedging = *hedging_config;
+        if (!hedging.enabled || upstreams_.size() < 2) {
+            return std::nullopt;
+        }
 
-        return available_servers.front().first;
-    }
+        // 只对配置的延迟敏感域名（及其子域名）对冲
+        if (!hedging.hostnames.empty()) {
+            const auto matches = std::ranges::any_of(hedging.hostnames, [&](const std::string &name) {
+                return hostname.size() >= name.size() &&
+                       hostname.compare(hostname.size() - name.size(), name.size(), name) == 0 &&
+                       (hostname.size() == name.size() || hostname[hostname.size() - name.size() - 1] == '.');
+            });
+            if (!matches) {
+                return std::nullopt;
+            }
+        }
 
-    bool CaresQueryStrategy::verifyServerHealth(const std::string &server) {
-        // 执行健康检查查询
-        // 这里可以实现实际的健康检查逻辑
-        return true;
+        // 每个需对冲的查询补充预算，令牌桶容量限制突发
+        const auto burst = static_cast<double>(std::max<uint32_t>(hedging.budget_burst, 1));
+        auto tokens = hedge_tokens_.load(std::memory_order_relaxed);
+        while (!hedge_tokens_.compare_exchange_weak(tokens, std::min(tokens + hedging.budget_ratio, burst),
+                                                    std::memory_order_relaxed)) {
+        }
+
+        // 未配置固定延迟时使用首个服务器的p95延迟，尚无完整窗口时不对冲
+        std::chrono::milliseconds delay(hedging.delay_ms);
+        if (delay.count() == 0) {
+            const auto p95 = primary.p95_latency_us.load(std::memory_order_relaxed);
+            if (p95 == 0) {
+                return std::nullopt;
+            }
+            delay = std::chrono::milliseconds((p95 + 999) / 1000);
+        }
+        return std::max(delay, std::chrono::milliseconds(hedging.min_delay_ms));
     }
 
-    void CaresQueryStrategy::updateServerMetrics(const std::string &server, const std::chrono::milliseconds &latency) {
-        uint64_t count = 0;
-        std::chrono::milliseconds total{0};
+    void CaresQueryStrategy::sendHedge(const std::shared_ptr<HedgeState> &hedge) {
+        if (!initialized_) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(hedge->mutex);
+            if (hedge->finished) {
+                return;
+            }
+        }
+
+        auto *upstream = selectServer(hedge->primary);
+        if (!upstream) {
+            return;
+        }
+
+        // 预算不足时不发出对冲请求，避免故障期间放大上游负载
+        auto tokens = hedge_tokens_.load(std::memory_order_relaxed);
+        do {
+            if (tokens < 1.0) {
+                if (metrics_) {
+                    metrics_->recordHedge(IMetrics::HedgeOutcome::kBudgetExhausted);
+                }
+                return;
+            }
+        } while (!hedge_tokens_.compare_exchange_weak(tokens, tokens - 1.0, std::memory_order_relaxed));
 
         {
-            std::lock_guard<std::mutex> lock(metrics_mutex_);
-            // 更新延迟历史
-            auto &history = latency_history_[server];
-            history.push(latency);
-            if (history.size() > MAX_LATENCY_SAMPLES) {
-                history.pop();
+            // 检查预算期间首个请求可能已完成
+            std::lock_guard<std::mutex> lock(hedge->mutex);
+            if (hedge->finished) {
+                return;
             }
+            ++hedge->pending;
+        }
+
+        DNS_LOGGER_DEBUG(logger_, "Hedging query for {} to {}", hedge->hostname, upstream->name);
+        if (metrics_) {
+            metrics_->recordHedge(IMetrics::HedgeOutcome::kSent);
+        }
+        sendQuery(*upstream, hedge->hostname, hedge->family, nullptr, hedge, true);
+    }
 
-            // 计算平均延迟
-            count = history.size();
-            auto temp = history;
-            while (!temp.empty()) {
-                total += temp.front();
-                temp.pop();
+    void CaresQueryStrategy::updateServerMetrics(Upstream &upstream, std::chrono::microseconds latency) {
+        // 结果只在驱动事件循环的线程上处理，每个通道只有一个写入方
+        const auto sample = static_cast<double>(latency.count());
+        const auto ewma = upstream.ewma_latency_us.load(std::memory_order_relaxed);
+        upstream.ewma_latency_us.store(ewma == 0.0 ? sample : ewma + LATENCY_EWMA_ALPHA * (sample - ewma),
+                                       std::memory_order_relaxed);
+        upstream.consecutive_failures = 0;// 重置错误计数
+
+        // 按固定样本数滚动窗口，计算最近的p95延迟
+        upstream.latency_window.record(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+        if (++upstream.window_samples >= LATENCY_WINDOW_SAMPLES) {
+            upstream.p95_latency_us.store(static_cast<int64_t>(upstream.latency_window.snapshot().percentile(0.95)),
+                                          std::memory_order_relaxed);
+            upstream.latency_window.reset();
+            upstream.window_samples = 0;
+        }
+
+        if (metrics_) {
+            metrics_->recordServerLatency(upstream.name, latency.count());
+        }
+    }
+
+    void CaresQueryStrategy::updateConfig(const DNSResolverConfig &config) {
+        if (!initialized_) {
+            return;
+        }
+        // 对冲配置在查询路径上读取，直接发布新快照；其余状态作为定时任务交给事件循环线程
+        std::atomic_store_explicit(&hedging_, std::make_shared<const HedgingConfig>(config.hedging),
+                                   std::memory_order_release);
+        timers_.scheduleAfter(std::chrono::milliseconds(0), [this, config] {
+            applyConfig(config);
+        });
+        eventLoop_->wakeup();
+    }
+
+    void CaresQueryStrategy::applyConfig(const DNSResolverConfig &config) {
+        config_.health_check = config.health_check;
+        config_.server_error_threshold = config.server_error_threshold;
+        half_open_duration_ms_.store(config.health_check.half_open_duration_ms, std::memory_order_relaxed);
+
+        // 关闭健康检查时恢复所有断路器，递增代数使已调度的探测失效
+        if (!config_.health_check.enabled) {
+            for (auto &upstream: upstreams_) {
+                if (upstream->state.load(std::memory_order_relaxed) != CircuitState::kClosed) {
+                    closeCircuit(*upstream);
+                }
             }
         }
 
-        {
-            // 更新服务器健康状态
-            std::lock_guard<std::mutex> health_lock(health_mutex_);
-            auto &health = server_health_[server];
-            health.avg_latency = std::chrono::milliseconds(total.count() / count);
-            health.last_check = std::chrono::steady_clock::now();
-            health.error_count = 0;// 重置错误计数
-            health.healthy = true;
+        // 按名称匹配更新权重，新增或删除的服务器需要重建解析器
+        size_t matched = 0;
+        size_t enabled = 0;
+        for (const auto &server: config.servers) {
+            if (!server.enabled) {
+                continue;
+            }
+            ++enabled;
+            const auto name = upstreamName(server);
+            const auto it = std::ranges::find_if(upstreams_, [&](const auto &upstream) {
+                return upstream->name == name;
+            });
+            if (it != upstreams_.end()) {
+                (*it)->weight.store(std::max<uint32_t>(server.weight, 1), std::memory_order_relaxed);
+                ++matched;
+            }
+        }
+        const bool system_only = upstreams_.size() == 1 && upstreams_.front()->name == "system";
+        if (matched != enabled || (!system_only && matched != upstreams_.size())) {
+            DNS_LOGGER_WARN(logger_, "DNS server list changes take effect only after the resolver is recreated");
         }
     }
 
-    void CaresQueryStrategy::cleanupCompletedContexts() {
-        // QueryContext中持有的callback会引用DNSResolver,
-        // DNSResolver持有QueryStrategy，QueryStrategy持有QueryContext，形成循环引用
-        // 因此，在清理完成上下文时，需要确保不会在回调中访问QueryStrategy
-        std::vector<std::shared_ptr<QueryContext>> completed_contexts;
-        {
-            std::lock_guard<std::mutex> lock(contexts_mutex_);
-            for (auto it = active_contexts_.begin(); it != active_contexts_.end();) {
-                if ((*it)->completed.load()) {
-                    completed_contexts.push_back(*it);
-                    it = active_contexts_.erase(it);
-                } else {
-                    ++it;
+    void CaresQueryStrategy::recordServerFailure(Upstream &upstream) {
+        if (metrics_) {
+            metrics_->recordError("server_failure", upstream.name);
+        }
+        if (!config_.health_check.enabled) {
+            return;
+        }
+
+        switch (upstream.state.load(std::memory_order_relaxed)) {
+            case CircuitState::kClosed:
+                if (++upstream.consecutive_failures > config_.server_error_threshold) {
+                    openCircuit(upstream);
                 }
+                break;
+            case CircuitState::kHalfOpen:
+                // 半开期间的失败说明服务器尚未恢复，退避后重新探测
+                upstream.probe_interval = std::min(upstream.probe_interval * 2,
+                                                   std::chrono::milliseconds(config_.health_check.max_probe_interval_ms));
+                openCircuit(upstream);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void CaresQueryStrategy::openCircuit(Upstream &upstream) {
+        ++upstream.generation;
+        upstream.state.store(CircuitState::kOpen, std::memory_order_release);
+        upstream.consecutive_failures = 0;
+        upstream.probe_successes = 0;
+        if (upstream.probe_interval.count() == 0) {
+            upstream.probe_interval = std::chrono::milliseconds(config_.health_check.probe_interval_ms);
+        }
+        DNS_LOGGER_WARN(logger_, "Circuit opened for server {}, probing every {}ms", upstream.name,
+                        upstream.probe_interval.count());
+        if (metrics_) {
+            metrics_->recordError("server_circuit_open", upstream.name);
+        }
+        scheduleProbe(upstream);
+    }
+
+    void CaresQueryStrategy::halfOpenCircuit(Upstream &upstream) {
+        const auto generation = ++upstream.generation;
+        upstream.half_open_since.store(TimerQueue::Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        upstream.state.store(CircuitState::kHalfOpen, std::memory_order_release);
+        DNS_LOGGER_INFO(logger_, "Circuit half-open for server {}, ramping traffic back over {}ms", upstream.name,
+                        config_.health_check.half_open_duration_ms);
+
+        // 半开期间没有失败则关闭断路器
+        timers_.scheduleAfter(std::chrono::milliseconds(config_.health_check.half_open_duration_ms),
+                                    [this, &upstream, generation] {
+                                        if (upstream.generation == generation) {
+                                            closeCircuit(upstream);
+                                        }
+                                    });
+    }
+
+    void CaresQueryStrategy::closeCircuit(Upstream &upstream) {
+        ++upstream.generation;
+        upstream.state.store(CircuitState::kClosed, std::memory_order_release);
+        upstream.consecutive_failures = 0;
+        upstream.probe_interval = std::chrono::milliseconds(0);
+        DNS_LOGGER_INFO(logger_, "Circuit closed for server {}", upstream.name);
+    }
+
+    void CaresQueryStrategy::scheduleProbe(Upstream &upstream) {
+        // 加入随机抖动，多个服务器或多个解析器实例不会同时探测
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        std::uniform_real_distribution<double> jitter(1.0 - PROBE_JITTER, 1.0 + PROBE_JITTER);
+        const auto delay = std::chrono::milliseconds(
+                static_cast<int64_t>(static_cast<double>(upstream.probe_interval.count()) * jitter(rng)));
+
+        const auto generation = upstream.generation;
+        timers_.scheduleAfter(delay, [this, &upstream, generation] {
+            sendProbe(upstream, generation);
+        });
+    }
+
+    void CaresQueryStrategy::sendProbe(Upstream &upstream, uint64_t generation) {
+        if (!initialized_ || upstream.generation != generation) {
+            return;
+        }
+
+        // 探测使用独立的轻量查询，不经过用户查询路径，结果也不计入用户查询统计
+        auto *request = new ProbeRequest{&upstream, generation};
+        ares_query_dnsrec(
+                upstream.channel, config_.health_check.probe_hostname.c_str(), ARES_CLASS_IN, ARES_REC_TYPE_A,
+                [](void *arg, ares_status_t status, size_t, const ares_dns_record_t *) {
+                    std::unique_ptr<ProbeRequest> probe(static_cast<ProbeRequest *>(arg));
+                    auto &target = *probe->upstream;
+                    target.owner->handleProbeResult(target, probe->generation, status);
+                },
+                request, nullptr);
+    }
+
+    void CaresQueryStrategy::handleProbeResult(Upstream &upstream, uint64_t generation, ares_status_t status) {
+        if (status == ARES_ECANCELLED || status == ARES_EDESTRUCTION || !initialized_ ||
+            upstream.generation != generation) {
+            return;
+        }
+
+        if (!isServerFailure(status)) {
+            DNS_LOGGER_DEBUG(logger_, "Health probe to {} succeeded ({}/{})", upstream.name,
+                             upstream.probe_successes + 1, config_.health_check.success_threshold);
+            if (++upstream.probe_successes >= config_.health_check.success_threshold) {
+                halfOpenCircuit(upstream);
+                return;
             }
+        } else {
+            // 探测失败：指数退避，直到max_probe_interval_ms
+            DNS_LOGGER_DEBUG(logger_, "Health probe to {} failed: {}", upstream.name, ares_strerror(status));
+            upstream.probe_successes = 0;
+            upstream.probe_interval = std::min(upstream.probe_interval * 2,
+                                               std::chrono::milliseconds(config_.health_check.max_probe_interval_ms));
         }
+        scheduleProbe(upstream);
     }
 
 }// namespace leigod::dns
\ No newline at end of file
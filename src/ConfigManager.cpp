@@ -9,13 +9,17 @@ namespace leigod::dns {
     }
 
     DNSResolverConfig ConfigManager::getConfig() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return config_;
+        return *std::atomic_load_explicit(&config_, std::memory_order_acquire);
+    }
+
+    std::shared_ptr<const DNSResolverConfig> ConfigManager::getConfigSnapshot() const {
+        return std::atomic_load_explicit(&config_, std::memory_order_acquire);
     }
 
     void ConfigManager::updateConfig(const DNSResolverConfig &config) {
         std::lock_guard<std::mutex> lock(mutex_);
-        config_ = config;
+        std::atomic_store_explicit(&config_, std::make_shared<const DNSResolverConfig>(config),
+                                   std::memory_order_release);
         notifyConfigChange();
     }
 
@@ -58,6 +62,19 @@ namespace leigod::dns {
                 newConfig.cache.max_size = cacheJson.value("max_size", 10000);
                 newConfig.cache.persistent = cacheJson.value("persistent", false);
                 newConfig.cache.cache_file = cacheJson.value("cache_file", "");
+                newConfig.cache.snapshot_interval_ms = cacheJson.value("snapshot_interval_ms", 300 * 1000);
+                newConfig.cache.type = cacheJson.value("type", "lru");
+                newConfig.cache.shard_count = cacheJson.value("shard_count", 16);
+                newConfig.cache.shm_name = cacheJson.value("shm_name", "/leigod_dns_cache");
+                newConfig.cache.cleanup_batch_size = cacheJson.value("cleanup_batch_size", 256);
+                newConfig.cache.min_ttl = cacheJson.value("min_ttl", 0);
+                newConfig.cache.max_ttl = cacheJson.value("max_ttl", 24 * 3600 * 1000);
+                newConfig.cache.serve_stale_ms = cacheJson.value("serve_stale_ms", 0);
+                newConfig.cache.refresh_ahead_ratio = cacheJson.value("refresh_ahead_ratio", 0.0);
+                newConfig.cache.refresh_min_hits = cacheJson.value("refresh_min_hits", 2);
+                newConfig.cache.negative_cache = cacheJson.value("negative_cache", true);
+                newConfig.cache.negative_ttl = cacheJson.value("negative_ttl", 60 * 1000);
+                newConfig.cache.max_negative_ttl = cacheJson.value("max_negative_ttl", 3600 * 1000);
             }
 
             // 解析重试配置
@@ -68,6 +85,58 @@ namespace leigod::dns {
                 newConfig.retry.max_delay_ms = retryJson.value("max_delay_ms", 1000);
             }
 
+            // 解析健康检查配置
+            if (configJson.contains("health_check")) {
+                const auto &healthJson = configJson["health_check"];
+                newConfig.health_check.enabled = healthJson.value("enabled", true);
+                newConfig.health_check.probe_hostname = healthJson.value("probe_hostname", ".");
+                newConfig.health_check.probe_interval_ms = healthJson.value("probe_interval_ms", 1000);
+                newConfig.health_check.max_probe_interval_ms = healthJson.value("max_probe_interval_ms", 30000);
+                newConfig.health_check.success_threshold = healthJson.value("success_threshold", 2);
+                newConfig.health_check.half_open_duration_ms = healthJson.value("half_open_duration_ms", 10000);
+            }
+
+            // 解析对冲请求配置
+            if (configJson.contains("hedging")) {
+                const auto &hedgingJson = configJson["hedging"];
+                newConfig.hedging.enabled = hedgingJson.value("enabled", false);
+                newConfig.hedging.delay_ms = hedgingJson.value("delay_ms", 0);
+                newConfig.hedging.min_delay_ms = hedgingJson.value("min_delay_ms", 5);
+                newConfig.hedging.budget_ratio = hedgingJson.value("budget_ratio", 0.05);
+                newConfig.hedging.budget_burst = hedgingJson.value("budget_burst", 10);
+                newConfig.hedging.hostnames = hedgingJson.value("hostnames", std::vector<std::string>{});
+            }
+
+            // 解析Happy Eyeballs配置
+            if (configJson.contains("happy_eyeballs")) {
+                const auto &happyJson = configJson["happy_eyeballs"];
+                newConfig.happy_eyeballs.enabled = happyJson.value("enabled", false);
+                newConfig.happy_eyeballs.resolution_delay_ms = happyJson.value("resolution_delay_ms", 50);
+            }
+
+            // 解析批量UDP查询配置
+            if (configJson.contains("udp_batch")) {
+                const auto &udpBatchJson = configJson["udp_batch"];
+                newConfig.udp_batch.sockets = udpBatchJson.value("sockets", 4);
+                newConfig.udp_batch.batch_size = udpBatchJson.value("batch_size", 64);
+                newConfig.udp_batch.use_0x20 = udpBatchJson.value("use_0x20", true);
+            }
+
+            // 解析准入队列配置
+            if (configJson.contains("admission")) {
+                const auto &admissionJson = configJson["admission"];
+                newConfig.admission.max_queue_size = admissionJson.value("max_queue_size", 1000);
+                newConfig.admission.queue_timeout_ms = admissionJson.value("queue_timeout_ms", 1000);
+            }
+
+            // 解析查询跟踪配置
+            if (configJson.contains("tracing")) {
+                const auto &tracingJson = configJson["tracing"];
+                newConfig.tracing.enabled = tracingJson.value("enabled", false);
+                newConfig.tracing.sample_rate = tracingJson.value("sample_rate", 0.01);
+                newConfig.tracing.ring_size = tracingJson.value("ring_size", 1024);
+            }
+
             // 解析监控配置
             if (configJson.contains("metrics")) {
                 const auto &metricsJson = configJson["metrics"];
@@ -82,10 +151,15 @@ namespace leigod::dns {
                 newConfig.query_timeout_ms = globalJson.value("query_timeout_ms", 5000);
                 newConfig.max_concurrent_queries = globalJson.value("max_concurrent_queries", 100);
                 newConfig.ipv6_enabled = globalJson.value("ipv6_enabled", true);
+                newConfig.managed_io = globalJson.value("managed_io", false);
+                newConfig.io_threads = globalJson.value("io_threads", 1);
+                newConfig.io_thread_affinity = globalJson.value("io_thread_affinity", false);
+                newConfig.query_strategy = globalJson.value("query_strategy", "cares");
             }
 
             std::lock_guard<std::mutex> lock(mutex_);
-            config_ = newConfig;
+            std::atomic_store_explicit(&config_, std::make_shared<const DNSResolverConfig>(std::move(newConfig)),
+                                       std::memory_order_release);
             configFile_ = filename;
             lastModTime_ = std::filesystem::last_write_time(filename);
 
@@ -100,13 +174,13 @@ namespace leigod::dns {
 
     bool ConfigManager::saveToFile(const std::string &filename) const {
         try {
-            std::lock_guard<std::mutex> lock(mutex_);
+            const auto config = std::atomic_load_explicit(&config_, std::memory_order_acquire);
 
             nlohmann::json configJson;
 
             // 保存DNS服务器配置
             nlohmann::json serversJson = nlohmann::json::array();
-            for (const auto &server: config_.servers) {
+            for (const auto &server: config->servers) {
                 nlohmann::json serverJson;
                 serverJson["address"] = server.address;
                 serverJson["port"] = server.port;
@@ -119,32 +193,95 @@ namespace leigod::dns {
 
             // 保存缓存配置
             nlohmann::json cacheJson;
-            cacheJson["enabled"] = config_.cache.enabled;
-            cacheJson["ttl_seconds"] = config_.cache.ttl;
-            cacheJson["max_size"] = config_.cache.max_size;
-            cacheJson["persistent"] = config_.cache.persistent;
-            cacheJson["cache_file"] = config_.cache.cache_file;
+            cacheJson["enabled"] = config->cache.enabled;
+            cacheJson["ttl_seconds"] = config->cache.ttl;
+            cacheJson["max_size"] = config->cache.max_size;
+            cacheJson["persistent"] = config->cache.persistent;
+            cacheJson["cache_file"] = config->cache.cache_file;
+            cacheJson["snapshot_interval_ms"] = config->cache.snapshot_interval_ms;
+            cacheJson["type"] = config->cache.type;
+            cacheJson["shard_count"] = config->cache.shard_count;
+            cacheJson["shm_name"] = config->cache.shm_name;
+            cacheJson["cleanup_batch_size"] = config->cache.cleanup_batch_size;
+            cacheJson["min_ttl"] = config->cache.min_ttl;
+            cacheJson["max_ttl"] = config->cache.max_ttl;
+            cacheJson["serve_stale_ms"] = config->cache.serve_stale_ms;
+            cacheJson["refresh_ahead_ratio"] = config->cache.refresh_ahead_ratio;
+            cacheJson["refresh_min_hits"] = config->cache.refresh_min_hits;
+            cacheJson["negative_cache"] = config->cache.negative_cache;
+            cacheJson["negative_ttl"] = config->cache.negative_ttl;
+            cacheJson["max_negative_ttl"] = config->cache.max_negative_ttl;
             configJson["cache"] = cacheJson;
 
             // 保存重试配置
             nlohmann::json retryJson;
-            retryJson["max_attempts"] = config_.retry.max_attempts;
-            retryJson["base_delay_ms"] = config_.retry.base_delay_ms;
-            retryJson["max_delay_ms"] = config_.retry.max_delay_ms;
+            retryJson["max_attempts"] = config->retry.max_attempts;
+            retryJson["base_delay_ms"] = config->retry.base_delay_ms;
+            retryJson["max_delay_ms"] = config->retry.max_delay_ms;
             configJson["retry"] = retryJson;
 
+            // 保存健康检查配置
+            nlohmann::json healthJson;
+            healthJson["enabled"] = config->health_check.enabled;
+            healthJson["probe_hostname"] = config->health_check.probe_hostname;
+            healthJson["probe_interval_ms"] = config->health_check.probe_interval_ms;
+            healthJson["max_probe_interval_ms"] = config->health_check.max_probe_interval_ms;
+            healthJson["success_threshold"] = config->health_check.success_threshold;
+            healthJson["half_open_duration_ms"] = config->health_check.half_open_duration_ms;
+            configJson["health_check"] = healthJson;
+
+            // 保存对冲请求配置
+            nlohmann::json hedgingJson;
+            hedgingJson["enabled"] = config->hedging.enabled;
+            hedgingJson["delay_ms"] = config->hedging.delay_ms;
+            hedgingJson["min_delay_ms"] = config->hedging.min_delay_ms;
+            hedgingJson["budget_ratio"] = config->hedging.budget_ratio;
+            hedgingJson["budget_burst"] = config->hedging.budget_burst;
+            hedgingJson["hostnames"] = config->hedging.hostnames;
+            configJson["hedging"] = hedgingJson;
+
+            // 保存Happy Eyeballs配置
+            nlohmann::json happyJson;
+            happyJson["enabled"] = config->happy_eyeballs.enabled;
+            happyJson["resolution_delay_ms"] = config->happy_eyeballs.resolution_delay_ms;
+            configJson["happy_eyeballs"] = happyJson;
+
+            // 保存批量UDP查询配置
+            nlohmann::json udpBatchJson;
+            udpBatchJson["sockets"] = config->udp_batch.sockets;
+            udpBatchJson["batch_size"] = config->udp_batch.batch_size;
+            udpBatchJson["use_0x20"] = config->udp_batch.use_0x20;
+            configJson["udp_batch"] = udpBatchJson;
+
+            // 保存准入队列配置
+            nlohmann::json admissionJson;
+            admissionJson["max_queue_size"] = config->admission.max_queue_size;
+            admissionJson["queue_timeout_ms"] = config->admission.queue_timeout_ms;
+            configJson["admission"] = admissionJson;
+
+            // 保存查询跟踪配置
+            nlohmann::json tracingJson;
+            tracingJson["enabled"] = config->tracing.enabled;
+            tracingJson["sample_rate"] = config->tracing.sample_rate;
+            tracingJson["ring_size"] = config->tracing.ring_size;
+            configJson["tracing"] = tracingJson;
+
             // 保存监控配置
             nlohmann::json metricsJson;
-            metricsJson["enabled"] = config_.metrics.enabled;
-            metricsJson["file"] = config_.metrics.metrics_file;
-            metricsJson["report_interval_sec"] = config_.metrics.report_interval_sec;
+            metricsJson["enabled"] = config->metrics.enabled;
+            metricsJson["file"] = config->metrics.metrics_file;
+            metricsJson["report_interval_sec"] = config->metrics.report_interval_sec;
             configJson["metrics"] = metricsJson;
 
             // 保存全局配置
             nlohmann::json globalJson;
-            globalJson["query_timeout_ms"] = config_.query_timeout_ms;
-            globalJson["max_concurrent_queries"] = config_.max_concurrent_queries;
-            globalJson["ipv6_enabled"] = config_.ipv6_enabled;
+            globalJson["query_timeout_ms"] = config->query_timeout_ms;
+            globalJson["max_concurrent_queries"] = config->max_concurrent_queries;
+            globalJson["ipv6_enabled"] = config->ipv6_enabled;
+            globalJson["managed_io"] = config->managed_io;
+            globalJson["io_threads"] = config->io_threads;
+            globalJson["io_thread_affinity"] = config->io_thread_affinity;
+            globalJson["query_strategy"] = config->query_strategy;
             configJson["global"] = globalJson;
 
             // 添加元数据
@@ -211,7 +348,7 @@ namespace leigod::dns {
     void ConfigManager::notifyConfigChange() const {
         if (changeHandler_) {
             try {
-                changeHandler_(config_);
+                changeHandler_(*std::atomic_load_explicit(&config_, std::memory_order_acquire));
             } catch (const std::exception &e) {
                 DNS_LOGGER_ERROR(logger_, "Error in config change handler: {}", std::string(e.what()));
             }
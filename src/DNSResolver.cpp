@@ -1,46 +1,162 @@
 #include "DNSResolver.h"
+#include "CacheSnapshot.h"
 #include "CaresQueryStrategy.h"
+#include "Hostname.h"
 #include "LRUCache.h"
 #include "PluginManager.h"
+#include "ShardedLRUCache.h"
+#include "SharedMemoryCache.h"
+#include "TinyLfuCache.h"
+#include "UdpBatchQueryStrategy.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <ranges>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace leigod::dns {
 
     namespace {
         // 常量定义
-        constexpr int MAX_HOSTNAME_LENGTH = 253;
-        constexpr int MAX_LABEL_LENGTH = 63;
         constexpr auto CONTEXT_CLEANUP_INTERVAL = std::chrono::seconds(60);
+        // 无定时任务时processEvents()的最长阻塞时间
+        constexpr auto MAX_EVENT_WAIT = std::chrono::milliseconds(1000);
+        constexpr uint32_t MAX_IO_THREADS = 64;
+        // 快照预热每批载入的条目数，批与批之间让出CPU
+        constexpr size_t SNAPSHOT_LOAD_BATCH = 4096;
+
+        // 计算条目实际使用的TTL：未知（负值）的记录TTL回退到默认ttl，再按min_ttl/max_ttl钳制；
+        // 记录TTL为0且min_ttl为0时结果为0，应答不缓存
+        int64_t effectiveTtl(const CacheConfig &config, int64_t record_ttl) {
+            const int64_t ttl = record_ttl < 0 ? config.ttl : record_ttl;
+            return std::clamp(ttl, config.min_ttl, std::max(config.min_ttl, config.max_ttl));
+        }
 
-        // 辅助函数
-        bool isValidHostnameLabel(const std::string &label) {
-            if (label.empty() || label.length() > MAX_LABEL_LENGTH) {
-                return false;
+        // 否定应答的缓存时间，0表示不缓存
+        int64_t negativeTtl(const CacheConfig &config, int64_t ttl) {
+            if (!config.negative_cache) {
+                return 0;
             }
+            return std::min(ttl < 0 ? config.negative_ttl : ttl, config.max_negative_ttl);
+        }
 
-            if (!std::isalnum(label.front()) || !std::isalnum(label.back())) {
-                return false;
+        // 分地址族缓存的键："主机名#A"/"主机名#AAAA"；规范主机名中不会出现'#'，与整体缓存的条目互不冲突
+        std::string familyCacheKey(const std::string &hostname, int family) {
+            return hostname + (family == AF_INET6 ? "#AAAA" : "#A");
+        }
+
+        // 合并两个地址族的TTL：取已知值中较小的一个
+        int64_t minKnownTtl(int64_t lhs, int64_t rhs) {
+            if (lhs < 0) return rhs;
+            if (rhs < 0) return lhs;
+            return std::min(lhs, rhs);
+        }
+
+        // 指数退避加抖动：在[delay/2, delay]内均匀取值，避免针对同一服务器的重试同步
+        std::chrono::milliseconds retryDelay(const RetryConfig &config, uint32_t attempt) {
+            const uint64_t exp = static_cast<uint64_t>(config.base_delay_ms) << std::min<uint32_t>(attempt - 1, 20);
+            const uint64_t delay = std::min<uint64_t>(exp, config.max_delay_ms);
+
+            thread_local std::mt19937_64 rng{std::random_device{}()};
+            std::uniform_int_distribution<uint64_t> jitter(delay / 2, delay);
+            return std::chrono::milliseconds(jitter(rng));
+        }
+
+        // 取消、关闭等本地错误不应重试
+        bool isRetryable(int status) {
+            switch (status) {
+                case ARES_SUCCESS:
+                case ARES_ENODATA:
+                case ARES_ENOTFOUND:
+                case ARES_EBADNAME:
+                case ARES_ECANCELLED:
+                case ARES_EDESTRUCTION:
+                case ARES_ENOTINITIALIZED:
+                    return false;
+                default:
+                    return true;
             }
+        }
 
-            return std::all_of(label.begin(), label.end(), [](char c) {
-                return std::isalnum(c) || c == '-';
-            });
+        // 将当前线程绑定到指定CPU，不支持的平台上忽略
+        void pinCurrentThread(size_t cpu) {
+            const auto cpus = std::max(1u, std::thread::hardware_concurrency());
+            cpu %= cpus;
+#ifdef _WIN32
+            if (cpu < sizeof(DWORD_PTR) * 8) {
+                SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+            }
+#elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void) cpu;
+#endif
         }
 
-        bool isValidHostname(const std::string &hostname) {
-            if (hostname.empty() || hostname.length() > MAX_HOSTNAME_LENGTH) {
-                return false;
+        /**
+         * 在自身I/O线程上关闭的解析器留下的线程：这些线程只剩退出，不能由自身join，也不detach，
+         * 由之后在非I/O线程上的关闭或进程退出时join
+         */
+        class RetiredThreads {
+        public:
+            ~RetiredThreads() { reap(); }
+
+            void retire(std::thread thread) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                threads_.push_back(std::move(thread));
             }
 
-            std::istringstream stream(hostname);
-            std::string label;
-            while (std::getline(stream, label, '.')) {
-                if (!isValidHostnameLabel(label)) {
-                    return false;
+            void reap() {
+                std::vector<std::thread> threads;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    threads.swap(threads_);
+                }
+                for (auto &thread: threads) {
+                    thread.join();
                 }
             }
-            return true;
+
+        private:
+            std::mutex mutex_;
+            std::vector<std::thread> threads_;
+        };
+
+        RetiredThreads &retiredThreads() {
+            static RetiredThreads threads;
+            return threads;
         }
 
+        // resolveMany()的共享状态：每个结果写入各自的下标，最后完成的一方调用批量回调
+        struct BatchState {
+            std::vector<ResolveResult> results;
+            std::atomic<size_t> remaining;
+            DNSResolver::BatchCallback callback;
+            DNSResolver::ResolveCallback on_result;
+
+            BatchState(size_t count, DNSResolver::BatchCallback callback, DNSResolver::ResolveCallback on_result)
+                : results(count), remaining(count), callback(std::move(callback)), on_result(std::move(on_result)) {}
+
+            void complete(size_t index, const ResolveResult &result) {
+                results[index] = result;
+                if (on_result) {
+                    on_result(results[index]);
+                }
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && callback) {
+                    callback(std::move(results));
+                }
+            }
+        };
+
         bool validateConfig(const DNSResolverConfig &config) {
             // 验证服务器配置
             if (config.servers.empty()) {
@@ -60,10 +176,149 @@ namespace leigod::dns {
                 return false;
             }
 
+            // 验证并发与准入队列配置：排队的查询必须有等待时限
+            if (config.max_concurrent_queries == 0 ||
+                (config.admission.max_queue_size > 0 && config.admission.queue_timeout_ms == 0)) {
+                return false;
+            }
+
+            // 验证查询跟踪配置
+            if (config.tracing.enabled &&
+                (config.tracing.sample_rate < 0 || config.tracing.sample_rate > 1 || config.tracing.ring_size == 0)) {
+                return false;
+            }
+
+            // 验证健康检查配置
+            if (config.health_check.enabled &&
+                (config.health_check.probe_interval_ms < 10 ||
+                 config.health_check.max_probe_interval_ms < config.health_check.probe_interval_ms ||
+                 config.health_check.success_threshold < 1)) {
+                return false;
+            }
+
+            // 验证对冲请求配置
+            if (config.hedging.enabled &&
+                (config.hedging.budget_ratio < 0 || config.hedging.budget_ratio > 1)) {
+                return false;
+            }
+
+            // 验证缓存持久化配置
+            if (config.cache.persistent &&
+                (config.cache.cache_file.empty() || config.cache.snapshot_interval_ms < 0)) {
+                return false;
+            }
+
+            // 验证缓存刷新配置
+            if (config.cache.serve_stale_ms < 0 ||
+                config.cache.refresh_ahead_ratio < 0 || config.cache.refresh_ahead_ratio >= 1) {
+                return false;
+            }
+
+            // 验证共享内存缓存配置
+            if (config.cache.type == "shm" && config.cache.shm_name.empty()) {
+                return false;
+            }
+
+            // 验证批量UDP查询配置：只向显式配置的服务器查询
+            if (config.query_strategy == "udp_batch" &&
+                (std::ranges::none_of(config.servers, [](const DNSServerConfig &server) { return server.enabled; }) ||
+                 config.udp_batch.sockets == 0 || config.udp_batch.sockets > 64 ||
+                 config.udp_batch.batch_size == 0 || config.udp_batch.batch_size > 1024)) {
+                return false;
+            }
+
+            // 验证否定缓存配置
+            if (config.cache.negative_cache &&
+                (config.cache.negative_ttl < 0 || config.cache.max_negative_ttl < 0)) {
+                return false;
+            }
+
+            // 验证Happy Eyeballs配置：解析延迟必须短于查询超时
+            if (config.happy_eyeballs.enabled &&
+                config.happy_eyeballs.resolution_delay_ms >= config.query_timeout_ms) {
+                return false;
+            }
+
+            // 验证I/O线程数
+            if (config.io_threads < 1 || config.io_threads > MAX_IO_THREADS) {
+                return false;
+            }
+
             return true;
         }
     }// namespace
 
+    /**
+     * A与AAAA作为两个独立的进行中查询（可能在不同通道上）完成，结果在此汇总：两个地址族都到达后交付合并结果，
+     * progressive时先交付先到达的一方。状态迁移在mutex下进行；逐步交付的回调也在mutex下调用，保证部分结果先于最终结果
+     */
+    struct DNSResolver::DualStackState {
+        // 协程等待者的挂起状态：完成路径与await_suspend()竞争，由后到的一方负责恢复或不挂起
+        enum Phase : int {
+            kRunning,
+            kCompleted,
+            kSuspended,
+        };
+
+        std::mutex mutex;
+        std::string hostname;
+        std::chrono::steady_clock::time_point start_time;
+        bool progressive{false};
+        QueryPriority priority{QueryPriority::kNormal};
+        ResolveCallback callback;// 为空时结果交付给协程等待者
+        std::optional<ResolveResult> ipv4;
+        std::optional<ResolveResult> ipv6;
+        bool partial_delivered{false};
+        bool finished{false};
+
+        std::coroutine_handle<> handle;
+        std::atomic<int> phase{kRunning};
+        ResolveResult result;
+    };
+
+    /**
+     * 查询策略在ares_process_fd()、批量收包等处理过程中调用完成回调，回调里调用的shutdown()
+     * 不能就地销毁仍在处理的通道或正在执行的回调。作用域按线程串成链，支持多个解析器嵌套；
+     * 关闭记录在当前线程上该解析器最外层的作用域中，由它退出时执行
+     */
+    class DNSResolver::DispatchScope {
+    public:
+        explicit DispatchScope(DNSResolver &resolver) : resolver_(resolver), outer_(innermost_) {
+            innermost_ = this;
+        }
+
+        ~DispatchScope() {
+            innermost_ = outer_;
+            if (shutdownPending_) {
+                resolver_.finishShutdown();
+            }
+        }
+
+        DispatchScope(const DispatchScope &) = delete;
+        DispatchScope &operator=(const DispatchScope &) = delete;
+
+        // 当前线程上该解析器最外层的作用域，不在分发中时返回nullptr
+        static DispatchScope *outermost(const DNSResolver &resolver) {
+            DispatchScope *found = nullptr;
+            for (auto *scope = innermost_; scope; scope = scope->outer_) {
+                if (&scope->resolver_ == &resolver) {
+                    found = scope;
+                }
+            }
+            return found;
+        }
+
+        void deferShutdown() { shutdownPending_ = true; }
+
+    private:
+        DNSResolver &resolver_;
+        DispatchScope *outer_;
+        bool shutdownPending_{false};
+        static thread_local DispatchScope *innermost_;
+    };
+
+    thread_local DNSResolver::DispatchScope *DNSResolver::DispatchScope::innermost_ = nullptr;
+
     bool DNSResolver::initialize() {
         bool expected = false;
         if (!initialized_.compare_exchange_strong(expected, true)) {
@@ -72,7 +327,8 @@ namespace leigod::dns {
         }
 
         try {
-            auto config = configManager_->getConfig();
+            const auto snapshot = configManager_->getConfigSnapshot();
+            const auto &config = *snapshot;
 
             // 验证配置
             if (!validateConfig(config)) {
@@ -80,6 +336,9 @@ namespace leigod::dns {
                 initialized_ = false;
                 return false;
             }
+            // 环形缓冲区大小在初始化时确定，采样率由bindConfig()设置并随配置热更新
+            tracer_ = std::make_shared<QueryTracer>(0, config.tracing.ring_size);
+            bindConfig(snapshot);
 
             // 创建并初始化插件管理器
             pluginManager_ = std::make_shared<PluginManager>(logger_);
@@ -92,32 +351,84 @@ namespace leigod::dns {
             pluginConfig.reload_interval = config.plugins.reload_interval;
             pluginManager_->setPluginConfig(pluginConfig);
 
+            // 多通道只在托管模式下可用；外部事件循环只能驱动一个通道
+            managed_ = config.managed_io;
+            pinIoThreads_ = config.io_thread_affinity;
+            size_t channelCount = config.io_threads;
+            if (channelCount > 1 && (!managed_ || eventLoop_)) {
+                DNS_LOGGER_WARN(logger_, "io_threads={} requires managed_io without an external event loop, using 1",
+                                config.io_threads);
+                channelCount = 1;
+            }
+
             // 注册内置查询策略
             pluginManager_->registerQueryStrategyFactory("cares",
                                                          [this](const DNSResolverConfig &config) {
-                                                             return std::make_shared<CaresQueryStrategy>(config, logger_);
+                                                             return std::make_shared<CaresQueryStrategy>(config, logger_, eventLoop_, metrics_);
+                                                         });
+            pluginManager_->registerQueryStrategyFactory("udp_batch",
+                                                         [this](const DNSResolverConfig &config) {
+                                                             return std::make_shared<UdpBatchQueryStrategy>(config, logger_, eventLoop_, metrics_);
                                                          });
 
             // 注册内置缓存
             pluginManager_->registerCacheFactory("lru",
                                                  [](const CacheConfig &config) {
-                                                     return std::make_shared<LRUCache>(config.max_size, config.ttl);
+                                                     return std::make_shared<LRUCache>(config.max_size, config.ttl,
+                                                                                       refreshPolicy(config));
+                                                 });
+            pluginManager_->registerCacheFactory("sharded_lru",
+                                                 [](const CacheConfig &config) {
+                                                     return std::make_shared<ShardedLRUCache>(config.max_size, config.ttl,
+                                                                                              config.shard_count,
+                                                                                              refreshPolicy(config));
+                                                 });
+            pluginManager_->registerCacheFactory("tinylfu",
+                                                 [](const CacheConfig &config) {
+                                                     return std::make_shared<TinyLfuCache>(config.max_size, config.ttl,
+                                                                                           refreshPolicy(config));
+                                                 });
+            pluginManager_->registerCacheFactory("shm",
+                                                 [](const CacheConfig &config) {
+                                                     return SharedMemoryCache::open(config.shm_name, config.max_size,
+                                                                                    config.ttl, refreshPolicy(config));
                                                  });
 
-            // 创建并设置活动插件
-            activeQueryStrategy_ = pluginManager_->createQueryStrategy("cares", config);
-            if (!activeQueryStrategy_) {
-                DNS_LOGGER_ERROR(logger_, "Failed to create query strategy");
-                initialized_ = false;
-                return false;
+            // 创建查询通道：每个通道一个查询策略实例，各自持有独立的事件循环
+            workers_.clear();
+            for (size_t i = 0; i < channelCount; ++i) {
+                auto worker = std::make_unique<IoWorker>();
+                worker->index = i;
+                worker->strategy = pluginManager_->createQueryStrategy(config.query_strategy, config);
+                if (!worker->strategy || !worker->strategy->isInitialized()) {
+                    DNS_LOGGER_ERROR(logger_, "Failed to create query strategy: {}", config.query_strategy);
+                    workers_.clear();
+                    initialized_ = false;
+                    return false;
+                }
+                worker->eventLoop = worker->strategy->eventLoop();
+                if (managed_ && !worker->eventLoop) {
+                    DNS_LOGGER_ERROR(logger_, "Managed I/O requires a query strategy with an event loop");
+                    workers_.clear();
+                    initialized_ = false;
+                    return false;
+                }
+                workers_.push_back(std::move(worker));
             }
 
-            activeCache_ = pluginManager_->createCache("lru", config.cache);
+            activeCache_ = pluginManager_->createCache(config.cache.type, config.cache);
             if (!activeCache_) {
                 DNS_LOGGER_ERROR(logger_, "Failed to create cache");
                 initialized_ = false;
                 return false;
             }
+            queryFamily_ = config.ipv6_enabled ? AF_UNSPEC : AF_INET;
+            dualStack_ = config.ipv6_enabled && config.happy_eyeballs.enabled;
+
+            // 缓存持久化：只映射快照文件，条目由后台线程分批载入
+            if (config.cache.persistent) {
+                startCachePersistence(config.cache);
+            }
 #if 0
             // 加载自定义插件
             if (config.plugins.auto_load) {
@@ -134,7 +445,18 @@ namespace leigod::dns {
                     [this](const DNSResolverConfig &config) {
                         handleConfigChange(config);
                     });
-            DNS_LOGGER_INFO(logger_, "DNSResolver initialized successfully");
+
+            // 启动托管I/O线程，每个通道一个
+            if (managed_) {
+                stopIo_ = false;
+                for (auto &worker: workers_) {
+                    worker->thread = std::thread([weak = weak_from_this(), &worker = *worker]() {
+                        runIoLoop(weak, worker);
+                    });
+                }
+            }
+
+            DNS_LOGGER_INFO(logger_, "DNSResolver initialized successfully with {} query channel(s)", workers_.size());
             return true;
 
         } catch (const std::exception &e) {
@@ -144,40 +466,27 @@ namespace leigod::dns {
         }
     }
 
-    void DNSResolver::resolve(const std::string &hostname, const ResolveCallback &callback) {
+    bool DNSResolver::resolveLocally(const std::string &raw_hostname, ResolveResult &result, QueryTracer::Span *trace) {
+        result.hostname = raw_hostname;
+
         if (!initialized_) {
-            ResolveResult result;
             result.status = ARES_ENOTINITIALIZED;
-            result.hostname = hostname;
-            result.resolution_time = 0;
             result.error = ares_strerror(result.status);
-            callback(result);
-            return;
+            return true;
         }
 
-        // 验证主机名
-        if (!isValidHostname(hostname)) {
-            ResolveResult result;
+        // 验证并规范化主机名：之后的缓存、进行中查询表与上游查询都使用规范形式。
+        // 键不能按线程复用：同步的事件订阅者或完成回调可能在本函数返回前再次调用resolve()
+        HostnameKey key;
+        if (!canonicalizeHostname(raw_hostname, key)) {
             result.status = ARES_EBADNAME;
-            result.hostname = hostname;
-            result.resolution_time = 0;
             result.error = ares_strerror(result.status);
-            callback(result);
-            return;
+            return true;
         }
-
-        // 检查并发限制
-        {
-            std::lock_guard<std::mutex> lock(contexts_mutex_);
-            if (active_contexts_.size() >= configManager_->getConfig().max_concurrent_queries) {
-                ResolveResult result;
-                result.status = ARES_EOF;
-                result.hostname = hostname;
-                result.resolution_time = 0;
-                result.error = ares_strerror(result.status);
-                callback(result);
-                return;
-            }
+        const auto &hostname = key.name;
+        result.hostname = hostname;
+        if (trace) {
+            trace->mark(QueryTracer::Stage::kValidate);
         }
 
         auto start_time = std::chrono::steady_clock::now();
@@ -187,220 +496,1360 @@ namespace leigod::dns {
             eventPublisher_->publishQueryStarted(hostname);
         }
 
+        // Happy Eyeballs模式下两个地址族分别缓存，由resolveDualStack()查询
+        if (dualStack_) {
+            return false;
+        }
+
         // 检查缓存
-        std::vector<std::string> cached_ips;
-        bool cache_hit = false;
+        AddressList cached_ips;
+        CacheLookup lookup;
 
         if (activeCache_) {
-            cache_hit = activeCache_->get(hostname, cached_ips);
+            lookup = activeCache_->lookup(key, cached_ips);
+        }
+        if (trace) {
+            trace->mark(QueryTracer::Stage::kCacheProbe);
         }
 
-        if (cache_hit) {
-            // 缓存命中
-            if (metrics_) {
-                metrics_->recordCacheHit(hostname);
-            }
-
-            ResolveResult result;
-            result.status = ARES_SUCCESS;
-            result.hostname = hostname;
-            result.ip_addresses = cached_ips;
-            result.resolution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                             std::chrono::steady_clock::now() - start_time)
-                                             .count();
-            result.from_cache = true;
-
-            callback(result);
-
-            // 发布查询完成事件
-            if (eventPublisher_) {
-                eventPublisher_->publishQueryCompleted(hostname, cached_ips, true);
-            }
-
-            return;
+        if (lookup.hit) {
+            completeFromCache(hostname, queryFamily_, lookup, std::move(cached_ips), start_time, result);
+            return true;
         }
 
-        // 缓存未命中，执行DNS查询
+        // 缓存未命中，需要执行DNS查询
         if (metrics_) {
             metrics_->recordCacheMiss(hostname);
         }
 
-        // 执行查询
-        if (activeQueryStrategy_) {
-            auto self = shared_from_this();
-            activeQueryStrategy_->query(hostname,
-                                        [self, callback](const ResolveResult &result) {
-                                            self->handleQueryResult(0, result, callback);
-                                        });
-        } else {
-            ResolveResult result;
+        if (workers_.empty()) {
             result.status = ARES_ENODATA;
-            result.hostname = hostname;
-            result.resolution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            result.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
                                              std::chrono::steady_clock::now() - start_time)
                                              .count();
             result.error = ares_strerror(result.status);
-            callback(result);
+            return true;
         }
+
+        return false;
     }
 
-    void DNSResolver::handleQueryResult(int retry_count, ResolveResult result, const ResolveCallback &callback) {
-        std::vector<std::string> old_addresses;
-        // 保存旧地址用于检测变化
-        if (activeCache_) {
-            activeCache_->get(result.hostname, old_addresses);
-        }
+    void DNSResolver::completeFromCache(const std::string &hostname, int family, const CacheLookup &lookup,
+                                        AddressList ips, std::chrono::steady_clock::time_point start_time,
+                                        ResolveResult &result) {
+        fillFromCache(hostname, family, lookup, std::move(ips), start_time, result);
+        recordCompletion(result);
+    }
 
-        // 记录指标
-        if (metrics_) {
-            metrics_->recordQuery(result.hostname, result.resolution_time, result.status == ARES_SUCCESS);
+    void DNSResolver::fillFromCache(const std::string &hostname, int family, const CacheLookup &lookup,
+                                    AddressList ips, std::chrono::steady_clock::time_point start_time,
+                                    ResolveResult &result) {
+        result.from_cache = true;
 
-            if (result.status != ARES_SUCCESS) {
-                metrics_->recordError("resolution_failure", ares_strerror(result.status));
-            }
+        // 否定条目：直接返回缓存的NXDOMAIN/NODATA
+        if (lookup.kind != CacheEntryKind::kAddresses) {
+            result.status = lookup.kind == CacheEntryKind::kNxDomain ? ARES_ENOTFOUND : ARES_ENODATA;
+            result.error = ares_strerror(result.status);
+            result.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now() - start_time)
+                                             .count();
+            return;
         }
 
-        if (result.status == ARES_SUCCESS && !result.ip_addresses.empty()) {
-            // 更新缓存
-            if (activeCache_) {
-                activeCache_->update(result.hostname, result.ip_addresses);
-            }
+        // 热点条目即将过期或已过期：先返回缓存地址，再在后台刷新
+        if (lookup.refresh) {
+            refreshInBackground(hostname, family);
+        }
+
+        result.status = ARES_SUCCESS;
+        result.ip_addresses = std::move(ips);
+        result.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::steady_clock::now() - start_time)
+                                         .count();
+        result.stale = lookup.stale;
+    }
 
-            // 检查地址是否发生变化
-            if (old_addresses != result.ip_addresses) {
-                notifyAddressChange(result.hostname, old_addresses, result.ip_addresses);
+    void DNSResolver::recordCompletion(const ResolveResult &result) {
+        if (metrics_ && result.from_cache) {
+            if (result.status == ARES_SUCCESS) {
+                metrics_->recordCacheHit(result.hostname, result.resolution_time);
+            } else {
+                metrics_->recordNegativeCacheHit(result.hostname, result.resolution_time);
             }
-        } else if (result.status != ARES_SUCCESS && result.status != ARES_ENODATA && result.status != ARES_ENOTFOUND) {
-            // 实施重试策略
-            auto config = configManager_->getConfig();
-            if (retry_count < config.retry.max_attempts) {
-                retry_count++;
+        }
 
-                if (metrics_) {
-                    metrics_->recordRetry(result.hostname, retry_count);
-                }
+        // 发布查询完成事件
+        if (eventPublisher_) {
+            eventPublisher_->publishQueryCompleted(result.hostname, result.ip_addresses,
+                                                   result.status == ARES_SUCCESS);
+        }
+    }
 
-                // 使用指数退避
-                auto delay = config.retry.base_delay_ms * (1 << (retry_count - 1));
-                delay = std::min(delay, config.retry.max_delay_ms);
+    void DNSResolver::resolve(const std::string &hostname, const ResolveCallback &callback, QueryPriority priority) {
+        resolveWith(hostname, callback, true, priority);
+    }
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    void DNSResolver::resolveWith(const std::string &hostname, const ResolveCallback &callback, bool progressive,
+                                  QueryPriority priority) {
+        // Happy Eyeballs模式下两个地址族各自完成，不跟踪
+        auto trace = tracer_ && !dualStack_ ? tracer_->sample(hostname) : nullptr;
 
-                if (activeQueryStrategy_) {
-                    auto self = shared_from_this();
-                    activeQueryStrategy_->query(result.hostname, [self, retry_count, callback](const ResolveResult &result_) {
-                        self->handleQueryResult(retry_count, result_, callback);
-                    });
-                }
-                return;
+        ResolveResult result;
+        if (resolveLocally(hostname, result, trace.get())) {
+            if (trace) {
+                trace->mark(QueryTracer::Stage::kCallback);
+                tracer_->finish(*trace, result);
             }
+            callback(result);
+            return;
         }
 
-        // 调用回调
-        if (callback) {
-            callback(result);
+        if (dualStack_) {
+            resolveDualStack(makeDualStack(std::move(result.hostname), callback, progressive, priority));
+            return;
         }
 
-        // 发布查询完成事件
-        if (eventPublisher_) {
-            eventPublisher_->publishQueryCompleted(result.hostname, result.ip_addresses, result.status == ARES_SUCCESS);
+        // 合并进行中的同名查询：已有查询在途时只挂接回调，不再发送新的请求
+        PendingKey key{std::move(result.hostname), queryFamily_};
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto [it, inserted] = pending_queries_.try_emplace(key);
+            if (trace) {
+                trace->coalesced = !inserted;
+                it->second.waiters.push_back([tracer = tracer_, trace, callback](const ResolveResult &result) {
+                    trace->mark(QueryTracer::Stage::kCallback);
+                    tracer->finish(*trace, result);
+                    callback(result);
+                });
+            } else {
+                it->second.waiters.push_back(callback);
+            }
+            if (!inserted) {
+                return;
+            }
         }
+
+        // 执行查询
+        submitQuery(key, priority, trace);
     }
 
-    void DNSResolver::processEvents() {
-        if (!initialized_) return;
+    DNSResolver::ResolveAwaiter DNSResolver::resolveAsync(std::string hostname, std::stop_token stop) {
+        return ResolveAwaiter(*this, std::move(hostname), std::move(stop));
+    }
 
-        // 处理查询策略事件
-        if (activeQueryStrategy_) {
-            activeQueryStrategy_->processEvents();
-        }
+    std::future<ResolveResult> DNSResolver::resolveFuture(const std::string &hostname) {
+        auto promise = std::make_shared<std::promise<ResolveResult>>();
+        auto future = promise->get_future();
+        resolveWith(hostname, [promise](const ResolveResult &result) {
+            promise->set_value(result);
+        }, false);
+        return future;
     }
 
-    void DNSResolver::shutdown() {
-        bool expected = true;
-        if (!initialized_.compare_exchange_strong(expected, false)) {
-            DNS_LOGGER_WARN(logger_, "DNSResolver is already shutting down");
-            return;
+    bool DNSResolver::ResolveAwaiter::await_ready() {
+        if (resolver_.resolveLocally(hostname_, result_)) {
+            return true;
+        }
+        // 挂起后result_由完成路径写入，取消路径只读取规范化后的hostname_
+        hostname_ = result_.hostname;
+
+        // Happy Eyeballs：两个地址族都命中缓存时同步完成，无需挂起
+        if (resolver_.dualStack_) {
+            dual_ = resolver_.makeDualStack(hostname_, {}, false);
+            resolver_.resolveDualStack(dual_);
+            return dual_->phase.load(std::memory_order_acquire) == DualStackState::kCompleted;
         }
+        return false;
+    }
 
-        DNS_LOGGER_INFO(logger_, "Shutting down DNSResolver");
+    bool DNSResolver::ResolveAwaiter::await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        // 挂接后协程可能随时在其他线程上恢复并销毁this，之后只能使用局部变量
+        auto &resolver = resolver_;
 
-        // 关闭查询策略
-        if (activeQueryStrategy_) {
-            activeQueryStrategy_->shutdown();
+        // 先注册取消回调，再挂接到进行中查询表；挂接与取消都在pending_mutex_下进行，不会丢失取消请求
+        if (stop_.stop_possible()) {
+            stop_callback_.emplace(stop_, CancelCallback{this});
         }
 
-        // 关闭插件管理器
-        if (pluginManager_) {
-            pluginManager_->shutdown();
+        // Happy Eyeballs：查询已在await_ready()中发出，在此之前完成（包括已被取消）时不挂起
+        if (dual_) {
+            dual_->handle = handle;
+            int expected = DualStackState::kRunning;
+            return dual_->phase.compare_exchange_strong(expected, DualStackState::kSuspended,
+                                                        std::memory_order_acq_rel);
         }
 
-        // 保存缓存（如果配置了持久化）
-        if (activeCache_ && configManager_->getConfig().cache.persistent) {
-            // TODO: 实现缓存持久化
+        PendingKey key{hostname_, resolver.queryFamily_};
+        {
+            std::lock_guard<std::mutex> lock(resolver.pending_mutex_);
+            if (stop_.stop_requested()) {
+                result_.status = ARES_ECANCELLED;
+                result_.error = ares_strerror(result_.status);
+                return false;
+            }
+            auto [it, inserted] = resolver.pending_queries_.try_emplace(key);
+            it->second.awaiters.push_back(this);
+            if (!inserted) {
+                return true;
+            }
         }
 
-        initialized_ = false;
-        DNS_LOGGER_INFO(logger_, "DNSResolver shutdown completed");
+        resolver.submitQuery(key);
+        return true;
     }
 
-    void DNSResolver::handleConfigChange(const DNSResolverConfig &config) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        DNS_LOGGER_INFO(logger_, "Applying configuration changes");
+    ResolveResult DNSResolver::ResolveAwaiter::await_resume() {
+        if (dual_) {
+            return std::move(dual_->result);
+        }
+        return std::move(result_);
+    }
 
-        try {
-            // 验证新配置
-            if (!validateConfig(config)) {
-                DNS_LOGGER_ERROR(logger_, "Invalid configuration update");
+    void DNSResolver::ResolveAwaiter::CancelCallback::operator()() const noexcept {
+        awaiter->resolver_.cancelAwaiter(*awaiter);
+    }
+
+    void DNSResolver::cancelAwaiter(ResolveAwaiter &awaiter) {
+        if (awaiter.dual_) {
+            cancelDualStack(*awaiter.dual_);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_queries_.find(PendingKey{awaiter.hostname_, queryFamily_});
+            if (it == pending_queries_.end()) {
                 return;
             }
-#if 0
-            // 更新查询策略配置
-            if (activeQueryStrategy_) {
-                activeQueryStrategy_->updateConfig(config);
+            // 已完成（或尚未挂接）的等待者不在列表中，由完成路径或await_suspend()处理
+            if (std::erase(it->second.awaiters, &awaiter) == 0) {
+                return;
             }
+        }
 
-            // 更新缓存配置
-            if (activeCache_) {
-                activeCache_->updateConfig(config.cache);
-            }
-#endif
-            // 更新插件配置
-            if (pluginManager_) {
-                pluginManager_->setPluginConfig(config.plugins);
-            }
+        // 上游查询不会被取消（c-ares不支持取消单个查询），其应答仍会写入缓存
+        awaiter.result_.status = ARES_ECANCELLED;
+        awaiter.result_.error = ares_strerror(awaiter.result_.status);
+        awaiter.handle_.resume();
+    }
 
-            DNS_LOGGER_INFO(logger_, "Configuration update completed successfully");
-        } catch (const std::exception &e) {
-            DNS_LOGGER_ERROR(logger_, "Error applying configuration changes: {}",
-                             e.what());
+    void DNSResolver::resolveMany(std::span<const std::string> hostnames, BatchCallback callback,
+                                  ResolveCallback on_result, QueryPriority priority) {
+        if (hostnames.empty()) {
+            if (callback) {
+                callback({});
+            }
+            return;
         }
-    }
 
-    void DNSResolver::notifyAddressChange(const std::string &hostname,
-                                          const std::vector<std::string> &old_addresses,
-                                          const std::vector<std::string> &new_addresses) {
-        if (!eventPublisher_) return;
+        const auto start_time = std::chrono::steady_clock::now();
+        auto batch = std::make_shared<BatchState>(hostnames.size(), std::move(callback), std::move(on_result));
+        auto fail = [&](size_t index, int status) {
+            ResolveResult result;
+            result.status = status;
+            result.hostname = hostnames[index];
+            result.error = ares_strerror(status);
+            batch->complete(index, result);
+        };
 
-        DNSAddressEvent event;
-        event.hostname = hostname;
-        event.old_addresses = old_addresses;
-        event.new_addresses = new_addresses;
-        event.timestamp = std::chrono::system_clock::now();
-        event.source = "dns_resolver";
-        event.ttl = configManager_->getConfig().cache.ttl;
-        event.record_type = new_addresses[0].find(':') != std::string::npos ? "AAAA" : "A";
-        event.is_authoritative = false;
+        if (!initialized_) {
+            for (size_t i = 0; i < hostnames.size(); ++i) {
+                fail(i, ARES_ENOTINITIALIZED);
+            }
+            return;
+        }
 
-        eventPublisher_->publishAddressChanged(event);
-    }
+        // 验证并规范化主机名，合法的主机名按原下标记录
+        std::vector<size_t> valid;
+        std::vector<HostnameKey> keys;
+        valid.reserve(hostnames.size());
+        keys.reserve(hostnames.size());
+        for (size_t i = 0; i < hostnames.size(); ++i) {
+            HostnameKey key;
+            if (canonicalizeHostname(hostnames[i], key)) {
+                valid.push_back(i);
+                keys.push_back(std::move(key));
+            } else {
+                fail(i, ARES_EBADNAME);
+            }
+        }
 
-    // 配置管理
+        if (eventPublisher_) {
+            for (const auto &key: keys) {
+                eventPublisher_->publishQueryStarted(key.name);
+            }
+        }
+
+        // Happy Eyeballs模式下逐个主机名分别查询两个地址族
+        if (dualStack_) {
+            for (size_t j = 0; j < keys.size(); ++j) {
+                resolveDualStack(makeDualStack(std::move(keys[j].name),
+                                               [batch, index = valid[j]](const ResolveResult &result) {
+                                                   batch->complete(index, result);
+                                               },
+                                               false, priority));
+            }
+            return;
+        }
+
+        // 批量查询缓存：keys[j]对应hostnames[valid[j]]
+        std::vector<AddressList> cached_ips(keys.size());
+        std::vector<CacheLookup> lookups(keys.size());
+        if (activeCache_) {
+            activeCache_->lookupMany(keys, cached_ips, lookups);
+        }
+
+        std::vector<size_t> misses;// keys中的下标
+        for (size_t j = 0; j < keys.size(); ++j) {
+            const auto &name = keys[j].name;
+            if (!lookups[j].hit) {
+                if (metrics_) {
+                    metrics_->recordCacheMiss(name);
+                }
+                misses.push_back(j);
+                continue;
+            }
+
+            ResolveResult result;
+            result.hostname = name;
+            completeFromCache(name, queryFamily_, lookups[j], std::move(cached_ips[j]), start_time, result);
+            batch->complete(valid[j], result);
+        }
+
+        if (misses.empty()) {
+            return;
+        }
+
+        if (workers_.empty()) {
+            for (const auto j: misses) {
+                fail(valid[j], ARES_ENODATA);
+            }
+            return;
+        }
+
+        // 一次加锁挂接所有等待者（批内重复的主机名也只查询一次），新建的查询一次性提交
+        std::vector<PendingKey> submissions;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            for (const auto j: misses) {
+                PendingKey key{keys[j].name, queryFamily_};
+                auto [it, inserted] = pending_queries_.try_emplace(key);
+                it->second.waiters.emplace_back([batch, index = valid[j]](const ResolveResult &result) {
+                    batch->complete(index, result);
+                });
+                if (inserted) {
+                    submissions.push_back(std::move(key));
+                }
+            }
+        }
+
+        submitQueries(submissions, priority);
+    }
+
+    void DNSResolver::refreshInBackground(const std::string &hostname, int family) {
+        if (workers_.empty()) {
+            return;
+        }
+
+        // 刷新查询没有等待者，应答经handleQueryResult()写回缓存；已有同名查询在途时无需再发
+        PendingKey key{hostname, family};
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (!pending_queries_.try_emplace(key).second) {
+                return;
+            }
+        }
+
+        DNS_LOGGER_DEBUG(logger_, "Refreshing cached entry for {} in background", hostname);
+        submitQuery(key, QueryPriority::kLow);
+    }
+
+    std::shared_ptr<DNSResolver::DualStackState> DNSResolver::makeDualStack(std::string hostname,
+                                                                            ResolveCallback callback,
+                                                                            bool progressive,
+                                                                            QueryPriority priority) {
+        auto state = std::make_shared<DualStackState>();
+        state->hostname = std::move(hostname);
+        state->priority = priority;
+        state->start_time = std::chrono::steady_clock::now();
+        state->progressive = progressive && callback;
+        state->callback = std::move(callback);
+        return state;
+    }
+
+    void DNSResolver::resolveDualStack(const std::shared_ptr<DualStackState> &state) {
+        // RFC 8305：AAAA在前，先结束的查询不必等待另一个地址族
+        constexpr std::array<int, 2> FAMILIES{AF_INET6, AF_INET};
+
+        // 两个地址族的缓存结果不单独计数，命中统计与完成事件在合并结果交付时记录一次
+        std::array<std::optional<ResolveResult>, 2> ready;
+        std::vector<PendingKey> misses;
+        bool missed = false;
+        for (size_t i = 0; i < FAMILIES.size(); ++i) {
+            PendingKey key{state->hostname, FAMILIES[i]};
+            AddressList cached_ips;
+            CacheLookup lookup;
+            if (activeCache_) {
+                lookup = activeCache_->lookup(HostnameKey(cacheKey(key)), cached_ips);
+            }
+
+            if (lookup.hit) {
+                auto &result = ready[i].emplace();
+                result.hostname = state->hostname;
+                fillFromCache(state->hostname, key.family, lookup, std::move(cached_ips), state->start_time, result);
+                continue;
+            }
+
+            missed = true;
+            if (workers_.empty()) {
+                auto &result = ready[i].emplace();
+                result.hostname = state->hostname;
+                result.status = ARES_ENODATA;
+                result.error = ares_strerror(result.status);
+                continue;
+            }
+            misses.push_back(std::move(key));
+        }
+        if (missed && metrics_) {
+            metrics_->recordCacheMiss(state->hostname);
+        }
+
+        // 两个地址族都已就绪时同步完成，不交付部分结果
+        if (ready[0] && ready[1]) {
+            state->ipv6 = std::move(*ready[0]);
+            completeFamily(state, FAMILIES[1], *ready[1]);
+            return;
+        }
+
+        // 先交付缓存中已有的地址族，再挂接未命中的地址族
+        for (size_t i = 0; i < FAMILIES.size(); ++i) {
+            if (ready[i]) {
+                completeFamily(state, FAMILIES[i], *ready[i]);
+            }
+        }
+        if (misses.empty()) {
+            return;
+        }
+
+        std::vector<PendingKey> submissions;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            for (auto &key: misses) {
+                const int family = key.family;
+                auto [it, inserted] = pending_queries_.try_emplace(key);
+                it->second.waiters.emplace_back([this, state, family](const ResolveResult &result) {
+                    completeFamily(state, family, result);
+                });
+                if (inserted) {
+                    submissions.push_back(std::move(key));
+                }
+            }
+        }
+
+        submitQueries(submissions, state->priority);
+    }
+
+    void DNSResolver::completeFamily(const std::shared_ptr<DualStackState> &state, int family,
+                                     const ResolveResult &result) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->finished) {
+            return;
+        }
+        (family == AF_INET6 ? state->ipv6 : state->ipv4) = result;
+
+        if (state->ipv4 && state->ipv6) {
+            state->finished = true;
+            const auto merged = mergeFamilies(*state);
+            recordCompletion(merged);
+            // 协程恢复后等待者可能立即被销毁，不能持锁恢复；只交付一次的回调也无需持锁
+            if (!state->progressive) {
+                lock.unlock();
+            }
+            deliverDualStack(*state, merged);
+            return;
+        }
+
+        // 只有携带地址的一方值得提前交付
+        if (!state->progressive || state->partial_delivered || result.status != ARES_SUCCESS ||
+            result.ip_addresses.empty()) {
+            return;
+        }
+
+        const auto delay =
+                std::atomic_load_explicit(&config_, std::memory_order_acquire)->happy_eyeballs.resolution_delay_ms;
+        if (family == AF_INET6 || delay == 0 || workers_.empty()) {
+            deliverPartial(*state, result);
+            return;
+        }
+
+        // A先到达：再等待AAAA一个解析延迟（RFC 8305第3节），其间AAAA到达则直接交付合并结果
+        auto &worker = workerFor(PendingKey{state->hostname, AF_INET});
+        worker.retryTimers.scheduleAfter(std::chrono::milliseconds(delay),
+                                         [self = shared_from_this(), state]() {
+                                             self->deliverDelayedPartial(state);
+                                         });
+        if (managed_) {
+            worker.eventLoop->wakeup();
+        }
+    }
+
+    void DNSResolver::deliverDelayedPartial(const std::shared_ptr<DualStackState> &state) {
+        auto deliver = [state]() {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->finished && !state->partial_delivered) {
+                deliverPartial(*state, *state->ipv4);
+            }
+        };
+
+        if (completionExecutor_) {
+            completionExecutor_(std::move(deliver));
+        } else {
+            deliver();
+        }
+    }
+
+    void DNSResolver::cancelDualStack(DualStackState &state) {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.finished) {
+                return;
+            }
+            state.finished = true;
+        }
+
+        // 两个地址族的上游查询继续进行，应答仍会写入缓存
+        ResolveResult result;
+        result.hostname = state.hostname;
+        result.status = ARES_ECANCELLED;
+        result.error = ares_strerror(result.status);
+        recordCompletion(result);
+        deliverDualStack(state, result);
+    }
+
+    void DNSResolver::deliverPartial(DualStackState &state, const ResolveResult &result) {
+        state.partial_delivered = true;
+
+        ResolveResult partial = result;
+        partial.hostname = state.hostname;
+        partial.partial = true;
+        partial.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                          std::chrono::steady_clock::now() - state.start_time)
+                                          .count();
+        deliverDualStack(state, partial);
+    }
+
+    void DNSResolver::deliverDualStack(DualStackState &state, const ResolveResult &result) {
+        if (state.callback) {
+            state.callback(result);
+            return;
+        }
+
+        state.result = result;
+        if (state.phase.exchange(DualStackState::kCompleted, std::memory_order_acq_rel) ==
+            DualStackState::kSuspended) {
+            state.handle.resume();
+        }
+    }
+
+    ResolveResult DNSResolver::mergeFamilies(const DualStackState &state) {
+        const auto &ipv6 = *state.ipv6;
+        const auto &ipv4 = *state.ipv4;
+
+        ResolveResult merged;
+        merged.hostname = state.hostname;
+        merged.from_cache = ipv6.from_cache && ipv4.from_cache;
+        merged.stale = ipv6.stale || ipv4.stale;
+        merged.ttl = minKnownTtl(ipv6.ttl, ipv4.ttl);
+        merged.resolution_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::steady_clock::now() - state.start_time)
+                                         .count();
+
+        // IPv6地址在前（RFC 8305第4节）；只有一方有地址时直接共享其快照
+        if (ipv4.ip_addresses.empty()) {
+            merged.ip_addresses = ipv6.ip_addresses;
+        } else if (ipv6.ip_addresses.empty()) {
+            merged.ip_addresses = ipv4.ip_addresses;
+        } else {
+            AddressList::Builder builder;
+            for (const auto &address: ipv6.ip_addresses) {
+                builder.push_back(address);
+            }
+            for (const auto &address: ipv4.ip_addresses) {
+                builder.push_back(address);
+            }
+            merged.ip_addresses = std::move(builder).build();
+        }
+
+        if (!merged.ip_addresses.empty()) {
+            merged.status = ARES_SUCCESS;
+            return merged;
+        }
+
+        // 都没有地址：NXDOMAIN对两个地址族都成立；一方只是没有该类型的记录时以另一方的错误为准
+        auto failure = [](const ResolveResult &result) {
+            return result.status == ARES_SUCCESS ? ARES_ENODATA : result.status;
+        };
+        if (failure(ipv6) == ARES_ENOTFOUND || failure(ipv4) == ARES_ENOTFOUND) {
+            merged.status = ARES_ENOTFOUND;
+        } else {
+            merged.status = failure(ipv4) == ARES_ENODATA ? failure(ipv6) : failure(ipv4);
+        }
+        merged.error = ares_strerror(merged.status);
+        return merged;
+    }
+
+    std::string DNSResolver::cacheKey(const PendingKey &key) const {
+        return dualStack_ ? familyCacheKey(key.hostname, key.family) : key.hostname;
+    }
+
+    DNSResolver::IoWorker &DNSResolver::workerFor(const PendingKey &key) {
+        if (workers_.size() == 1) {
+            return *workers_.front();
+        }
+        return *workers_[PendingKeyHash{}(key) % workers_.size()];
+    }
+
+    void DNSResolver::submitQuery(const PendingKey &key, QueryPriority priority, const TracePtr &trace) {
+        submitQueries(std::span<const PendingKey>(&key, 1), priority, trace);
+    }
+
+    void DNSResolver::submitQueries(std::span<const PendingKey> keys, QueryPriority priority, const TracePtr &trace) {
+        if (keys.empty()) {
+            return;
+        }
+
+        // 与shutdown()并发：等待者先挂接再检查状态，挂接晚于failPendingQueries()的查询在这里直接取消
+        if (!initialized_) {
+            for (const auto &key: keys) {
+                failAdmission(key, ARES_ECANCELLED);
+            }
+            return;
+        }
+
+        // 已有查询排队时新查询也要排队，不能越过等待中的查询
+        const size_t admitted = admissionDepth_.load() == 0 ? acquireSlots(keys.size()) : 0;
+        if (admitted > 0 && trace) {
+            trace->mark(QueryTracer::Stage::kAdmission);
+        }
+        dispatchQueries(keys.first(admitted), trace);
+        if (admitted < keys.size()) {
+            enqueueAdmissions(keys.subspan(admitted), priority, trace);
+        }
+    }
+
+    size_t DNSResolver::acquireSlots(size_t count) {
+        const auto limit = maxConcurrentQueries_.load(std::memory_order_relaxed);
+        auto current = inFlight_.load();
+        while (current < limit) {
+            const auto granted = std::min(count, limit - current);
+            if (inFlight_.compare_exchange_weak(current, current + granted)) {
+                return granted;
+            }
+        }
+        return 0;
+    }
+
+    void DNSResolver::releaseSlot() {
+        inFlight_.fetch_sub(1);
+        if (admissionDepth_.load() > 0) {
+            drainAdmissionQueue();
+        }
+    }
+
+    void DNSResolver::enqueueAdmissions(std::span<const PendingKey> keys, QueryPriority priority,
+                                        const TracePtr &trace) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto deadline = now + std::chrono::milliseconds(admissionTimeoutMs_.load(std::memory_order_relaxed));
+        const auto capacity = maxAdmissionQueue_.load(std::memory_order_relaxed);
+        const auto level = static_cast<size_t>(priority);
+
+        std::vector<PendingKey> rejected;
+        size_t depth;
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(admission_mutex_);
+            was_empty = admissionDepth_.load(std::memory_order_relaxed) == 0;
+            for (const auto &key: keys) {
+                if (admissionDepth_.load(std::memory_order_relaxed) >= capacity) {
+                    // 队列已满：挤出优先级更低的一类中最后入队的查询，没有时拒绝新查询
+                    auto lower = std::find_if(admissionQueues_.rbegin(), admissionQueues_.rend(),
+                                              [](const auto &queue) { return !queue.empty(); });
+                    if (capacity == 0 || lower == admissionQueues_.rend() ||
+                        static_cast<size_t>(admissionQueues_.rend() - lower - 1) <= level) {
+                        rejected.push_back(key);
+                        continue;
+                    }
+                    rejected.push_back(std::move(lower->back().key));
+                    lower->pop_back();
+                    admissionDepth_.fetch_sub(1);
+                }
+                admissionQueues_[level].push_back({key, now, deadline, trace});
+                admissionDepth_.fetch_add(1);
+            }
+            depth = admissionDepth_.load(std::memory_order_relaxed);
+        }
+
+        if (metrics_) {
+            for (size_t i = rejected.size(); i < keys.size(); ++i) {
+                metrics_->recordAdmission(IMetrics::AdmissionOutcome::kQueued, depth, 0);
+            }
+            for (size_t i = 0; i < rejected.size(); ++i) {
+                metrics_->recordAdmission(IMetrics::AdmissionOutcome::kRejected, depth, 0);
+            }
+        }
+        for (const auto &key: rejected) {
+            failAdmission(key, ARES_EOF);
+        }
+
+        // 托管模式下唤醒一个I/O线程，使其等待时间按排队查询的到期时间重新计算
+        if (managed_ && was_empty && depth > 0) {
+            workers_.front()->eventLoop->wakeup();
+        }
+
+        // 入队期间可能有查询结束并归还了槽位，重新检查一次
+        drainAdmissionQueue();
+    }
+
+    void DNSResolver::drainAdmissionQueue() {
+        if (!initialized_) {
+            return;
+        }
+
+        std::vector<PendingKey> admitted;
+        std::vector<AdmissionEntry> traced;// 被采样的查询单独发出，跟踪记录随查询传递
+        std::vector<AdmissionEntry> expired;
+        std::vector<int64_t> waits;
+        size_t depth;
+        const auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(admission_mutex_);
+            // 同一优先级按入队顺序排列，只需检查队首是否到期
+            for (auto &queue: admissionQueues_) {
+                while (!queue.empty() && queue.front().deadline <= now) {
+                    expired.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                    admissionDepth_.fetch_sub(1);
+                }
+            }
+            for (auto &queue: admissionQueues_) {
+                while (!queue.empty() && acquireSlots(1) == 1) {
+                    auto &entry = queue.front();
+                    waits.push_back(std::chrono::duration_cast<std::chrono::microseconds>(now - entry.enqueued).count());
+                    if (entry.trace) {
+                        entry.trace->mark(QueryTracer::Stage::kAdmission);
+                        traced.push_back(std::move(entry));
+                    } else {
+                        admitted.push_back(std::move(entry.key));
+                    }
+                    queue.pop_front();
+                    admissionDepth_.fetch_sub(1);
+                }
+            }
+            depth = admissionDepth_.load(std::memory_order_relaxed);
+        }
+
+        if (metrics_) {
+            for (const auto wait: waits) {
+                metrics_->recordAdmission(IMetrics::AdmissionOutcome::kAdmitted, depth, wait);
+            }
+            for (const auto &entry: expired) {
+                metrics_->recordAdmission(IMetrics::AdmissionOutcome::kExpired, depth,
+                                          std::chrono::duration_cast<std::chrono::microseconds>(now - entry.enqueued)
+                                                  .count());
+            }
+        }
+
+        dispatchQueries(admitted);
+        for (const auto &entry: traced) {
+            dispatchQuery(entry.key, entry.trace);
+        }
+        for (const auto &entry: expired) {
+            failAdmission(entry.key, ARES_ETIMEOUT);
+        }
+    }
+
+    void DNSResolver::failAdmission(const PendingKey &key, int status) {
+        ResolveResult result;
+        result.status = status;
+        result.hostname = key.hostname;
+        result.error = ares_strerror(status);
+        completePendingQuery(key, result);
+
+        // Happy Eyeballs模式下由合并结果发布完成事件
+        if (eventPublisher_ && !dualStack_) {
+            eventPublisher_->publishQueryCompleted(result.hostname, result.ip_addresses, false);
+        }
+    }
+
+    void DNSResolver::dispatchQuery(const PendingKey &key, const TracePtr &trace) {
+        auto &worker = workerFor(key);
+        worker.depth.fetch_add(1, std::memory_order_relaxed);
+
+        if (!managed_) {
+            startQuery(worker, key, 0, trace);
+            return;
+        }
+
+        // 托管模式下由通道所属的I/O线程发起查询，避免多线程同时操作同一c-ares通道
+        worker.submissions.push({key, trace});
+        worker.eventLoop->wakeup();
+    }
+
+    void DNSResolver::dispatchQueries(std::span<const PendingKey> keys, const TracePtr &trace) {
+        if (!managed_ || keys.size() <= 1) {
+            for (const auto &key: keys) {
+                dispatchQuery(key, trace);
+            }
+            return;
+        }
+
+        // 先全部入队，每个涉及的通道只唤醒一次
+        std::vector<bool> touched(workers_.size(), false);
+        for (const auto &key: keys) {
+            auto &worker = workerFor(key);
+            worker.depth.fetch_add(1, std::memory_order_relaxed);
+            worker.submissions.push({key, nullptr});
+            touched[worker.index] = true;
+        }
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            if (touched[i]) {
+                workers_[i]->eventLoop->wakeup();
+            }
+        }
+    }
+
+    void DNSResolver::startQuery(IoWorker &worker, const PendingKey &key, int retry_count, const TracePtr &trace) {
+        if (trace) {
+            trace->mark(QueryTracer::Stage::kSubmit);
+        }
+        auto self = shared_from_this();
+        // 同步失败的查询可能在query()内部回调
+        DispatchScope scope(*this);
+        worker.strategy->query(key.hostname, key.family,
+                               [self, &worker, key, retry_count, trace](const ResolveResult &result) {
+                                   self->handleQueryResult(worker, key, retry_count, result, trace);
+                               });
+    }
+
+    void DNSResolver::completePendingQuery(const PendingKey &key, const ResolveResult &result) {
+        std::vector<ResolveCallback> waiters;
+        std::vector<ResolveAwaiter *> awaiters;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto node = pending_queries_.extract(key);
+            if (!node.empty()) {
+                waiters = std::move(node.mapped().waiters);
+                awaiters = std::move(node.mapped().awaiters);
+            }
+        }
+
+        if (waiters.empty() && awaiters.empty()) {
+            return;
+        }
+
+        auto complete = [logger = logger_, waiters = std::move(waiters), awaiters = std::move(awaiters), result]() {
+            // 协程在完成路径上直接恢复，不经过std::function
+            for (auto *awaiter: awaiters) {
+                awaiter->result_ = result;
+                awaiter->handle_.resume();
+            }
+            for (const auto &waiter: waiters) {
+                try {
+                    if (waiter) {
+                        waiter(result);
+                    }
+                } catch (const std::exception &e) {
+                    DNS_LOGGER_ERROR(logger, "Resolve callback for {} threw: {}", result.hostname, e.what());
+                }
+            }
+        };
+
+        if (completionExecutor_) {
+            completionExecutor_(std::move(complete));
+        } else {
+            complete();
+        }
+    }
+
+    void DNSResolver::failPendingQueries(int status) {
+        std::vector<PendingKey> keys;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            keys.reserve(pending_queries_.size());
+            for (const auto &key: pending_queries_ | std::views::keys) {
+                keys.push_back(key);
+            }
+        }
+
+        for (const auto &key: keys) {
+            ResolveResult result;
+            result.status = status;
+            result.hostname = key.hostname;
+            result.error = ares_strerror(status);
+            completePendingQuery(key, result);
+        }
+    }
+
+    void DNSResolver::handleQueryResult(IoWorker &worker, const PendingKey &key, int retry_count, ResolveResult result,
+                                        const TracePtr &trace) {
+        // 策略层的错误结果可能未填写主机名
+        result.hostname = key.hostname;
+
+        // 记录指标
+        if (metrics_) {
+            metrics_->recordQuery(result.hostname, result.resolution_time, result.status == ARES_SUCCESS);
+
+            if (result.status != ARES_SUCCESS) {
+                metrics_->recordError("resolution_failure", ares_strerror(result.status));
+            }
+        }
+
+        if (result.status == ARES_SUCCESS && !result.ip_addresses.empty()) {
+            const auto ttl =
+                    effectiveTtl(std::atomic_load_explicit(&config_, std::memory_order_acquire)->cache, result.ttl);
+
+            // 更新缓存，同时取回旧地址用于检测变化
+            AddressList old_addresses;
+            if (activeCache_) {
+                activeCache_->exchange(cacheKey(key), result.ip_addresses, std::chrono::milliseconds(ttl),
+                                       old_addresses);
+            }
+
+            // 检查地址是否发生变化；TTL为0的应答不进缓存，没有旧地址可比较时不视为变化，避免每次查询都发事件
+            if (old_addresses != result.ip_addresses && (ttl > 0 || !old_addresses.empty())) {
+                notifyAddressChange(result.hostname, old_addresses, result.ip_addresses, ttl);
+            }
+        } else if (result.status == ARES_ENOTFOUND || result.status == ARES_ENODATA) {
+            // 否定应答（RFC 2308）：不重试，按SOA最小TTL（未知时使用配置的默认值）缓存
+            const auto ttl =
+                    negativeTtl(std::atomic_load_explicit(&config_, std::memory_order_acquire)->cache, result.ttl);
+            if (activeCache_ && ttl > 0) {
+                activeCache_->updateNegative(cacheKey(key),
+                                             result.status == ARES_ENOTFOUND ? CacheEntryKind::kNxDomain
+                                                                             : CacheEntryKind::kNoData,
+                                             std::chrono::milliseconds(ttl));
+            }
+        } else if (isRetryable(result.status) && initialized_) {
+            // 实施重试策略
+            const auto config = std::atomic_load_explicit(&config_, std::memory_order_acquire);
+            if (retry_count < static_cast<int>(config->retry.max_attempts)) {
+                retry_count++;
+
+                if (metrics_) {
+                    metrics_->recordRetry(result.hostname, retry_count);
+                }
+
+                // 使用带抖动的指数退避，到期后在同一通道上重新发起查询
+                auto self = shared_from_this();
+                worker.retryTimers.scheduleAfter(retryDelay(config->retry, retry_count),
+                                                 [self, &worker, key, retry_count, trace]() {
+                                                     self->startQuery(worker, key, retry_count, trace);
+                                                 });
+                return;
+            }
+        }
+
+        // 上游阶段以最终一次尝试为准；查询策略未提供解析完成时间时以交付时间代替
+        if (trace) {
+            if (result.first_packet_ns != 0) {
+                trace->mark(QueryTracer::Stage::kFirstPacket, result.first_packet_ns);
+            }
+            trace->mark(QueryTracer::Stage::kAnswerParsed,
+                        result.answer_parsed_ns != 0 ? result.answer_parsed_ns : QueryTracer::now());
+        }
+
+        worker.depth.fetch_sub(1, std::memory_order_relaxed);
+        releaseSlot();
+
+        // 一次性完成所有等待该查询的调用者
+        completePendingQuery(key, result);
+
+        // 发布查询完成事件；Happy Eyeballs模式下每个地址族的查询不单独发布，由合并结果发布一次
+        if (eventPublisher_ && !dualStack_) {
+            eventPublisher_->publishQueryCompleted(result.hostname, result.ip_addresses, result.status == ARES_SUCCESS);
+        }
+    }
+
+    void DNSResolver::processEvents() {
+        if (!initialized_) return;
+
+        // 托管模式下由内部I/O线程驱动
+        if (managed_ || workers_.empty()) return;
+
+        // 完成回调可能释放解析器的最后一个引用，析构推迟到事件处理返回之后
+        const auto self = weak_from_this().lock();
+        pumpEvents(*workers_.front());
+    }
+
+    void DNSResolver::runIoLoop(const std::weak_ptr<DNSResolver> &weak, IoWorker &worker) {
+        if (auto self = weak.lock(); self && self->pinIoThreads_) {
+            pinCurrentThread(worker.index);
+        }
+
+        // 每一轮只在轮次内持有解析器：回调中释放的最后一个引用推迟到这里析构，
+        // 析构之后本线程只再检查一次weak即返回，不会访问已释放的worker或解析器
+        for (;;) {
+            auto self = weak.lock();
+            if (!self || self->stopIo_) {
+                return;
+            }
+            self->runIoIteration(worker);
+        }
+    }
+
+    void DNSResolver::runIoIteration(IoWorker &worker) {
+        try {
+            // 发起队列中的查询
+            Submission submission;
+            while (worker.submissions.pop(submission)) {
+                startQuery(worker, submission.key, 0, submission.trace);
+            }
+
+            // 没有活动套接字时阻塞在事件循环上，直到有新提交、重试或健康探测到期、或超时
+            if (worker.eventLoop->socketCount() == 0) {
+                worker.eventLoop->wait(worker.strategy->nextTimeout(maxEventWait(worker)),
+                                       [](SocketHandle, bool, bool) {});
+                if (!worker.submissions.empty()) {
+                    return;
+                }
+            }
+
+            pumpEvents(worker);
+        } catch (const std::exception &e) {
+            DNS_LOGGER_ERROR(logger_, "Error in resolver I/O thread {}: {}", worker.index, e.what());
+        }
+    }
+
+    void DNSResolver::stopIoThreads() {
+        stopIo_ = true;
+        const bool onIoThread = std::ranges::any_of(workers_, [](const auto &worker) {
+            return worker->thread.get_id() == std::this_thread::get_id();
+        });
+        for (auto &worker: workers_) {
+            if (!worker->thread.joinable()) {
+                continue;
+            }
+
+            worker->eventLoop->wakeup();
+            if (worker->thread.get_id() == std::this_thread::get_id()) {
+                // 在I/O线程上关闭（回调中调用的shutdown()在本轮分发返回后执行，或释放了最后一个引用）时
+                // 不能join自身：该线程此后只会退出，交给之后的关闭或进程退出时join
+                retiredThreads().retire(std::move(worker->thread));
+            } else {
+                worker->thread.join();
+            }
+        }
+        if (!onIoThread) {
+            retiredThreads().reap();
+        }
+    }
+
+    void DNSResolver::pumpEvents(IoWorker &worker) {
+        // 调用方持有解析器的引用，推迟的关闭在作用域退出时执行
+        DispatchScope scope(*this);
+
+        // 处理查询策略事件，等待时间不超过最近一个重试或排队查询的到期时间
+        worker.strategy->processEvents(maxEventWait(worker));
+
+        // 发起已到期的重试
+        worker.retryTimers.runDue();
+
+        // 丢弃在准入队列中等待超时的查询
+        if (admissionDepth_.load(std::memory_order_relaxed) > 0) {
+            drainAdmissionQueue();
+        }
+
+        // 分批回收过期缓存条目，避免在读路径上扫描；多通道时分摊到各通道
+        const auto cleanup_batch = cacheCleanupBatch_.load(std::memory_order_relaxed);
+        if (activeCache_ && cleanup_batch > 0) {
+            activeCache_->purgeExpired(std::max<size_t>(1, cleanup_batch / workers_.size()));
+        }
+    }
+
+    void DNSResolver::setEventLoop(std::shared_ptr<IEventLoop> eventLoop) {
+        if (initialized_) {
+            DNS_LOGGER_WARN(logger_, "Event loop must be set before initialize()");
+            return;
+        }
+        eventLoop_ = std::move(eventLoop);
+    }
+
+    void DNSResolver::setCompletionExecutor(CompletionExecutor executor) {
+        if (initialized_) {
+            DNS_LOGGER_WARN(logger_, "Completion executor must be set before initialize()");
+            return;
+        }
+        completionExecutor_ = std::move(executor);
+    }
+
+    std::vector<size_t> DNSResolver::getChannelQueueDepths() const {
+        std::vector<size_t> depths;
+        depths.reserve(workers_.size());
+        for (const auto &worker: workers_) {
+            depths.push_back(worker->depth.load(std::memory_order_relaxed));
+        }
+        return depths;
+    }
+
+    size_t DNSResolver::getInFlightQueries() const {
+        return inFlight_.load(std::memory_order_relaxed);
+    }
+
+    size_t DNSResolver::getAdmissionQueueDepth() const {
+        return admissionDepth_.load(std::memory_order_relaxed);
+    }
+
+    void DNSResolver::processSocket(SocketHandle socket, bool readable, bool writable) {
+        if (!initialized_ || managed_ || workers_.empty()) return;
+
+        const auto self = weak_from_this().lock();
+        DispatchScope scope(*this);
+        workers_.front()->strategy->processSocket(socket, readable, writable);
+    }
+
+    std::chrono::milliseconds DNSResolver::nextTimeout() const {
+        if (!initialized_ || workers_.empty()) {
+            return MAX_EVENT_WAIT;
+        }
+
+        const auto &worker = *workers_.front();
+        return worker.strategy->nextTimeout(maxEventWait(worker));
+    }
+
+    std::chrono::milliseconds DNSResolver::maxEventWait(const IoWorker &worker) const {
+        auto wait = worker.retryTimers.timeUntilNext().value_or(MAX_EVENT_WAIT);
+        if (admissionDepth_.load(std::memory_order_relaxed) == 0) {
+            return wait;
+        }
+
+        // 排队的查询到期时需要及时失败，同一优先级只需看队首
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(admission_mutex_);
+        for (const auto &queue: admissionQueues_) {
+            if (!queue.empty()) {
+                wait = std::min(wait, std::max(std::chrono::ceil<std::chrono::milliseconds>(queue.front().deadline - now),
+                                               std::chrono::milliseconds(0)));
+            }
+        }
+        return wait;
+    }
+
+    void DNSResolver::shutdown() {
+        bool expected = true;
+        if (!initialized_.compare_exchange_strong(expected, false)) {
+            DNS_LOGGER_WARN(logger_, "DNSResolver is already shutting down");
+            return;
+        }
+
+        DNS_LOGGER_INFO(logger_, "Shutting down DNSResolver");
+
+        // 在事件分发的回调中调用：查询策略仍在处理当前通道，只停止I/O线程的循环，其余推迟到分发返回之后
+        if (auto *scope = DispatchScope::outermost(*this)) {
+            stopIo_ = true;
+            scope->deferShutdown();
+            return;
+        }
+        finishShutdown();
+    }
+
+    void DNSResolver::finishShutdown() {
+        // 先停止I/O线程，之后由当前线程独占查询策略
+        stopIoThreads();
+
+        // 排队的查询不再发出，其等待者与其他进行中查询一起被取消
+        {
+            std::lock_guard<std::mutex> lock(admission_mutex_);
+            for (auto &queue: admissionQueues_) {
+                queue.clear();
+            }
+            admissionDepth_ = 0;
+        }
+
+        // 关闭各通道的查询策略，丢弃未发出的提交和未执行的重试
+        for (auto &worker: workers_) {
+            Submission unsent;
+            while (worker->submissions.pop(unsent)) {
+            }
+            worker->strategy->shutdown();
+            worker->retryTimers.clear();
+            worker->depth = 0;
+        }
+        inFlight_ = 0;
+
+        // 通知仍在等待的调用者
+        failPendingQueries(ARES_ECANCELLED);
+
+        // 关闭插件管理器
+        if (pluginManager_) {
+            pluginManager_->shutdown();
+        }
+
+        // 保存缓存（如果配置了持久化）
+        stopCachePersistence();
+
+        initialized_ = false;
+        DNS_LOGGER_INFO(logger_, "DNSResolver shutdown completed");
+    }
+
+    void DNSResolver::startCachePersistence(const CacheConfig &config) {
+        snapshotPath_ = config.cache_file;
+        snapshotLoaded_ = false;
+        stopSnapshot_ = false;
+
+        auto snapshot = CacheSnapshot::open(snapshotPath_);
+        if (snapshot) {
+            DNS_LOGGER_INFO(logger_, "Warming cache from snapshot {} ({} entries)", snapshotPath_,
+                            snapshot->entryCount());
+        }
+
+        snapshotThread_ = std::thread([this, snapshot = std::move(snapshot),
+                                       interval = std::chrono::milliseconds(config.snapshot_interval_ms)]() mutable {
+            runSnapshotLoop(std::move(snapshot), interval);
+        });
+    }
+
+    void DNSResolver::stopCachePersistence() {
+        if (!snapshotThread_.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(snapshotMutex_);
+            stopSnapshot_ = true;
+        }
+        snapshotCv_.notify_all();
+        snapshotThread_.join();
+
+        // 预热未完成时缓存中只有部分条目，保留原快照
+        if (snapshotLoaded_) {
+            saveCacheSnapshot();
+        }
+    }
+
+    void DNSResolver::runSnapshotLoop(std::unique_ptr<CacheSnapshot> snapshot, std::chrono::milliseconds interval) {
+        auto stopping = [this]() {
+            std::lock_guard<std::mutex> lock(snapshotMutex_);
+            return stopSnapshot_;
+        };
+
+        // 分批预热，resolve()期间写入的较新应答不会被快照覆盖
+        if (snapshot) {
+            size_t loaded = 0;
+            while (!snapshot->finished() && !stopping()) {
+                loaded += snapshot->loadInto(*activeCache_, SNAPSHOT_LOAD_BATCH);
+                std::this_thread::yield();
+            }
+            if (!snapshot->finished()) {
+                return;
+            }
+            if (snapshot->corrupted()) {
+                DNS_LOGGER_WARN(logger_, "Cache snapshot {} is truncated or corrupted", snapshotPath_);
+            }
+            DNS_LOGGER_INFO(logger_, "Loaded {} cache entries from snapshot", loaded);
+        }
+        snapshotLoaded_ = true;
+
+        std::unique_lock<std::mutex> lock(snapshotMutex_);
+        while (!stopSnapshot_) {
+            if (interval.count() <= 0) {
+                snapshotCv_.wait(lock, [this]() { return stopSnapshot_; });
+                break;
+            }
+            if (snapshotCv_.wait_for(lock, interval, [this]() { return stopSnapshot_; })) {
+                break;
+            }
+            lock.unlock();
+            saveCacheSnapshot();
+            lock.lock();
+        }
+    }
+
+    void DNSResolver::saveCacheSnapshot() {
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto written = CacheSnapshot::write(snapshotPath_, *activeCache_);
+        if (!written) {
+            DNS_LOGGER_ERROR(logger_, "Failed to write cache snapshot {}", snapshotPath_);
+            return;
+        }
+        DNS_LOGGER_DEBUG(logger_, "Wrote {} cache entries to {} in {}ms", *written, snapshotPath_,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                               start_time)
+                                 .count());
+    }
+
+    void DNSResolver::handleConfigChange(const DNSResolverConfig &config) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DNS_LOGGER_INFO(logger_, "Applying configuration changes");
+
+        try {
+            // 验证新配置
+            if (!validateConfig(config)) {
+                DNS_LOGGER_ERROR(logger_, "Invalid configuration update");
+                return;
+            }
+            // 更新查询策略配置：各策略在自己的事件循环线程上应用，不阻塞查询路径
+            for (auto &worker: workers_) {
+                worker->strategy->updateConfig(config);
+            }
+
+            // 更新缓存配置
+            if (activeCache_) {
+                activeCache_->updateConfig(config.cache);
+            }
+
+            bindConfig(std::make_shared<const DNSResolverConfig>(config));
+
+            // 更新插件配置
+            if (pluginManager_) {
+                pluginManager_->setPluginConfig(config.plugins);
+            }
+
+            DNS_LOGGER_INFO(logger_, "Configuration update completed successfully");
+        } catch (const std::exception &e) {
+            DNS_LOGGER_ERROR(logger_, "Error applying configuration changes: {}",
+                             e.what());
+        }
+    }
+
+    void DNSResolver::bindConfig(std::shared_ptr<const DNSResolverConfig> config) {
+        maxConcurrentQueries_.store(config->max_concurrent_queries, std::memory_order_relaxed);
+        maxAdmissionQueue_.store(config->admission.max_queue_size, std::memory_order_relaxed);
+        admissionTimeoutMs_.store(config->admission.queue_timeout_ms, std::memory_order_relaxed);
+        cacheCleanupBatch_.store(config->cache.cleanup_batch_size, std::memory_order_relaxed);
+        if (tracer_) {
+            tracer_->setSampleRate(config->tracing.enabled ? config->tracing.sample_rate : 0);
+        }
+        std::atomic_store_explicit(&config_, std::move(config), std::memory_order_release);
+    }
+
+    void DNSResolver::notifyAddressChange(const std::string &hostname,
+                                          const AddressList &old_addresses,
+                                          const AddressList &new_addresses,
+                                          int64_t ttl) {
+        if (!eventPublisher_) return;
+
+        DNSAddressEvent event;
+        event.hostname = hostname;
+        event.old_addresses = old_addresses;
+        event.new_addresses = new_addresses;
+        event.timestamp = std::chrono::system_clock::now();
+        event.source = "dns_resolver";
+        event.ttl = ttl;
+        event.record_type = new_addresses.front().isIPv6() ? "AAAA" : "A";
+        event.is_authoritative = false;
+
+        eventPublisher_->publishAddressChanged(event);
+    }
+
+    // 配置管理
     void DNSResolver::updateConfig(const DNSResolverConfig &config) {
-#if 0
-        configManager_->setConfig(config);
-#endif
-        handleConfigChange(config);
+        if (!validateConfig(config)) {
+            DNS_LOGGER_ERROR(logger_, "Invalid configuration update");
+            return;
+        }
+        // 初始化后配置管理器会回调handleConfigChange()，初始化前只保存，由initialize()使用
+        configManager_->updateConfig(config);
     }
 
     DNSResolverConfig DNSResolver::getConfig() const {
@@ -420,6 +1869,10 @@ namespace leigod::dns {
         return logger_;
     }
 
+    std::shared_ptr<QueryTracer> DNSResolver::getTracer() const {
+        return tracer_;
+    }
+
     std::shared_ptr<IEventPublisher> DNSResolver::getEventPublisher() const {
         return eventPublisher_;
     }
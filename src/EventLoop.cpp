@@ -0,0 +1,365 @@
+#include "EventLoop.h"
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+
+namespace leigod::dns {
+
+    namespace {
+        int toTimeoutMs(std::chrono::milliseconds timeout) {
+            if (timeout.count() < 0) {
+                return 0;
+            }
+            return static_cast<int>(std::min<int64_t>(timeout.count(), std::numeric_limits<int>::max()));
+        }
+
+#if !defined(_WIN32)
+        // 创建非阻塞、close-on-exec的唤醒管道
+        void createWakePipe(int fds[2]) {
+            if (pipe(fds) != 0) {
+                throw std::runtime_error("pipe() failed: " + std::to_string(errno));
+            }
+            for (int i = 0; i < 2; ++i) {
+                fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+                fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+            }
+        }
+
+        void drainWakePipe(int fd) {
+            char buf[64];
+            while (read(fd, buf, sizeof(buf)) > 0) {
+            }
+        }
+#endif
+    }// namespace
+
+#if defined(__linux__)
+    EpollEventLoop::EpollEventLoop() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw std::runtime_error("epoll_create1() failed: " + std::to_string(errno));
+        }
+
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            close(epoll_fd_);
+            throw std::runtime_error("eventfd() failed: " + std::to_string(errno));
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    }
+
+    EpollEventLoop::~EpollEventLoop() {
+        if (wake_fd_ >= 0) {
+            close(wake_fd_);
+        }
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
+    }
+
+    void EpollEventLoop::wakeup() {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto n = write(wake_fd_, &one, sizeof(one));
+    }
+
+    void EpollEventLoop::updateSocket(SocketHandle socket, bool readable, bool writable) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint32_t events = (readable ? EPOLLIN : 0u) | (writable ? EPOLLOUT : 0u);
+        auto it = interests_.find(socket);
+
+        if (events == 0) {
+            if (it != interests_.end()) {
+                // 套接字可能已被关闭，忽略错误
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+                interests_.erase(it);
+            }
+            return;
+        }
+
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = socket;
+        if (it == interests_.end()) {
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &ev) == 0) {
+                interests_.emplace(socket, events);
+            }
+        } else if (it->second != events) {
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket, &ev) == 0) {
+                it->second = events;
+            }
+        }
+    }
+
+    int EpollEventLoop::wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) {
+        epoll_event events[MAX_EVENTS];
+        const int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, toTimeoutMs(timeout));
+        if (n < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        int ready = 0;
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t value;
+                [[maybe_unused]] auto r = read(wake_fd_, &value, sizeof(value));
+                continue;
+            }
+            // 错误和挂断也按可读处理，由c-ares读取时发现并处理
+            const bool readable = events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+            const bool writable = events[i].events & EPOLLOUT;
+            handler(events[i].data.fd, readable, writable);
+            ++ready;
+        }
+        return ready;
+    }
+
+    size_t EpollEventLoop::socketCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return interests_.size();
+    }
+#endif
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    KqueueEventLoop::KqueueEventLoop() {
+        kqueue_fd_ = kqueue();
+        if (kqueue_fd_ < 0) {
+            throw std::runtime_error("kqueue() failed: " + std::to_string(errno));
+        }
+
+        try {
+            createWakePipe(wake_pipe_);
+        } catch (...) {
+            close(kqueue_fd_);
+            throw;
+        }
+
+        struct kevent change;
+        EV_SET(&change, wake_pipe_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+        kevent(kqueue_fd_, &change, 1, nullptr, 0, nullptr);
+    }
+
+    KqueueEventLoop::~KqueueEventLoop() {
+        for (int fd: wake_pipe_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        if (kqueue_fd_ >= 0) {
+            close(kqueue_fd_);
+        }
+    }
+
+    void KqueueEventLoop::wakeup() {
+        const char byte = 1;
+        [[maybe_unused]] auto n = write(wake_pipe_[1], &byte, 1);
+    }
+
+    void KqueueEventLoop::updateSocket(SocketHandle socket, bool readable, bool writable) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &interest = interests_[socket];
+
+        struct kevent changes[2];
+        int nchanges = 0;
+        if (interest.readable != readable) {
+            EV_SET(&changes[nchanges++], socket, EVFILT_READ, readable ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+        }
+        if (interest.writable != writable) {
+            EV_SET(&changes[nchanges++], socket, EVFILT_WRITE, writable ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+        }
+        if (nchanges > 0) {
+            // 套接字可能已被关闭，删除时的错误可以忽略
+            kevent(kqueue_fd_, changes, nchanges, nullptr, 0, nullptr);
+        }
+
+        interest.readable = readable;
+        interest.writable = writable;
+        if (!readable && !writable) {
+            interests_.erase(socket);
+        }
+    }
+
+    int KqueueEventLoop::wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) {
+        struct kevent events[MAX_EVENTS];
+        const auto ms = toTimeoutMs(timeout);
+        struct timespec ts{};
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = (ms % 1000) * 1000000L;
+
+        const int n = kevent(kqueue_fd_, nullptr, 0, events, MAX_EVENTS, &ts);
+        if (n < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        int ready = 0;
+        for (int i = 0; i < n; ++i) {
+            const auto socket = static_cast<SocketHandle>(events[i].ident);
+            if (socket == wake_pipe_[0]) {
+                drainWakePipe(wake_pipe_[0]);
+                continue;
+            }
+            const bool readable = events[i].filter == EVFILT_READ || (events[i].flags & (EV_EOF | EV_ERROR));
+            const bool writable = events[i].filter == EVFILT_WRITE;
+            handler(socket, readable, writable);
+            ++ready;
+        }
+        return ready;
+    }
+
+    size_t KqueueEventLoop::socketCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return interests_.size();
+    }
+#endif
+
+    PollEventLoop::PollEventLoop() {
+#if defined(_WIN32)
+        // WSAPoll()只能等待套接字，用一个连接到自身的回环UDP套接字作为唤醒通道
+        SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == INVALID_SOCKET) {
+            throw std::runtime_error("socket() failed: " + std::to_string(WSAGetLastError()));
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int len = sizeof(addr);
+        if (::bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::getsockname(s, reinterpret_cast<sockaddr *>(&addr), &len) != 0 ||
+            ::connect(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            closesocket(s);
+            throw std::runtime_error("failed to create wakeup socket: " + std::to_string(WSAGetLastError()));
+        }
+        u_long nonblocking = 1;
+        ioctlsocket(s, FIONBIO, &nonblocking);
+        wake_read_ = wake_write_ = static_cast<SocketHandle>(s);
+#else
+        int fds[2];
+        createWakePipe(fds);
+        wake_read_ = fds[0];
+        wake_write_ = fds[1];
+#endif
+    }
+
+    PollEventLoop::~PollEventLoop() {
+#if defined(_WIN32)
+        closesocket(static_cast<SOCKET>(wake_read_));
+#else
+        close(wake_read_);
+        close(wake_write_);
+#endif
+    }
+
+    void PollEventLoop::wakeup() {
+        const char byte = 1;
+#if defined(_WIN32)
+        ::send(static_cast<SOCKET>(wake_write_), &byte, 1, 0);
+#else
+        [[maybe_unused]] auto n = write(wake_write_, &byte, 1);
+#endif
+    }
+
+    void PollEventLoop::updateSocket(SocketHandle socket, bool readable, bool writable) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!readable && !writable) {
+            interests_.erase(socket);
+        } else {
+            interests_[socket] = Interest{readable, writable};
+        }
+    }
+
+    int PollEventLoop::wait(std::chrono::milliseconds timeout, const ReadyHandler &handler) {
+#if defined(_WIN32)
+        std::vector<WSAPOLLFD> fds;
+#else
+        std::vector<pollfd> fds;
+#endif
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fds.reserve(interests_.size() + 1);
+            // 第一个元素固定为唤醒通道
+            auto &wake = fds.emplace_back();
+            wake.fd = wake_read_;
+            wake.events = POLLIN;
+            wake.revents = 0;
+            for (const auto &[socket, interest]: interests_) {
+                auto &pfd = fds.emplace_back();
+                pfd.fd = socket;
+                pfd.events = static_cast<short>((interest.readable ? POLLIN : 0) | (interest.writable ? POLLOUT : 0));
+                pfd.revents = 0;
+            }
+        }
+
+#if defined(_WIN32)
+        const int n = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), toTimeoutMs(timeout));
+#else
+        const int n = poll(fds.data(), static_cast<nfds_t>(fds.size()), toTimeoutMs(timeout));
+#endif
+        if (n <= 0) {
+            return n < 0 && errno != EINTR ? -1 : 0;
+        }
+
+        if (fds.front().revents != 0) {
+#if defined(_WIN32)
+            char buf[64];
+            while (::recv(static_cast<SOCKET>(wake_read_), buf, sizeof(buf), 0) > 0) {
+            }
+#else
+            drainWakePipe(wake_read_);
+#endif
+        }
+
+        int ready = 0;
+        for (size_t i = 1; i < fds.size(); ++i) {
+            const auto &pfd = fds[i];
+            if (pfd.revents == 0) {
+                continue;
+            }
+            const bool readable = pfd.revents & (POLLIN | POLLERR | POLLHUP);
+            const bool writable = pfd.revents & POLLOUT;
+            handler(static_cast<SocketHandle>(pfd.fd), readable, writable);
+            ++ready;
+        }
+        return ready;
+    }
+
+    size_t PollEventLoop::socketCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return interests_.size();
+    }
+
+    std::shared_ptr<IEventLoop> createDefaultEventLoop() {
+#if defined(__linux__)
+        return std::make_shared<EpollEventLoop>();
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+        return std::make_shared<KqueueEventLoop>();
+#else
+        return std::make_shared<PollEventLoop>();
+#endif
+    }
+
+}// namespace leigod::dns
@@ -1,10 +1,33 @@
-
 #include "EventPublisher.h"
 
 namespace leigod::dns {
+    EventPublisher::EventPublisher() : handlers_(std::make_shared<const Handlers>()) {}
+
+    EventPublisher::EventPublisher(AsyncOptions options)
+        : handlers_(std::make_shared<const Handlers>()),
+          options_(options),
+          ring_(std::make_unique<MpmcRing<Event>>(options.capacity)) {
+        options_.batch_size = std::max<size_t>(options_.batch_size, 1);
+        dispatcher_ = std::thread([this]() { runDispatcher(); });
+    }
+
+    EventPublisher::~EventPublisher() {
+        if (dispatcher_.joinable()) {
+            // 分发线程退出前投递完剩余事件
+            stop_ = true;
+            enqueued_.fetch_add(1, std::memory_order_release);
+            enqueued_.notify_all();
+            dispatcher_.join();
+        }
+    }
+
     void EventPublisher::publishAddressChanged(const DNSAddressEvent &event) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (const auto &handler: addressChangeHandlers_) {
+        if (ring_) {
+            enqueue(event);
+            return;
+        }
+        const auto handlers = std::atomic_load_explicit(&handlers_, std::memory_order_acquire);
+        for (const auto &handler: handlers->addressChange) {
             try {
                 handler(event);
             } catch ([[maybe_unused]] const std::exception &e) {
@@ -14,8 +37,12 @@ namespace leigod::dns {
     }
 
     void EventPublisher::publishQueryStarted(const std::string &hostname) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (const auto &handler: queryStartHandlers_) {
+        if (ring_) {
+            enqueue(QueryStartedEvent{hostname});
+            return;
+        }
+        const auto handlers = std::atomic_load_explicit(&handlers_, std::memory_order_acquire);
+        for (const auto &handler: handlers->queryStart) {
             try {
                 handler(hostname);
             } catch ([[maybe_unused]] const std::exception &e) {
@@ -25,10 +52,14 @@ namespace leigod::dns {
     }
 
     void EventPublisher::publishQueryCompleted(const std::string &hostname,
-                                               const std::vector<std::string> &ips,
+                                               const AddressList &ips,
                                                bool success) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (const auto &handler: queryCompleteHandlers_) {
+        if (ring_) {
+            enqueue(QueryCompletedEvent{hostname, ips, success});
+            return;
+        }
+        const auto handlers = std::atomic_load_explicit(&handlers_, std::memory_order_acquire);
+        for (const auto &handler: handlers->queryComplete) {
             try {
                 handler(hostname, ips, success);
             } catch ([[maybe_unused]] const std::exception &e) {
@@ -38,25 +69,172 @@ namespace leigod::dns {
     }
 
     void EventPublisher::subscribeAddressChange(AddressChangeHandler handler) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        addressChangeHandlers_.push_back(handler);
+        updateHandlers([&](Handlers &handlers) { handlers.addressChange.push_back(std::move(handler)); });
     }
 
     void EventPublisher::subscribeQueryStart(QueryStartHandler handler) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        queryStartHandlers_.push_back(handler);
+        updateHandlers([&](Handlers &handlers) { handlers.queryStart.push_back(std::move(handler)); });
     }
 
     void EventPublisher::subscribeQueryComplete(QueryCompleteHandler handler) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        queryCompleteHandlers_.push_back(handler);
+        updateHandlers([&](Handlers &handlers) { handlers.queryComplete.push_back(std::move(handler)); });
     }
 
     void EventPublisher::unsubscribeAll() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        addressChangeHandlers_.clear();
-        queryStartHandlers_.clear();
-        queryCompleteHandlers_.clear();
+        updateHandlers([](Handlers &handlers) { handlers = {}; });
+    }
+
+    void EventPublisher::flush() {
+        if (!ring_) {
+            return;
+        }
+        const auto target = enqueued_.load(std::memory_order_acquire);
+        for (auto retired = retired_.load(std::memory_order_acquire); retired < target;
+             retired = retired_.load(std::memory_order_acquire)) {
+            retired_.wait(retired, std::memory_order_acquire);
+        }
+    }
+
+    void EventPublisher::updateHandlers(const std::function<void(Handlers &)> &update) {
+        // 写时复制：正在发布的线程继续使用旧列表
+        std::lock_guard<std::mutex> lock(writers_mutex_);
+        auto next = std::make_shared<Handlers>(*handlers_);
+        update(*next);
+        std::atomic_store_explicit(&handlers_, std::shared_ptr<const Handlers>(std::move(next)),
+                                   std::memory_order_release);
+    }
+
+    void EventPublisher::dispatch(const Handlers &handlers, const Event &event) const {
+        if (const auto *started = std::get_if<QueryStartedEvent>(&event)) {
+            for (const auto &handler: handlers.queryStart) {
+                try {
+                    handler(started->hostname);
+                } catch ([[maybe_unused]] const std::exception &e) {
+                    // 忽略处理程序异常
+                }
+            }
+        } else if (const auto *completed = std::get_if<QueryCompletedEvent>(&event)) {
+            for (const auto &handler: handlers.queryComplete) {
+                try {
+                    handler(completed->hostname, completed->ips, completed->success);
+                } catch ([[maybe_unused]] const std::exception &e) {
+                    // 忽略处理程序异常
+                }
+            }
+        } else if (const auto *changed = std::get_if<DNSAddressEvent>(&event)) {
+            for (const auto &handler: handlers.addressChange) {
+                try {
+                    handler(*changed);
+                } catch ([[maybe_unused]] const std::exception &e) {
+                    // 忽略处理程序异常
+                }
+            }
+        }
+    }
+
+    void EventPublisher::enqueue(Event event) {
+        // 同一主机名已有待投递的合并事件时继续合并，保证该主机名的地址变化按顺序投递
+        if (options_.overflow == OverflowPolicy::kCoalesceAddressChanges &&
+            has_coalesced_.load(std::memory_order_acquire)) {
+            if (const auto *change = std::get_if<DNSAddressEvent>(&event)) {
+                std::lock_guard<std::mutex> lock(coalesced_mutex_);
+                if (auto it = coalesced_.find(change->hostname); it != coalesced_.end()) {
+                    mergeAddressChange(it->second, *change);
+                    return;
+                }
+            }
+        }
+
+        while (!ring_->push(event)) {
+            if (options_.overflow == OverflowPolicy::kDropOldest) {
+                // 与分发线程竞争取出最旧的事件，取不到说明分发线程刚腾出了位置
+                Event oldest;
+                if (ring_->pop(oldest)) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    retired_.fetch_add(1, std::memory_order_release);
+                }
+                continue;
+            }
+
+            // 合并策略：地址变化事件按主机名合并，查询事件直接丢弃
+            const auto *change = std::get_if<DNSAddressEvent>(&event);
+            if (!change) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(coalesced_mutex_);
+                auto [it, inserted] = coalesced_.try_emplace(change->hostname, *change);
+                if (!inserted) {
+                    mergeAddressChange(it->second, *change);
+                    return;
+                }
+                has_coalesced_.store(true, std::memory_order_release);
+            }
+            break;
+        }
+
+        enqueued_.fetch_add(1, std::memory_order_release);
+        enqueued_.notify_one();
+    }
+
+    void EventPublisher::runDispatcher() {
+        std::vector<Event> batch;
+        batch.reserve(options_.batch_size);
+
+        for (;;) {
+            const auto seen = enqueued_.load(std::memory_order_acquire);
+
+            batch.clear();
+            Event event;
+            while (batch.size() < options_.batch_size && ring_->pop(event)) {
+                batch.push_back(std::move(event));
+            }
+
+            // 每批只读取一次订阅列表
+            const auto handlers = std::atomic_load_explicit(&handlers_, std::memory_order_acquire);
+            for (const auto &pending: batch) {
+                dispatch(*handlers, pending);
+            }
+            // 合并的地址变化晚于队列中的事件，队列取空后才投递
+            size_t processed = batch.size();
+            if (batch.size() < options_.batch_size) {
+                processed += drainCoalesced(*handlers);
+            }
+
+            if (processed > 0) {
+                retired_.fetch_add(processed, std::memory_order_release);
+                retired_.notify_all();
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire)) {
+                break;
+            }
+            enqueued_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    void EventPublisher::mergeAddressChange(DNSAddressEvent &pending, const DNSAddressEvent &change) {
+        // 保留最早的旧地址与最新的新地址
+        auto old_addresses = std::move(pending.old_addresses);
+        pending = change;
+        pending.old_addresses = std::move(old_addresses);
+    }
+
+    size_t EventPublisher::drainCoalesced(const Handlers &handlers) {
+        if (!has_coalesced_.exchange(false, std::memory_order_acq_rel)) {
+            return 0;
+        }
+
+        std::map<std::string, DNSAddressEvent, std::less<>> events;
+        {
+            std::lock_guard<std::mutex> lock(coalesced_mutex_);
+            events.swap(coalesced_);
+        }
+        for (const auto &[_, change]: events) {
+            dispatch(handlers, change);
+        }
+        return events.size();
     }
 
-}// namespace leigod::dns
\ No newline at end of file
+}// namespace leigod::dns
@@ -0,0 +1,204 @@
+#include "Hostname.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DNS_HOSTNAME_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DNS_HOSTNAME_NEON 1
+#endif
+
+namespace leigod::dns {
+
+    namespace {
+        // 字符分类表，下标为字节值，不依赖locale
+        enum CharClass : uint8_t {
+            kInvalid = 0,
+            kAlnum = 1 << 0,
+            kHyphen = 1 << 1,
+            kDot = 1 << 2,
+            kUpper = 1 << 3,
+        };
+
+        constexpr auto CHAR_CLASS = [] {
+            std::array<uint8_t, 256> table{};
+            for (int c = '0'; c <= '9'; ++c) table[c] = kAlnum;
+            for (int c = 'a'; c <= 'z'; ++c) table[c] = kAlnum;
+            for (int c = 'A'; c <= 'Z'; ++c) table[c] = kAlnum | kUpper;
+            table['-'] = kHyphen;
+            table['.'] = kDot;
+            return table;
+        }();
+
+        // 每次分类的字节数，位掩码的第i位对应块内第i个字节
+        constexpr size_t BLOCK_SIZE = 16;
+
+        struct BlockMasks {
+            uint32_t invalid{0};
+            uint32_t dots{0};
+            uint32_t hyphens{0};
+        };
+
+        /**
+         * 逐块检查标签结构：只依赖分类掩码，标量与SIMD路径共用。
+         * 跨块的状态只有当前标签的起始位置与前一字节是否为'.'/'-'
+         */
+        class LabelScanner {
+        public:
+            bool consume(const BlockMasks &masks, size_t offset, size_t count) {
+                if (masks.invalid) {
+                    return false;
+                }
+                // '-'不能位于标签开头（前一字节为'.'或名称开头）或结尾（后一字节为'.'）
+                const uint32_t after_boundary = (masks.dots << 1) | (prev_boundary_ ? 1u : 0u);
+                const uint32_t before_dot = (masks.hyphens << 1) | (prev_hyphen_ ? 1u : 0u);
+                if ((masks.hyphens & after_boundary) || (before_dot & masks.dots)) {
+                    return false;
+                }
+                // 每遇到一个'.'结束一个标签，空标签（含开头的'.'与连续的'.'）长度为0
+                for (uint32_t dots = masks.dots; dots != 0; dots &= dots - 1) {
+                    const size_t position = offset + static_cast<size_t>(std::countr_zero(dots));
+                    const size_t length = position - label_start_;
+                    if (length == 0 || length > MAX_LABEL_LENGTH) {
+                        return false;
+                    }
+                    label_start_ = position + 1;
+                }
+                const uint32_t last = 1u << (count - 1);
+                prev_boundary_ = (masks.dots & last) != 0;
+                prev_hyphen_ = (masks.hyphens & last) != 0;
+                return true;
+            }
+
+            bool finish(size_t size) const {
+                // 以'.'结尾时最后一个标签已在该'.'处检查
+                if (prev_boundary_) {
+                    return true;
+                }
+                return !prev_hyphen_ && size - label_start_ <= MAX_LABEL_LENGTH;
+            }
+
+        private:
+            size_t label_start_{0};
+            bool prev_boundary_{true};
+            bool prev_hyphen_{false};
+        };
+
+        // 查表分类最多BLOCK_SIZE个字节，out非空时同时写出小写形式
+        BlockMasks classifyScalar(const char *data, size_t count, char *out) {
+            BlockMasks masks;
+            for (size_t i = 0; i < count; ++i) {
+                const auto c = static_cast<uint8_t>(data[i]);
+                const uint8_t cls = CHAR_CLASS[c];
+                const uint32_t bit = 1u << i;
+                if (cls == kInvalid) masks.invalid |= bit;
+                if (cls & kDot) masks.dots |= bit;
+                if (cls & kHyphen) masks.hyphens |= bit;
+                if (out) {
+                    out[i] = static_cast<char>((cls & kUpper) ? c | 0x20 : c);
+                }
+            }
+            return masks;
+        }
+
+#if defined(DNS_HOSTNAME_SSE2)
+        // [lo, hi]范围比较；有符号比较下>=0x80的字节为负数，自然落在所有范围之外
+        inline __m128i inRange(__m128i v, char lo, char hi) {
+            return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                                 _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+        }
+
+        BlockMasks classifyBlock(const char *data, char *out) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            const __m128i upper = inRange(v, 'A', 'Z');
+            const __m128i dots = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+            const __m128i hyphens = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+            const __m128i valid = _mm_or_si128(_mm_or_si128(inRange(v, 'a', 'z'), inRange(v, '0', '9')),
+                                               _mm_or_si128(_mm_or_si128(upper, dots), hyphens));
+            if (out) {
+                const __m128i lowered = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), lowered);
+            }
+            return {.invalid = ~static_cast<uint32_t>(_mm_movemask_epi8(valid)) & 0xFFFFu,
+                    .dots = static_cast<uint32_t>(_mm_movemask_epi8(dots)),
+                    .hyphens = static_cast<uint32_t>(_mm_movemask_epi8(hyphens))};
+        }
+#elif defined(DNS_HOSTNAME_NEON)
+        inline uint8x16_t inRange(uint8x16_t v, uint8_t lo, uint8_t hi) {
+            return vandq_u8(vcgeq_u8(v, vdupq_n_u8(lo)), vcleq_u8(v, vdupq_n_u8(hi)));
+        }
+
+        // NEON没有movemask：按字节位权相与后分别对两个半边做水平加
+        inline uint32_t moveMask(uint8x16_t v) {
+            static constexpr uint8_t WEIGHTS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+            const uint8x16_t bits = vandq_u8(v, vld1q_u8(WEIGHTS));
+            return static_cast<uint32_t>(vaddv_u8(vget_low_u8(bits))) |
+                   (static_cast<uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8);
+        }
+
+        BlockMasks classifyBlock(const char *data, char *out) {
+            const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(data));
+            const uint8x16_t upper = inRange(v, 'A', 'Z');
+            const uint8x16_t dots = vceqq_u8(v, vdupq_n_u8('.'));
+            const uint8x16_t hyphens = vceqq_u8(v, vdupq_n_u8('-'));
+            const uint8x16_t valid = vorrq_u8(vorrq_u8(inRange(v, 'a', 'z'), inRange(v, '0', '9')),
+                                              vorrq_u8(vorrq_u8(upper, dots), hyphens));
+            if (out) {
+                const uint8x16_t lowered = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+                vst1q_u8(reinterpret_cast<uint8_t *>(out), lowered);
+            }
+            return {.invalid = ~moveMask(valid) & 0xFFFFu, .dots = moveMask(dots), .hyphens = moveMask(hyphens)};
+        }
+#else
+        BlockMasks classifyBlock(const char *data, char *out) {
+            return classifyScalar(data, BLOCK_SIZE, out);
+        }
+#endif
+
+        // 单次遍历：完整的块走SIMD分类，剩余字节查表；out非空时写出小写形式（与输入等长）
+        bool scanHostname(std::string_view hostname, char *out) {
+            const size_t size = hostname.size();
+            const size_t name_length = !hostname.empty() && hostname.back() == '.' ? size - 1 : size;
+            if (name_length == 0 || name_length > MAX_HOSTNAME_LENGTH) {
+                return false;
+            }
+
+            LabelScanner scanner;
+            size_t offset = 0;
+            for (; offset + BLOCK_SIZE <= size; offset += BLOCK_SIZE) {
+                if (!scanner.consume(classifyBlock(hostname.data() + offset, out ? out + offset : nullptr), offset,
+                                     BLOCK_SIZE)) {
+                    return false;
+                }
+            }
+            if (offset < size) {
+                const size_t count = size - offset;
+                if (!scanner.consume(classifyScalar(hostname.data() + offset, count, out ? out + offset : nullptr),
+                                     offset, count)) {
+                    return false;
+                }
+            }
+            return scanner.finish(size);
+        }
+    }// namespace
+
+    bool isValidHostname(std::string_view hostname) {
+        return scanHostname(hostname, nullptr);
+    }
+
+    bool canonicalizeHostname(std::string_view hostname, HostnameKey &key) {
+        key.name.resize(hostname.size());
+        if (!scanHostname(hostname, key.name.data())) {
+            return false;
+        }
+        if (key.name.back() == '.') {
+            key.name.pop_back();
+        }
+        key.hash = hostnameHash(key.name);
+        return true;
+    }
+
+}// namespace leigod::dns
@@ -0,0 +1,143 @@
+#include "interface/IPAddress.h"
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace leigod::dns {
+
+    IPAddress IPAddress::fromIPv4(const void *in_addr) {
+        IPAddress address;
+        std::memcpy(address.bytes_.data(), in_addr, 4);
+        address.family_ = Family::kIPv4;
+        return address;
+    }
+
+    IPAddress IPAddress::fromIPv6(const void *in6_addr) {
+        IPAddress address;
+        std::memcpy(address.bytes_.data(), in6_addr, 16);
+        address.family_ = Family::kIPv6;
+        return address;
+    }
+
+    std::optional<IPAddress> IPAddress::parse(std::string_view text) {
+        // inet_pton需要以'\0'结尾的字符串
+        std::array<char, MAX_STRING_LENGTH> buffer{};
+        if (text.empty() || text.size() >= buffer.size()) {
+            return std::nullopt;
+        }
+        std::copy(text.begin(), text.end(), buffer.begin());
+
+        std::array<uint8_t, 16> bytes{};
+        if (inet_pton(AF_INET, buffer.data(), bytes.data()) == 1) {
+            return fromIPv4(bytes.data());
+        }
+        if (inet_pton(AF_INET6, buffer.data(), bytes.data()) == 1) {
+            return fromIPv6(bytes.data());
+        }
+        return std::nullopt;
+    }
+
+    int IPAddress::addressFamily() const {
+        switch (family_) {
+            case Family::kIPv4:
+                return AF_INET;
+            case Family::kIPv6:
+                return AF_INET6;
+            default:
+                return AF_UNSPEC;
+        }
+    }
+
+    std::string_view IPAddress::format(std::array<char, MAX_STRING_LENGTH> &buffer) const {
+        if (family_ == Family::kNone || !inet_ntop(addressFamily(), bytes_.data(), buffer.data(), buffer.size())) {
+            return {};
+        }
+        return {buffer.data()};
+    }
+
+    std::string IPAddress::toString() const {
+        std::array<char, MAX_STRING_LENGTH> buffer{};
+        return std::string(format(buffer));
+    }
+
+    void AddressList::Builder::push_back(const IPAddress &address) {
+        auto &storage = *storage_;
+        if (storage.size < INLINE_CAPACITY) {
+            storage.inline_addresses[storage.size++] = address;
+            return;
+        }
+
+        // 超出内联容量时整体迁移到溢出数组，保证地址连续存放
+        if (storage.size == INLINE_CAPACITY) {
+            storage.overflow.reserve(INLINE_CAPACITY * 2);
+            storage.overflow.assign(storage.inline_addresses.begin(), storage.inline_addresses.end());
+        }
+        storage.overflow.push_back(address);
+        ++storage.size;
+    }
+
+    AddressList::AddressList(std::initializer_list<IPAddress> addresses) {
+        Builder builder;
+        for (const auto &address: addresses) {
+            builder.push_back(address);
+        }
+        *this = std::move(builder).build();
+    }
+
+    AddressList AddressList::fromStrings(const std::vector<std::string> &addresses) {
+        Builder builder;
+        for (const auto &text: addresses) {
+            if (auto address = IPAddress::parse(text)) {
+                builder.push_back(*address);
+            }
+        }
+        return std::move(builder).build();
+    }
+
+    std::vector<std::string> AddressList::toStrings() const {
+        std::vector<std::string> result;
+        result.reserve(size());
+        for (const auto &address: *this) {
+            result.push_back(address.toString());
+        }
+        return result;
+    }
+
+    bool AddressList::operator==(const AddressList &other) const {
+        if (storage_ == other.storage_) {
+            return true;
+        }
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+    std::ostream &operator<<(std::ostream &os, const IPAddress &address) {
+        std::array<char, IPAddress::MAX_STRING_LENGTH> buffer{};
+        return os << address.format(buffer);
+    }
+
+    void to_json(nlohmann::json &j, const IPAddress &address) {
+        j = address.toString();
+    }
+
+    void from_json(const nlohmann::json &j, IPAddress &address) {
+        address = IPAddress::parse(j.get<std::string>()).value_or(IPAddress{});
+    }
+
+    void to_json(nlohmann::json &j, const AddressList &addresses) {
+        j = addresses.toStrings();
+    }
+
+    void from_json(const nlohmann::json &j, AddressList &addresses) {
+        addresses = AddressList::fromStrings(j.get<std::vector<std::string>>());
+    }
+
+}// namespace leigod::dns
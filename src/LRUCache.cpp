@@ -1,80 +1,189 @@
 #include "LRUCache.h"
 
 namespace leigod::dns {
-    bool LRUCache::get(const std::string &hostname, std::vector<std::string> &ips) {
+    bool LRUCache::get(const std::string &hostname, AddressList &ips) {
         std::lock_guard<std::mutex> lock(mutex_);
-        cleanup();
+        return lookupLocked(hostname, ips, false).hit;
+    }
 
-        auto it = cache_.find(hostname);
+    CacheLookup LRUCache::lookup(const HostnameKey &key, AddressList &ips) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lookupLocked(key, ips, true);
+    }
+
+    void LRUCache::lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                              std::span<CacheLookup> results) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            results[i] = lookupLocked(keys[i], ips[i], true);
+        }
+    }
+
+    void LRUCache::lookupSelected(std::span<const HostnameKey> keys, std::span<const size_t> indices,
+                                  std::span<AddressList> ips, std::span<CacheLookup> results) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto i: indices) {
+            results[i] = lookupLocked(keys[i], ips[i], true);
+        }
+    }
+
+    template<typename Key>
+    CacheLookup LRUCache::lookupLocked(const Key &key, AddressList &ips, bool allow_stale) {
+        auto it = cache_.find(key);
         if (it == cache_.end()) {
-            misses_++;
-            return false;
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return {};
         }
 
         auto &entry = it->second;
         const auto now = std::chrono::system_clock::now();
 
+        // 否定条目：未过期时命中（get()不视为命中），过期即删除
+        if (entry.kind != CacheEntryKind::kAddresses) {
+            if (now >= entry.expire_time) {
+                erase(it);
+            } else if (allow_stale) {
+                lru_list_.splice(lru_list_.begin(), lru_list_, entry.lru_iterator);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return {.hit = true, .kind = entry.kind};
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        CacheLookup result;
         if (now >= entry.expire_time) {
-            // 条目已过期
-            cache_.erase(it);
-            lru_list_.erase(entry.lru_iterator);
-            misses_++;
-            return false;
+            // 条目已过期：只有热点条目在serve-stale窗口内返回旧地址
+            const bool servable = now < entry.expire_time + policy_.serve_stale && entry.hits >= policy_.min_hits;
+            if (!servable || !allow_stale) {
+                if (!servable) {
+                    erase(it);
+                }
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                return {};
+            }
+            result.stale = true;
         }
 
-        // 更新LRU位置
-        lru_list_.erase(entry.lru_iterator);
-        lru_list_.push_front(hostname);
-        entry.lru_iterator = lru_list_.begin();
+        // 更新LRU位置与访问次数
+        lru_list_.splice(lru_list_.begin(), lru_list_, entry.lru_iterator);
+        ++entry.hits;
+
+        // 热点条目到达刷新时间后提示调用方后台刷新，刷新完成前按固定间隔重复提示
+        if (allow_stale && now >= entry.next_refresh && entry.hits >= policy_.min_hits &&
+            (result.stale || policy_.refresh_ahead_ratio > 0)) {
+            result.refresh = true;
+            entry.next_refresh = now + REFRESH_RETRY_INTERVAL;
+        }
 
         ips = entry.ips;
-        hits_++;
-        return true;
+        result.hit = true;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    void LRUCache::update(const std::string &hostname, const AddressList &ips,
+                          std::chrono::milliseconds ttl) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        updateLocked(hostname, ips, ttl, nullptr);
+    }
+
+    bool LRUCache::exchange(const std::string &hostname, const AddressList &ips,
+                            std::chrono::milliseconds ttl, AddressList &old_ips) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return updateLocked(hostname, ips, ttl, &old_ips);
     }
 
-    void LRUCache::update(const std::string &hostname, const std::vector<std::string> &ips) {
+    void LRUCache::updateNegative(const std::string &hostname, CacheEntryKind kind, std::chrono::milliseconds ttl) {
+        if (kind == CacheEntryKind::kAddresses || ttl.count() <= 0) {
+            return;
+        }
         std::lock_guard<std::mutex> lock(mutex_);
+        updateLocked(hostname, AddressList{}, ttl, nullptr, kind);
+    }
+
+    bool LRUCache::updateLocked(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl,
+                                AddressList *old_ips, CacheEntryKind kind) {
+        const auto now = std::chrono::system_clock::now();
+        const auto lifetime = ttl.count() < 0 ? ttl_ : ttl;
+        const auto expire_time = now + lifetime;
+        // 未启用提前刷新时，热点条目在过期后（serve-stale）才提示刷新
+        const auto next_refresh = policy_.refresh_ahead_ratio > 0
+                                          ? now + std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                          lifetime * std::min(policy_.refresh_ahead_ratio, 1.0))
+                                          : expire_time;
+        const auto removal_time = removalTime(expire_time, kind);
 
         auto it = cache_.find(hostname);
         if (it != cache_.end()) {
-            // 更新现有条目
+            // 更新现有条目，访问次数重新开始统计
             auto &entry = it->second;
-            lru_list_.erase(entry.lru_iterator);
-            lru_list_.push_front(hostname);
-            entry.lru_iterator = lru_list_.begin();
-            entry.ips = ips;
-            entry.expire_time = std::chrono::system_clock::now() + ttl_;
-        } else {
-            // 添加新条目
-            if (cache_.size() >= max_size_) {
-                evict();
+            const bool fresh = entry.kind == CacheEntryKind::kAddresses && now < entry.expire_time + policy_.serve_stale;
+            if (old_ips && fresh) {
+                *old_ips = std::move(entry.ips);
             }
-
-            CacheEntry entry;
+            // TTL为0的应答不缓存（RFC 1035），旧条目同时作废
+            if (lifetime.count() <= 0) {
+                erase(it);
+                return fresh;
+            }
+            lru_list_.splice(lru_list_.begin(), lru_list_, entry.lru_iterator);
             entry.ips = ips;
-            entry.expire_time = std::chrono::system_clock::now() + ttl_;
-            lru_list_.push_front(hostname);
-            entry.lru_iterator = lru_list_.begin();
+            entry.expire_time = expire_time;
+            entry.next_refresh = next_refresh;
+            entry.hits = 0;
+            entry.kind = kind;
+            expiry_index_.erase(entry.expiry_iterator);
+            entry.expiry_iterator = expiry_index_.emplace(removal_time, &it->first);
+            return fresh;
+        }
+
+        if (lifetime.count() <= 0) {
+            return false;
+        }
+
+        // 添加新条目，容量已满时优先回收已过期条目，其次淘汰LRU条目
+        if (cache_.size() >= max_size_ && cleanup(EVICTION_PURGE_BATCH) == 0) {
+            evict();
+        }
+
+        auto [inserted, _] = cache_.try_emplace(hostname);
+        auto &entry = inserted->second;
+        entry.ips = ips;
+        entry.expire_time = expire_time;
+        entry.next_refresh = next_refresh;
+        entry.kind = kind;
+        lru_list_.push_front(hostname);
+        entry.lru_iterator = lru_list_.begin();
+        entry.expiry_iterator = expiry_index_.emplace(removal_time, &inserted->first);
+        return false;
+    }
 
-            cache_[hostname] = entry;
+    bool LRUCache::insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(hostname);
+        if (it != cache_.end() && std::chrono::system_clock::now() < it->second.expire_time) {
+            return false;
         }
+        updateLocked(hostname, ips, ttl, nullptr);
+        return ttl.count() != 0;
     }
 
     void LRUCache::remove(const std::string &hostname) {
         std::lock_guard<std::mutex> lock(mutex_);
         auto it = cache_.find(hostname);
         if (it != cache_.end()) {
-            lru_list_.erase(it->second.lru_iterator);
-            cache_.erase(it);
+            erase(it);
         }
     }
 
     void LRUCache::clear() {
         std::lock_guard<std::mutex> lock(mutex_);
+        expiry_index_.clear();
         cache_.clear();
         lru_list_.clear();
-        hits_ = 0;
-        misses_ = 0;
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
     }
 
     size_t LRUCache::size() const {
@@ -83,29 +192,91 @@ namespace leigod::dns {
     }
 
     double LRUCache::hit_rate() const {
+        const auto hits = hits_.load(std::memory_order_relaxed);
+        const auto total = hits + misses_.load(std::memory_order_relaxed);
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    size_t LRUCache::purgeExpired(size_t max_entries) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cleanup(max_entries);
+    }
+
+    void LRUCache::forEach(const EntryVisitor &visitor) const {
+        // 加锁期间只复制条目（地址列表只增加引用计数），回调在锁外执行
+        struct Record {
+            std::string hostname;
+            AddressList ips;
+            std::chrono::system_clock::time_point expire_time;
+        };
+        std::vector<Record> records;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now = std::chrono::system_clock::now();
+            records.reserve(cache_.size());
+            for (const auto &[hostname, entry]: cache_) {
+                if (entry.kind == CacheEntryKind::kAddresses && now < entry.expire_time) {
+                    records.push_back({hostname, entry.ips, entry.expire_time});
+                }
+            }
+        }
+
+        for (const auto &record: records) {
+            visitor(record.hostname, record.ips, record.expire_time);
+        }
+    }
+
+    void LRUCache::updateConfig(const CacheConfig &config) {
+        reconfigure(config.max_size, std::chrono::milliseconds(config.ttl), refreshPolicy(config));
+    }
+
+    void LRUCache::reconfigure(size_t max_size, std::chrono::milliseconds ttl, RefreshPolicy policy) {
         std::lock_guard<std::mutex> lock(mutex_);
-        const auto total = hits_ + misses_;
-        return total > 0 ? static_cast<double>(hits_) / total : 0.0;
-    }
-
-    void LRUCache::cleanup() {
-        auto now = std::chrono::system_clock::now();
-        for (auto it = cache_.begin(); it != cache_.end();) {
-            if (now >= it->second.expire_time) {
-                lru_list_.erase(it->second.lru_iterator);
-                it = cache_.erase(it);
-            } else {
-                ++it;
+        max_size_ = max_size;
+        ttl_ = ttl;
+        // 过期索引以expire_time加serve-stale窗口为键，窗口变化时重建
+        if (policy.serve_stale != policy_.serve_stale) {
+            expiry_index_.clear();
+            for (auto &[hostname, entry]: cache_) {
+                const auto stale_window = entry.kind == CacheEntryKind::kAddresses ? policy.serve_stale
+                                                                                   : std::chrono::milliseconds(0);
+                entry.expiry_iterator = expiry_index_.emplace(entry.expire_time + stale_window, &hostname);
+            }
+        }
+        policy_ = policy;
+
+        if (cache_.size() > max_size_) {
+            cleanup(cache_.size() - max_size_);
+        }
+        while (cache_.size() > max_size_) {
+            evict();
+        }
+    }
+
+    size_t LRUCache::cleanup(size_t max_entries) {
+        const auto now = std::chrono::system_clock::now();
+        size_t purged = 0;
+        while (purged < max_entries && !expiry_index_.empty()) {
+            auto head = expiry_index_.begin();
+            if (head->first > now) {
+                break;
             }
+            erase(cache_.find(*head->second));
+            ++purged;
         }
+        return purged;
     }
 
     void LRUCache::evict() {
         if (lru_list_.empty()) return;
 
-        const auto &lru_key = lru_list_.back();
-        cache_.erase(lru_key);
-        lru_list_.pop_back();
+        erase(cache_.find(lru_list_.back()));
+    }
+
+    void LRUCache::erase(EntryMap::iterator it) {
+        expiry_index_.erase(it->second.expiry_iterator);
+        lru_list_.erase(it->second.lru_iterator);
+        cache_.erase(it);
     }
 
-}// namespace leigod::dns
\ No newline at end of file
+}// namespace leigod::dns
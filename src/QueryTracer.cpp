@@ -0,0 +1,251 @@
+#include "QueryTracer.h"
+#include <algorithm>
+#include <ares.h>
+#include <cstring>
+#include <format>
+#include <random>
+#include <unordered_map>
+
+namespace leigod::dns {
+
+    namespace {
+        // 实例ID从1开始分配，0表示线程本地缓存尚未绑定实例
+        std::atomic<uint64_t> next_tracer_id{1};
+
+        constexpr std::array<const char *, QueryTracer::STAGE_COUNT> STAGE_NAMES = {
+                "validate", "cache_probe", "admission", "submit", "first_packet", "answer_parsed", "callback"};
+
+        // 线程本地的xorshift64*：采样判断与ID生成都不需要加锁
+        uint64_t nextRandom() {
+            thread_local uint64_t state = [] {
+                std::random_device device;
+                return (static_cast<uint64_t>(device()) << 32 | device()) | 1;
+            }();
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+
+        uint64_t thresholdFor(double sample_rate) {
+            if (!(sample_rate > 0)) {
+                return 0;
+            }
+            if (sample_rate >= 1) {
+                return UINT64_MAX;
+            }
+            return static_cast<uint64_t>(sample_rate * 18446744073709551616.0);
+        }
+
+        // 最后一个已记录阶段的时间戳，没有时为开始时间
+        int64_t endOf(const QueryTracer::Span &span) {
+            int64_t end = span.start_ns;
+            for (const auto stage: span.stages) {
+                end = std::max(end, stage);
+            }
+            return end;
+        }
+
+        nlohmann::json otlpAttribute(const char *key, nlohmann::json value) {
+            return {{"key", key}, {"value", std::move(value)}};
+        }
+    }// namespace
+
+    QueryTracer::QueryTracer(double sample_rate, size_t ring_size)
+        : id_(next_tracer_id.fetch_add(1, std::memory_order_relaxed)),
+          ring_size_(std::max<size_t>(ring_size, 1)),
+          sample_rate_(sample_rate),
+          threshold_(thresholdFor(sample_rate)),
+          unix_offset_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count() -
+                          now()) {}
+
+    std::shared_ptr<QueryTracer::Span> QueryTracer::sample(const std::string &hostname) {
+        const auto threshold = threshold_.load(std::memory_order_relaxed);
+        if (threshold == 0 || (threshold != UINT64_MAX && nextRandom() >= threshold)) {
+            return nullptr;
+        }
+
+        auto span = std::make_shared<Span>();
+        span->start_ns = now();
+        span->trace_id[0] = nextRandom();
+        span->trace_id[1] = nextRandom();
+        span->span_id = nextRandom();
+        const auto length = std::min(hostname.size(), MAX_HOSTNAME);
+        std::memcpy(span->hostname, hostname.data(), length);
+        span->hostname[length] = '\0';
+        return span;
+    }
+
+    void QueryTracer::finish(Span &span, const ResolveResult &result) {
+        span.status = result.status;
+        span.from_cache = result.from_cache;
+
+        auto &ring = localRing();
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        span.thread = ring.thread;
+        ring.spans[ring.next] = span;
+        ring.next = (ring.next + 1) % ring.spans.size();
+        ring.size = std::min(ring.size + 1, ring.spans.size());
+    }
+
+    QueryTracer::Ring &QueryTracer::localRing() {
+        // 与BasicMetrics的线程分片相同：按实例ID缓存当前线程的缓冲区
+        thread_local uint64_t cached_id = 0;
+        thread_local Ring *cached_ring = nullptr;
+        if (cached_id != id_) {
+            // 本线程持有的缓冲区，线程退出时交还
+            struct ThreadRings {
+                std::unordered_map<uint64_t, std::shared_ptr<Ring>> rings;
+
+                ~ThreadRings() {
+                    for (const auto &[id, ring]: rings) {
+                        ring->owned.store(false, std::memory_order_release);
+                    }
+                }
+            };
+            thread_local ThreadRings thread_rings;
+
+            auto it = thread_rings.rings.find(id_);
+            if (it == thread_rings.rings.end()) {
+                // 释放所属实例已销毁的缓冲区
+                std::erase_if(thread_rings.rings, [](const auto &entry) { return entry.second.use_count() == 1; });
+                it = thread_rings.rings.emplace(id_, acquireRing()).first;
+            }
+            cached_id = id_;
+            cached_ring = it->second.get();
+        }
+        return *cached_ring;
+    }
+
+    std::shared_ptr<QueryTracer::Ring> QueryTracer::acquireRing() {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        // 接管已退出线程的缓冲区：保留其中的记录，线程编号沿用，缓冲区数量不随线程更替增长
+        for (const auto &ring: rings_) {
+            if (!ring->owned.load(std::memory_order_acquire)) {
+                ring->owned.store(true, std::memory_order_relaxed);
+                return ring;
+            }
+        }
+        rings_.push_back(std::make_shared<Ring>(ring_size_, static_cast<uint32_t>(rings_.size() + 1)));
+        return rings_.back();
+    }
+
+    void QueryTracer::setSampleRate(double sample_rate) {
+        sample_rate_.store(sample_rate, std::memory_order_relaxed);
+        threshold_.store(thresholdFor(sample_rate), std::memory_order_relaxed);
+    }
+
+    std::vector<QueryTracer::Span> QueryTracer::collect() const {
+        std::vector<Span> spans;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (const auto &ring: rings_) {
+                std::lock_guard<std::mutex> ring_lock(ring->mutex);
+                const auto capacity = ring->spans.size();
+                for (size_t i = 0; i < ring->size; ++i) {
+                    spans.push_back(ring->spans[(ring->next + capacity - ring->size + i) % capacity]);
+                }
+            }
+        }
+        std::ranges::sort(spans, {}, &Span::start_ns);
+        return spans;
+    }
+
+    void QueryTracer::clear() {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (const auto &ring: rings_) {
+            std::lock_guard<std::mutex> ring_lock(ring->mutex);
+            ring->next = 0;
+            ring->size = 0;
+        }
+    }
+
+    int64_t QueryTracer::toUnixNanos(int64_t steady_ns) const {
+        return steady_ns + unix_offset_ns_;
+    }
+
+    std::string QueryTracer::exportChromeTrace() const {
+        // 每次解析一个完整事件，其下每个阶段一个子事件，覆盖从上一个已记录阶段到该阶段的区间
+        auto events = nlohmann::json::array();
+        for (const auto &span: collect()) {
+            const auto end = endOf(span);
+            events.push_back({{"name", "resolve"},
+                              {"cat", "dns"},
+                              {"ph", "X"},
+                              {"pid", 1},
+                              {"tid", span.thread},
+                              {"ts", span.start_ns / 1000.0},
+                              {"dur", (end - span.start_ns) / 1000.0},
+                              {"args",
+                               {{"hostname", span.hostname},
+                                {"status", span.status},
+                                {"from_cache", span.from_cache},
+                                {"coalesced", span.coalesced}}}});
+
+            int64_t previous = span.start_ns;
+            for (size_t i = 0; i < STAGE_COUNT; ++i) {
+                if (span.stages[i] == 0) {
+                    continue;
+                }
+                events.push_back({{"name", STAGE_NAMES[i]},
+                                  {"cat", "dns"},
+                                  {"ph", "X"},
+                                  {"pid", 1},
+                                  {"tid", span.thread},
+                                  {"ts", previous / 1000.0},
+                                  {"dur", (span.stages[i] - previous) / 1000.0}});
+                previous = span.stages[i];
+            }
+        }
+        return nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ns"}}.dump();
+    }
+
+    std::string QueryTracer::exportOtlpJson() const {
+        // 每次解析一个CLIENT span，各阶段作为span事件；否定应答（NXDOMAIN/NODATA）不视为错误
+        auto spans = nlohmann::json::array();
+        for (const auto &span: collect()) {
+            auto events = nlohmann::json::array();
+            for (size_t i = 0; i < STAGE_COUNT; ++i) {
+                if (span.stages[i] != 0) {
+                    events.push_back({{"timeUnixNano", std::to_string(toUnixNanos(span.stages[i]))},
+                                      {"name", STAGE_NAMES[i]}});
+                }
+            }
+
+            const bool failed = span.status != ARES_SUCCESS && span.status != ARES_ENOTFOUND &&
+                                span.status != ARES_ENODATA;
+            nlohmann::json status = {{"code", failed ? 2 : 1}};
+            if (failed) {
+                status["message"] = ares_strerror(span.status);
+            }
+
+            spans.push_back({{"traceId", std::format("{:016x}{:016x}", span.trace_id[0], span.trace_id[1])},
+                             {"spanId", std::format("{:016x}", span.span_id)},
+                             {"name", "dns.resolve"},
+                             {"kind", 3},
+                             {"startTimeUnixNano", std::to_string(toUnixNanos(span.start_ns))},
+                             {"endTimeUnixNano", std::to_string(toUnixNanos(endOf(span)))},
+                             {"attributes",
+                              nlohmann::json::array({otlpAttribute("dns.hostname", {{"stringValue", span.hostname}}),
+                               otlpAttribute("dns.status", {{"intValue", std::to_string(span.status)}}),
+                               otlpAttribute("dns.from_cache", {{"boolValue", span.from_cache}}),
+                               otlpAttribute("dns.coalesced", {{"boolValue", span.coalesced}}),
+                               otlpAttribute("thread.id", {{"intValue", std::to_string(span.thread)}})})},
+                             {"events", std::move(events)},
+                             {"status", std::move(status)}});
+        }
+
+        nlohmann::json resource_spans;
+        resource_spans["resource"]["attributes"] =
+                nlohmann::json::array({otlpAttribute("service.name", {{"stringValue", "dns_resolver"}})});
+        resource_spans["scopeSpans"] =
+                nlohmann::json::array({{{"scope", {{"name", "leigod.dns"}}}, {"spans", std::move(spans)}}});
+
+        nlohmann::json request;
+        request["resourceSpans"] = nlohmann::json::array({std::move(resource_spans)});
+        return request.dump();
+    }
+
+}// namespace leigod::dns
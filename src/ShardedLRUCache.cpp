@@ -0,0 +1,146 @@
+#include "ShardedLRUCache.h"
+#include <algorithm>
+#include <functional>
+
+namespace leigod::dns {
+
+    namespace {
+        // 每个分片平分容量（向上取整），总容量不低于max_size
+        size_t perShardCapacity(size_t max_size, size_t shard_count) {
+            return std::max<size_t>((max_size + shard_count - 1) / shard_count, 1);
+        }
+    }// namespace
+
+    ShardedLRUCache::ShardedLRUCache(size_t max_size, int64_t ttl, size_t shard_count, RefreshPolicy policy) {
+        shard_count = std::max<size_t>(shard_count, 1);
+        const size_t per_shard = perShardCapacity(max_size, shard_count);
+
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_unique<LRUCache>(per_shard, ttl, policy));
+        }
+    }
+
+    size_t ShardedLRUCache::shardIndex(size_t hash) const {
+        // 混合高位，避免分片索引与分片内部哈希桶索引相关；按64位计算，32位平台上size_t右移32位是未定义行为
+        auto mixed = static_cast<uint64_t>(hash);
+        mixed ^= mixed >> 32;
+        mixed *= 0x9E3779B97F4A7C15ULL;
+        mixed ^= mixed >> 29;
+        return static_cast<size_t>(mixed % shards_.size());
+    }
+
+    LRUCache &ShardedLRUCache::shardFor(const std::string &hostname) const {
+        return *shards_[shardIndex(hostnameHash(hostname))];
+    }
+
+    bool ShardedLRUCache::get(const std::string &hostname, AddressList &ips) {
+        return shardFor(hostname).get(hostname, ips);
+    }
+
+    CacheLookup ShardedLRUCache::lookup(const HostnameKey &key, AddressList &ips) {
+        return shards_[shardIndex(key.hash)]->lookup(key, ips);
+    }
+
+    void ShardedLRUCache::lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                                     std::span<CacheLookup> results) {
+        // 按分片排序下标，使同一分片的主机名连续
+        std::vector<std::pair<size_t, size_t>> order;// (分片, 下标)
+        order.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            order.emplace_back(shardIndex(keys[i].hash), i);
+        }
+        std::ranges::sort(order);
+
+        std::vector<size_t> indices;
+        indices.reserve(order.size());
+        for (size_t begin = 0; begin < order.size();) {
+            const size_t shard = order[begin].first;
+            indices.clear();
+            size_t end = begin;
+            for (; end < order.size() && order[end].first == shard; ++end) {
+                indices.push_back(order[end].second);
+            }
+            shards_[shard]->lookupSelected(keys, indices, ips, results);
+            begin = end;
+        }
+    }
+
+    void ShardedLRUCache::update(const std::string &hostname, const AddressList &ips,
+                                 std::chrono::milliseconds ttl) {
+        shardFor(hostname).update(hostname, ips, ttl);
+    }
+
+    bool ShardedLRUCache::exchange(const std::string &hostname, const AddressList &ips,
+                                   std::chrono::milliseconds ttl, AddressList &old_ips) {
+        return shardFor(hostname).exchange(hostname, ips, ttl, old_ips);
+    }
+
+    void ShardedLRUCache::updateNegative(const std::string &hostname, CacheEntryKind kind,
+                                         std::chrono::milliseconds ttl) {
+        shardFor(hostname).updateNegative(hostname, kind, ttl);
+    }
+
+    bool ShardedLRUCache::insert(const std::string &hostname, const AddressList &ips,
+                                 std::chrono::milliseconds ttl) {
+        return shardFor(hostname).insert(hostname, ips, ttl);
+    }
+
+    void ShardedLRUCache::remove(const std::string &hostname) {
+        shardFor(hostname).remove(hostname);
+    }
+
+    void ShardedLRUCache::clear() {
+        for (const auto &shard: shards_) {
+            shard->clear();
+        }
+    }
+
+    size_t ShardedLRUCache::size() const {
+        size_t total = 0;
+        for (const auto &shard: shards_) {
+            total += shard->size();
+        }
+        return total;
+    }
+
+    double ShardedLRUCache::hit_rate() const {
+        // 只读取各分片的relaxed原子计数器，不获取任何锁
+        size_t hits = 0;
+        size_t misses = 0;
+        for (const auto &shard: shards_) {
+            hits += shard->hits();
+            misses += shard->misses();
+        }
+        const auto total = hits + misses;
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    size_t ShardedLRUCache::purgeExpired(size_t max_entries) {
+        // 回收预算平均分给各分片，每次只锁一个分片
+        const size_t per_shard = std::max<size_t>((max_entries + shards_.size() - 1) / shards_.size(), 1);
+        size_t purged = 0;
+        for (const auto &shard: shards_) {
+            if (purged >= max_entries) {
+                break;
+            }
+            purged += shard->purgeExpired(std::min(per_shard, max_entries - purged));
+        }
+        return purged;
+    }
+
+    void ShardedLRUCache::forEach(const EntryVisitor &visitor) const {
+        for (const auto &shard: shards_) {
+            shard->forEach(visitor);
+        }
+    }
+
+    void ShardedLRUCache::updateConfig(const CacheConfig &config) {
+        const size_t per_shard = perShardCapacity(config.max_size, shards_.size());
+        const auto policy = refreshPolicy(config);
+        for (auto &shard: shards_) {
+            shard->reconfigure(per_shard, std::chrono::milliseconds(config.ttl), policy);
+        }
+    }
+
+}// namespace leigod::dns
@@ -0,0 +1,672 @@
+#include "SharedMemoryCache.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace leigod::dns {
+
+    namespace {
+        constexpr uint64_t SEGMENT_MAGIC = 0x314d48534e44444cULL;// "LDDNSHM1"
+        constexpr uint32_t LAYOUT_VERSION = 2;
+        // 读方遇到正在写入的桶时的重试次数，超过后视为未命中
+        constexpr int READ_RETRIES = 64;
+        // 后台刷新提示后，刷新未完成（或失败）时再次提示的间隔
+        constexpr int64_t REFRESH_RETRY_INTERVAL_MS = 1000;
+
+        static_assert(std::atomic_ref<uint64_t>::is_always_lock_free &&
+                              std::atomic_ref<uint32_t>::is_always_lock_free &&
+                              std::atomic_ref<int64_t>::is_always_lock_free,
+                      "shared memory cache requires lock-free 32/64-bit atomics");
+
+        template<typename T>
+        T load(T &value, std::memory_order order = std::memory_order_relaxed) {
+            return std::atomic_ref<T>(value).load(order);
+        }
+
+        template<typename T>
+        void store(T &value, T desired, std::memory_order order = std::memory_order_relaxed) {
+            std::atomic_ref<T>(value).store(desired, order);
+        }
+
+        int64_t nowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+        }
+
+        // 桶标签：0表示空桶
+        uint64_t tagOf(size_t hash) {
+            const auto tag = static_cast<uint64_t>(hash);
+            return tag != 0 ? tag : 1;
+        }
+
+        uint32_t currentProcess() {
+#if defined(_WIN32)
+            return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+            return static_cast<uint32_t>(getpid());
+#endif
+        }
+
+        // 进程是否仍在运行；无法确定时按仍在运行处理
+        bool processAlive(uint32_t pid) {
+#if defined(_WIN32)
+            HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+            if (!process) {
+                return GetLastError() != ERROR_INVALID_PARAMETER;
+            }
+            const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+            CloseHandle(process);
+            return alive;
+#else
+            return kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+#endif
+        }
+    }// namespace
+
+    /**
+     * 段头，位于段的起始位置；除entries外只在初始化锁内写入。
+     * magic最后以release写入，读到SEGMENT_MAGIC表示其余字段与桶数组均已初始化
+     */
+    struct alignas(64) SharedMemoryCache::SegmentHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t bucket_size;
+        uint64_t bucket_count;
+        uint64_t hash_check;// 主机名哈希函数的指纹，不同构建的哈希不一致时拒绝共享
+        uint64_t entries;   // 已占用的桶数（近似值），原子访问
+    };
+
+    /**
+     * 桶的载荷，可平凡拷贝；读方按64位字复制出一致的快照后再解析
+     */
+    struct SharedMemoryCache::Entry {
+        uint64_t tag;// 主机名哈希，0表示空桶；必须位于开头，读方先比较它再复制整个载荷
+        int64_t expire_ms;
+        CacheEntryKind kind;
+        uint8_t address_count;
+        uint16_t name_length;
+        uint32_t reserved;
+        char name[MAX_KEY_LENGTH];
+        IPAddress addresses[MAX_ADDRESSES];
+    };
+
+    /**
+     * 桶：seq为奇数时正在写入，owner为持有写锁的进程ID（0表示尚未写入或未加锁）。
+     * hits与next_refresh_ms在seqlock之外原子更新，读方据此统计访问次数，
+     * 并以CAS保证所有进程中只有一个收到刷新提示
+     */
+    struct alignas(64) SharedMemoryCache::Bucket {
+        static_assert(std::is_trivially_copyable_v<Entry>);
+        static constexpr size_t PAYLOAD_WORDS = (sizeof(Entry) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        uint32_t seq;
+        uint32_t hits;
+        int64_t next_refresh_ms;
+        uint32_t owner;
+        uint32_t reserved;
+        uint64_t payload[PAYLOAD_WORDS];
+    };
+
+    namespace {
+        template<typename Header, typename Bucket>
+        constexpr size_t segmentSize(uint64_t bucket_count) {
+            return sizeof(Header) + bucket_count * sizeof(Bucket);
+        }
+
+        // 不同主机名哈希实现的构建不能共享段：桶位置会不一致
+        uint64_t hashFingerprint() {
+            return static_cast<uint64_t>(hostnameHash("leigod.dns.shm"));
+        }
+    }// namespace
+
+    SharedMemoryCache::SharedMemoryCache(void *base, size_t mapped_size, int64_t ttl, RefreshPolicy policy)
+        : base_(base), mapped_size_(mapped_size), header_(static_cast<SegmentHeader *>(base)),
+          buckets_(reinterpret_cast<Bucket *>(static_cast<char *>(base) + sizeof(SegmentHeader))),
+          bucket_count_(header_->bucket_count), ttl_ms_(ttl), serve_stale_ms_(0), refresh_ahead_ratio_(0.0),
+          min_hits_(0) {
+        setPolicy(std::chrono::milliseconds(ttl), policy);
+    }
+
+    SharedMemoryCache::~SharedMemoryCache() {
+#if defined(_WIN32)
+        UnmapViewOfFile(base_);
+#else
+        munmap(base_, mapped_size_);
+#endif
+    }
+
+    std::shared_ptr<SharedMemoryCache> SharedMemoryCache::open(const std::string &name, size_t max_size, int64_t ttl,
+                                                               RefreshPolicy policy) {
+        if (name.empty()) {
+            return nullptr;
+        }
+        const uint64_t requested = std::bit_ceil(std::max<size_t>(max_size, PROBE_LIMIT));
+        const size_t requested_size = segmentSize<SegmentHeader, Bucket>(requested);
+
+        // 在初始化锁内检查段头：未初始化（新建，或上一个初始化者中途崩溃）时按requested与段的实际尺寸重建
+        auto initialize = [&](void *base, size_t size) {
+            auto *header = static_cast<SegmentHeader *>(base);
+            if (load(header->magic, std::memory_order_acquire) == SEGMENT_MAGIC) {
+                return true;
+            }
+            const uint64_t bucket_count =
+                    std::min<uint64_t>(requested, std::bit_floor((size - sizeof(SegmentHeader)) / sizeof(Bucket)));
+            if (bucket_count < PROBE_LIMIT) {
+                return false;
+            }
+            std::memset(base, 0, segmentSize<SegmentHeader, Bucket>(bucket_count));
+            header->version = LAYOUT_VERSION;
+            header->bucket_size = sizeof(Bucket);
+            header->bucket_count = bucket_count;
+            header->hash_check = hashFingerprint();
+            store(header->magic, SEGMENT_MAGIC, std::memory_order_release);
+            return true;
+        };
+
+        void *base = nullptr;
+        size_t mapped_size = 0;
+#if defined(_WIN32)
+        // 文件映射的大小由创建者决定；以命名互斥量作为初始化锁，持有者崩溃时互斥量被放弃（WAIT_ABANDONED）
+        HANDLE lock = CreateMutexA(nullptr, FALSE, (name + ".init").c_str());
+        if (!lock) {
+            return nullptr;
+        }
+        const DWORD wait = WaitForSingleObject(lock, INFINITE);
+        if (wait != WAIT_OBJECT_0 && wait != WAIT_ABANDONED) {
+            CloseHandle(lock);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            static_cast<DWORD>(static_cast<uint64_t>(requested_size) >> 32),
+                                            static_cast<DWORD>(requested_size & 0xFFFFFFFFu), name.c_str());
+        if (mapping) {
+            base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+            // 视图保持映射对象存活
+            CloseHandle(mapping);
+        }
+        if (base) {
+            MEMORY_BASIC_INFORMATION info{};
+            mapped_size = VirtualQuery(base, &info, sizeof(info)) ? info.RegionSize : 0;
+            if (mapped_size < sizeof(SegmentHeader) || !initialize(base, mapped_size)) {
+                UnmapViewOfFile(base);
+                base = nullptr;
+            }
+        }
+        ReleaseMutex(lock);
+        CloseHandle(lock);
+        if (!base) {
+            return nullptr;
+        }
+#else
+        const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            return nullptr;
+        }
+        // flock由内核在持有者退出（包括崩溃）时释放
+        if (flock(fd, LOCK_EX) != 0) {
+            close(fd);
+            return nullptr;
+        }
+        struct stat st{};
+        bool ok = fstat(fd, &st) == 0;
+        if (ok && static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+            // 新建的段（或创建者在设定尺寸前崩溃）：只有持锁者设定尺寸，已初始化的段永不缩小
+            ok = ftruncate(fd, static_cast<off_t>(requested_size)) == 0 && fstat(fd, &st) == 0;
+        }
+        if (ok) {
+            mapped_size = static_cast<size_t>(st.st_size);
+            base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+            } else if (!initialize(base, mapped_size)) {
+                munmap(base, mapped_size);
+                base = nullptr;
+            }
+        }
+        flock(fd, LOCK_UN);
+        close(fd);
+        if (!base) {
+            return nullptr;
+        }
+#endif
+
+        // 校验已有段的布局：尺寸以段头为准，并且必须落在映射范围内
+        const auto *header = static_cast<const SegmentHeader *>(base);
+        const bool compatible = header->version == LAYOUT_VERSION && header->bucket_size == sizeof(Bucket) &&
+                                header->hash_check == hashFingerprint() && header->bucket_count >= PROBE_LIMIT &&
+                                std::has_single_bit(header->bucket_count) &&
+                                segmentSize<SegmentHeader, Bucket>(header->bucket_count) <= mapped_size;
+        if (!compatible) {
+#if defined(_WIN32)
+            UnmapViewOfFile(base);
+#else
+            munmap(base, mapped_size);
+#endif
+            return nullptr;
+        }
+        return std::shared_ptr<SharedMemoryCache>(new SharedMemoryCache(base, mapped_size, ttl, policy));
+    }
+
+    bool SharedMemoryCache::unlink(const std::string &name) {
+#if defined(_WIN32)
+        // 命名映射在最后一个句柄与视图关闭后自动删除
+        (void) name;
+        return true;
+#else
+        return shm_unlink(name.c_str()) == 0;
+#endif
+    }
+
+    SharedMemoryCache::Bucket &SharedMemoryCache::bucketAt(size_t index) const {
+        return buckets_[index & (bucket_count_ - 1)];
+    }
+
+    bool SharedMemoryCache::readSnapshot(Bucket &bucket, uint64_t tag, Entry &entry) {
+        std::array<uint64_t, Bucket::PAYLOAD_WORDS> words;
+        for (int attempt = 0; attempt < READ_RETRIES; ++attempt) {
+            const uint32_t before = load(bucket.seq, std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            // 先比较标签（即使读到的是写入中的值，也只会造成一次未命中）
+            const uint64_t bucket_tag = load(bucket.payload[0]);
+            if (bucket_tag == 0 || (tag != 0 && bucket_tag != tag)) {
+                return false;
+            }
+            for (size_t i = 0; i < words.size(); ++i) {
+                words[i] = load(bucket.payload[i]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (load(bucket.seq) != before) {
+                continue;
+            }
+            std::memcpy(static_cast<void *>(&entry), words.data(), sizeof(Entry));
+            return true;
+        }
+        return false;
+    }
+
+    bool SharedMemoryCache::readEntry(Bucket &bucket, uint64_t tag, std::string_view hostname, Entry &entry) {
+        return readSnapshot(bucket, tag, entry) && entry.name_length == hostname.size() &&
+               std::memcmp(entry.name, hostname.data(), hostname.size()) == 0;
+    }
+
+    bool SharedMemoryCache::tryLock(Bucket &bucket, uint32_t &seq) {
+        // acquire：与上一个写方的unlock()同步，读到的owner不会早于它清零之前
+        seq = load(bucket.seq, std::memory_order_acquire);
+        if (seq & 1) {
+            return reclaim(bucket, seq);
+        }
+        if (!std::atomic_ref<uint32_t>(bucket.seq)
+                     .compare_exchange_strong(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        // 载荷的写入不能提前到序号变为奇数之前
+        std::atomic_thread_fence(std::memory_order_release);
+        store(bucket.owner, currentProcess());
+        return true;
+    }
+
+    bool SharedMemoryCache::abandoned(Bucket &bucket) {
+        if (!(load(bucket.seq, std::memory_order_acquire) & 1)) {
+            return false;
+        }
+        const uint32_t owner = load(bucket.owner);
+        return owner != 0 && !processAlive(owner);
+    }
+
+    bool SharedMemoryCache::reclaim(Bucket &bucket, uint32_t &seq) {
+        if (!abandoned(bucket)) {
+            return false;
+        }
+        // 序号加2后仍为奇数，由本进程继续持有；CAS保证只有一个进程接管，且持锁者期间没有换人
+        if (!std::atomic_ref<uint32_t>(bucket.seq)
+                     .compare_exchange_strong(seq, seq + 2, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        store(bucket.owner, currentProcess());
+        // 崩溃的写方可能只写了一半载荷
+        clearLocked(bucket);
+        seq += 1;
+        return true;
+    }
+
+    void SharedMemoryCache::unlock(Bucket &bucket, uint32_t seq) {
+        store(bucket.owner, uint32_t{0});
+        store(bucket.seq, seq + 2, std::memory_order_release);
+    }
+
+    void SharedMemoryCache::copyLocked(const Bucket &bucket, Entry &entry) {
+        std::array<uint64_t, Bucket::PAYLOAD_WORDS> words;
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] = load(const_cast<uint64_t &>(bucket.payload[i]));
+        }
+        std::memcpy(static_cast<void *>(&entry), words.data(), sizeof(Entry));
+    }
+
+    bool SharedMemoryCache::clearLocked(Bucket &bucket) {
+        const bool occupied = load(bucket.payload[0]) != 0;
+        for (auto &word: bucket.payload) {
+            store(word, uint64_t{0});
+        }
+        store(bucket.hits, uint32_t{0});
+        store(bucket.next_refresh_ms, int64_t{0});
+        if (occupied) {
+            std::atomic_ref<uint64_t>(header_->entries).fetch_sub(1, std::memory_order_relaxed);
+        }
+        return occupied;
+    }
+
+    namespace {
+        AddressList decodeAddresses(const IPAddress *addresses, size_t count) {
+            AddressList::Builder builder;
+            for (size_t i = 0; i < count; ++i) {
+                builder.push_back(addresses[i]);
+            }
+            return std::move(builder).build();
+        }
+    }// namespace
+
+    bool SharedMemoryCache::get(const std::string &hostname, AddressList &ips) {
+        return lookupImpl(hostname, hostnameHash(hostname), ips, false).hit;
+    }
+
+    CacheLookup SharedMemoryCache::lookup(const HostnameKey &key, AddressList &ips) {
+        return lookupImpl(key.name, key.hash, ips, true);
+    }
+
+    CacheLookup SharedMemoryCache::lookupImpl(std::string_view hostname, size_t hash, AddressList &ips,
+                                              bool allow_stale) {
+        const uint64_t tag = tagOf(hash);
+        Entry entry;
+        for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+            auto &bucket = bucketAt(hash + i);
+            if (!readEntry(bucket, tag, hostname, entry)) {
+                continue;
+            }
+
+            // 读方不修改载荷：过期条目只是视为未命中，由写入或purgeExpired()回收
+            const int64_t now = nowMs();
+            if (entry.kind != CacheEntryKind::kAddresses) {
+                if (now < entry.expire_ms && allow_stale) {
+                    std::atomic_ref<uint32_t>(bucket.hits).fetch_add(1, std::memory_order_relaxed);
+                    hits_.fetch_add(1, std::memory_order_relaxed);
+                    return {.hit = true, .kind = entry.kind};
+                }
+                break;
+            }
+
+            const uint32_t min_hits = min_hits_.load(std::memory_order_relaxed);
+            const uint32_t hits = std::atomic_ref<uint32_t>(bucket.hits).load(std::memory_order_relaxed);
+            CacheLookup result;
+            if (now >= entry.expire_ms) {
+                const bool servable =
+                        now < entry.expire_ms + serve_stale_ms_.load(std::memory_order_relaxed) && hits >= min_hits;
+                if (!servable || !allow_stale) {
+                    break;
+                }
+                result.stale = true;
+            }
+            const uint32_t total_hits =
+                    std::atomic_ref<uint32_t>(bucket.hits).fetch_add(1, std::memory_order_relaxed) + 1;
+
+            // 到达刷新时间后，只有成功推迟next_refresh_ms的进程收到刷新提示
+            if (allow_stale && total_hits >= min_hits &&
+                (result.stale || refresh_ahead_ratio_.load(std::memory_order_relaxed) > 0)) {
+                std::atomic_ref<int64_t> next_refresh(bucket.next_refresh_ms);
+                int64_t expected = next_refresh.load(std::memory_order_relaxed);
+                if (now >= expected &&
+                    next_refresh.compare_exchange_strong(expected, now + REFRESH_RETRY_INTERVAL_MS,
+                                                         std::memory_order_relaxed)) {
+                    result.refresh = true;
+                }
+            }
+
+            ips = decodeAddresses(entry.addresses, entry.address_count);
+            result.hit = true;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    void SharedMemoryCache::update(const std::string &hostname, const AddressList &ips,
+                                   std::chrono::milliseconds ttl) {
+        write(hostname, ips, ttl, nullptr, CacheEntryKind::kAddresses);
+    }
+
+    bool SharedMemoryCache::exchange(const std::string &hostname, const AddressList &ips,
+                                     std::chrono::milliseconds ttl, AddressList &old_ips) {
+        bool fresh = false;
+        write(hostname, ips, ttl, &old_ips, CacheEntryKind::kAddresses, &fresh);
+        return fresh;
+    }
+
+    void SharedMemoryCache::updateNegative(const std::string &hostname, CacheEntryKind kind,
+                                           std::chrono::milliseconds ttl) {
+        if (kind == CacheEntryKind::kAddresses || ttl.count() <= 0) {
+            return;
+        }
+        write(hostname, AddressList{}, ttl, nullptr, kind);
+    }
+
+    bool SharedMemoryCache::write(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl,
+                                  AddressList *old_ips, CacheEntryKind kind, bool *fresh_out) {
+        if (hostname.empty() || hostname.size() > MAX_KEY_LENGTH) {
+            return false;
+        }
+        const size_t hash = hostnameHash(hostname);
+        const uint64_t tag = tagOf(hash);
+        const int64_t now = nowMs();
+        const int64_t serve_stale = serve_stale_ms_.load(std::memory_order_relaxed);
+
+        // 选择桶：同名条目 > 空桶（含持锁进程已退出、可以接管的桶） > 已过期的桶 > 最早过期的桶
+        Entry entry;
+        Bucket *target = nullptr;
+        int target_rank = 4;
+        int64_t target_expire = INT64_MAX;
+        for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+            auto &bucket = bucketAt(hash + i);
+            if (readEntry(bucket, tag, hostname, entry)) {
+                target = &bucket;
+                break;
+            }
+            const uint64_t bucket_tag = load(bucket.payload[0]);
+            const auto expire_ms = static_cast<int64_t>(load(bucket.payload[1]));
+            const int rank = bucket_tag == 0 || abandoned(bucket) ? 1 : now >= expire_ms + serve_stale ? 2 : 3;
+            if (rank < target_rank || (rank == 3 && target_rank == 3 && expire_ms < target_expire)) {
+                target = &bucket;
+                target_rank = rank;
+                target_expire = expire_ms;
+            }
+        }
+
+        // 桶正被其他写方占用时放弃本次写入：缓存写入可以丢失，不等待其他进程
+        uint32_t seq = 0;
+        if (!tryLock(*target, seq)) {
+            return false;
+        }
+
+        // 持有写锁，载荷不会再变化
+        copyLocked(*target, entry);
+        const bool occupied = entry.tag != 0;
+        const bool same = occupied && entry.tag == tag && entry.name_length == hostname.size() &&
+                          std::memcmp(entry.name, hostname.data(), hostname.size()) == 0;
+        const bool fresh = same && entry.kind == CacheEntryKind::kAddresses && now < entry.expire_ms + serve_stale;
+        if (old_ips && fresh) {
+            *old_ips = decodeAddresses(entry.addresses, entry.address_count);
+        }
+        if (fresh_out) {
+            *fresh_out = fresh;
+        }
+
+        const int64_t lifetime = ttl.count() < 0 ? ttl_ms_.load(std::memory_order_relaxed) : ttl.count();
+        // TTL为0的应答不写入，同名的旧条目同时清除
+        if (lifetime <= 0) {
+            if (same) {
+                clearLocked(*target);
+            }
+            unlock(*target, seq);
+            return false;
+        }
+        const double ratio = refresh_ahead_ratio_.load(std::memory_order_relaxed);
+        // 未启用提前刷新时，热点条目在过期后（serve-stale）才提示刷新
+        const int64_t next_refresh =
+                ratio > 0 ? now + static_cast<int64_t>(static_cast<double>(lifetime) * std::min(ratio, 1.0))
+                          : now + lifetime;
+
+        entry = Entry{};
+        entry.tag = tag;
+        entry.expire_ms = now + lifetime;
+        entry.kind = kind;
+        // 超出MAX_ADDRESSES的地址被截断
+        entry.address_count = static_cast<uint8_t>(std::min(ips.size(), MAX_ADDRESSES));
+        entry.name_length = static_cast<uint16_t>(hostname.size());
+        std::memcpy(entry.name, hostname.data(), hostname.size());
+        std::copy_n(ips.begin(), entry.address_count, entry.addresses);
+
+        std::array<uint64_t, Bucket::PAYLOAD_WORDS> words{};
+        std::memcpy(words.data(), &entry, sizeof(Entry));
+        for (size_t i = 0; i < words.size(); ++i) {
+            store(target->payload[i], words[i]);
+        }
+        store(target->hits, uint32_t{0});
+        store(target->next_refresh_ms, next_refresh);
+        unlock(*target, seq);
+
+        if (!occupied) {
+            std::atomic_ref<uint64_t>(header_->entries).fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool SharedMemoryCache::insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) {
+        const size_t hash = hostnameHash(hostname);
+        const uint64_t tag = tagOf(hash);
+        Entry entry;
+        for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+            if (readEntry(bucketAt(hash + i), tag, hostname, entry)) {
+                if (nowMs() < entry.expire_ms) {
+                    return false;
+                }
+                break;
+            }
+        }
+        return write(hostname, ips, ttl, nullptr, CacheEntryKind::kAddresses);
+    }
+
+    void SharedMemoryCache::remove(const std::string &hostname) {
+        const size_t hash = hostnameHash(hostname);
+        const uint64_t tag = tagOf(hash);
+        Entry entry;
+        for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+            auto &bucket = bucketAt(hash + i);
+            uint32_t seq = 0;
+            if (!readEntry(bucket, tag, hostname, entry) || !tryLock(bucket, seq)) {
+                continue;
+            }
+            // 加锁前条目可能已被替换，重新确认
+            copyLocked(bucket, entry);
+            if (entry.tag == tag && entry.name_length == hostname.size() &&
+                std::memcmp(entry.name, hostname.data(), hostname.size()) == 0) {
+                clearLocked(bucket);
+            }
+            unlock(bucket, seq);
+        }
+    }
+
+    void SharedMemoryCache::clear() {
+        for (size_t i = 0; i < bucket_count_; ++i) {
+            uint32_t seq = 0;
+            if (tryLock(buckets_[i], seq)) {
+                clearLocked(buckets_[i]);
+                unlock(buckets_[i], seq);
+            }
+        }
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t SharedMemoryCache::size() const {
+        // 并发的清空与写入之间计数可能短暂偏差，截断到容量范围内
+        const auto entries = static_cast<int64_t>(std::atomic_ref<uint64_t>(header_->entries).load(std::memory_order_relaxed));
+        return static_cast<size_t>(std::clamp<int64_t>(entries, 0, static_cast<int64_t>(bucket_count_)));
+    }
+
+    double SharedMemoryCache::hit_rate() const {
+        const auto hits = hits_.load(std::memory_order_relaxed);
+        const auto total = hits + misses_.load(std::memory_order_relaxed);
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    size_t SharedMemoryCache::purgeExpired(size_t max_entries) {
+        const int64_t now = nowMs();
+        const int64_t serve_stale = serve_stale_ms_.load(std::memory_order_relaxed);
+        // 地址条目在serve-stale窗口结束后才回收
+        auto expired = [&](const Entry &entry) {
+            return now >= (entry.kind == CacheEntryKind::kAddresses ? entry.expire_ms + serve_stale : entry.expire_ms);
+        };
+
+        const size_t scan = std::min(max_entries, bucket_count_);
+        const size_t start = purge_cursor_.fetch_add(scan, std::memory_order_relaxed);
+        size_t purged = 0;
+        Entry entry;
+        for (size_t i = 0; i < scan; ++i) {
+            auto &bucket = bucketAt(start + i);
+            uint32_t seq = 0;
+            if (!readSnapshot(bucket, 0, entry) || !expired(entry) || !tryLock(bucket, seq)) {
+                continue;
+            }
+            // 加锁后重新判断，期间可能已被其他进程重写
+            copyLocked(bucket, entry);
+            if (entry.tag != 0 && expired(entry) && clearLocked(bucket)) {
+                ++purged;
+            }
+            unlock(bucket, seq);
+        }
+        return purged;
+    }
+
+    void SharedMemoryCache::forEach(const EntryVisitor &visitor) const {
+        // 逐桶复制一致的快照，回调不在任何桶锁内执行
+        const int64_t now = nowMs();
+        Entry entry;
+        for (size_t i = 0; i < bucket_count_; ++i) {
+            if (!readSnapshot(buckets_[i], 0, entry) || entry.kind != CacheEntryKind::kAddresses ||
+                now >= entry.expire_ms || entry.address_count == 0) {
+                continue;
+            }
+            visitor(std::string(entry.name, entry.name_length), decodeAddresses(entry.addresses, entry.address_count),
+                    std::chrono::system_clock::time_point(std::chrono::milliseconds(entry.expire_ms)));
+        }
+    }
+
+    void SharedMemoryCache::updateConfig(const CacheConfig &config) {
+        setPolicy(std::chrono::milliseconds(config.ttl), refreshPolicy(config));
+    }
+
+    void SharedMemoryCache::setPolicy(std::chrono::milliseconds ttl, const RefreshPolicy &policy) {
+        ttl_ms_.store(ttl.count(), std::memory_order_relaxed);
+        serve_stale_ms_.store(policy.serve_stale.count(), std::memory_order_relaxed);
+        refresh_ahead_ratio_.store(policy.refresh_ahead_ratio, std::memory_order_relaxed);
+        min_hits_.store(policy.min_hits, std::memory_order_relaxed);
+    }
+
+}// namespace leigod::dns
@@ -0,0 +1,75 @@
+#include "TimerQueue.h"
+
+namespace leigod::dns {
+
+    TimerQueue::TimerId TimerQueue::schedule(Clock::time_point deadline, Task task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto id = next_id_++;
+        heap_.push(Entry{deadline, id, std::move(task)});
+        pending_.insert(id);
+        return id;
+    }
+
+    bool TimerQueue::cancel(TimerId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 惰性删除：条目留在堆中，到达堆顶时丢弃
+        if (pending_.erase(id) == 0) {
+            return false;
+        }
+        dropCancelledHead();
+        return true;
+    }
+
+    size_t TimerQueue::runDue(Clock::time_point now) {
+        std::vector<Task> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            dropCancelledHead();
+            while (!heap_.empty() && heap_.top().deadline <= now) {
+                // priority_queue::top()只提供const访问，弹出前移走任务对象
+                auto &top = const_cast<Entry &>(heap_.top());
+                pending_.erase(top.id);
+                due.push_back(std::move(top.task));
+                heap_.pop();
+                dropCancelledHead();
+            }
+        }
+
+        for (const auto &task: due) {
+            if (task) {
+                task();
+            }
+        }
+        return due.size();
+    }
+
+    std::optional<std::chrono::milliseconds> TimerQueue::timeUntilNext(Clock::time_point now) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (heap_.empty()) {
+            return std::nullopt;
+        }
+        const auto deadline = heap_.top().deadline;
+        if (deadline <= now) {
+            return std::chrono::milliseconds(0);
+        }
+        return std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+    }
+
+    size_t TimerQueue::size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_.size();
+    }
+
+    void TimerQueue::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        heap_ = {};
+        pending_.clear();
+    }
+
+    void TimerQueue::dropCancelledHead() {
+        while (!heap_.empty() && !pending_.contains(heap_.top().id)) {
+            heap_.pop();
+        }
+    }
+
+}// namespace leigod::dns
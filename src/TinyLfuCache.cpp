@@ -0,0 +1,532 @@
+#include "TinyLfuCache.h"
+#include <algorithm>
+#include <bit>
+
+namespace leigod::dns {
+
+    namespace {
+        // 过期堆的比较：最早移除的记录在堆顶
+        struct LaterRemoval {
+            template<typename Record>
+            bool operator()(const Record &lhs, const Record &rhs) const {
+                return lhs.removal_time > rhs.removal_time;
+            }
+        };
+    }// namespace
+
+    TinyLfuCache::TinyLfuCache(size_t max_size, int64_t ttl, RefreshPolicy policy)
+        : max_size_(std::max<size_t>(max_size, 1)), ttl_(ttl), policy_(policy), sketch_(max_size_) {
+        resizeRegions(max_size_);
+        rebuildIndex(max_size_);
+    }
+
+    bool TinyLfuCache::get(const std::string &hostname, AddressList &ips) {
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lookupLocked(hostname, hash, ips, false).hit;
+    }
+
+    CacheLookup TinyLfuCache::lookup(const HostnameKey &key, AddressList &ips) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lookupLocked(key.name, key.hash, ips, true);
+    }
+
+    void TinyLfuCache::lookupMany(std::span<const HostnameKey> keys, std::span<AddressList> ips,
+                                  std::span<CacheLookup> results) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            results[i] = lookupLocked(keys[i].name, keys[i].hash, ips[i], true);
+        }
+    }
+
+    CacheLookup TinyLfuCache::lookupLocked(std::string_view hostname, size_t hash, AddressList &ips,
+                                           bool allow_stale) {
+        const uint32_t index = find(hostname, hash);
+        if (index == NIL) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        auto &node = nodes_[index];
+        const auto now = std::chrono::system_clock::now();
+
+        // 否定条目：未过期时命中（get()不视为命中），过期即删除
+        if (node.kind != CacheEntryKind::kAddresses) {
+            if (now >= node.expire_time) {
+                erase(index);
+            } else if (allow_stale) {
+                sketch_.increment(hash);
+                onHit(index);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return {.hit = true, .kind = node.kind};
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        CacheLookup result;
+        if (now >= node.expire_time) {
+            // 条目已过期：只有热点条目在serve-stale窗口内返回旧地址
+            const bool servable = now < node.expire_time + policy_.serve_stale && node.hits >= policy_.min_hits;
+            if (!servable || !allow_stale) {
+                if (!servable) {
+                    erase(index);
+                }
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                return {};
+            }
+            result.stale = true;
+        }
+
+        // 更新访问频率、所在区域与访问次数
+        sketch_.increment(hash);
+        onHit(index);
+        ++node.hits;
+
+        // 热点条目到达刷新时间后提示调用方后台刷新，刷新完成前按固定间隔重复提示
+        if (allow_stale && now >= node.next_refresh && node.hits >= policy_.min_hits &&
+            (result.stale || policy_.refresh_ahead_ratio > 0)) {
+            result.refresh = true;
+            node.next_refresh = now + REFRESH_RETRY_INTERVAL;
+        }
+
+        ips = node.ips;
+        result.hit = true;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    void TinyLfuCache::update(const std::string &hostname, const AddressList &ips,
+                              std::chrono::milliseconds ttl) {
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        updateLocked(hostname, hash, ips, ttl, nullptr);
+    }
+
+    bool TinyLfuCache::exchange(const std::string &hostname, const AddressList &ips,
+                                std::chrono::milliseconds ttl, AddressList &old_ips) {
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return updateLocked(hostname, hash, ips, ttl, &old_ips);
+    }
+
+    void TinyLfuCache::updateNegative(const std::string &hostname, CacheEntryKind kind,
+                                      std::chrono::milliseconds ttl) {
+        if (kind == CacheEntryKind::kAddresses || ttl.count() <= 0) {
+            return;
+        }
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        updateLocked(hostname, hash, AddressList{}, ttl, nullptr, kind);
+    }
+
+    bool TinyLfuCache::updateLocked(const std::string &hostname, size_t hash, const AddressList &ips,
+                                    std::chrono::milliseconds ttl, AddressList *old_ips, CacheEntryKind kind) {
+        const auto now = std::chrono::system_clock::now();
+        const auto lifetime = ttl.count() < 0 ? ttl_ : ttl;
+        const auto expire_time = now + lifetime;
+        // 未启用提前刷新时，热点条目在过期后（serve-stale）才提示刷新
+        const auto next_refresh = policy_.refresh_ahead_ratio > 0
+                                          ? now + std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                          lifetime * std::min(policy_.refresh_ahead_ratio, 1.0))
+                                          : expire_time;
+
+        // 写入也计入访问频率：新名称以频率1进入窗口
+        sketch_.increment(hash);
+
+        uint32_t index = find(hostname, hash);
+        if (index != NIL) {
+            // 更新现有条目，访问次数重新开始统计
+            auto &node = nodes_[index];
+            const bool fresh = node.kind == CacheEntryKind::kAddresses && now < node.expire_time + policy_.serve_stale;
+            if (old_ips && fresh) {
+                *old_ips = std::move(node.ips);
+            }
+            // TTL为0的应答不缓存，旧条目同时作废
+            if (lifetime.count() <= 0) {
+                erase(index);
+                return fresh;
+            }
+            node.ips = ips;
+            node.expire_time = expire_time;
+            node.next_refresh = next_refresh;
+            node.hits = 0;
+            node.kind = kind;
+            ++node.generation;
+            onHit(index);
+            scheduleExpiry(index);
+            return fresh;
+        }
+
+        if (lifetime.count() <= 0) {
+            return false;
+        }
+
+        // 添加新条目：容量已满时先回收已过期条目，仍超出容量时由admit()决定淘汰哪一个
+        if (count_ >= max_size_) {
+            cleanup(EVICTION_PURGE_BATCH);
+        }
+
+        index = allocateNode();
+        auto &node = nodes_[index];
+        node.hostname = hostname;
+        node.hash = hash;
+        node.ips = ips;
+        node.expire_time = expire_time;
+        node.next_refresh = next_refresh;
+        node.hits = 0;
+        node.kind = kind;
+        ++node.generation;
+        indexInsert(index);
+        pushFront(Region::kWindow, index);
+        ++count_;
+        scheduleExpiry(index);
+
+        admit();
+        return false;
+    }
+
+    bool TinyLfuCache::insert(const std::string &hostname, const AddressList &ips, std::chrono::milliseconds ttl) {
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint32_t index = find(hostname, hash);
+        if (index != NIL && std::chrono::system_clock::now() < nodes_[index].expire_time) {
+            return false;
+        }
+        updateLocked(hostname, hash, ips, ttl, nullptr);
+        return ttl.count() != 0;
+    }
+
+    void TinyLfuCache::remove(const std::string &hostname) {
+        const auto hash = hostnameHash(hostname);
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint32_t index = find(hostname, hash);
+        if (index != NIL) {
+            erase(index);
+        }
+    }
+
+    void TinyLfuCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes_.clear();
+        free_head_ = NIL;
+        count_ = 0;
+        std::fill(slots_.begin(), slots_.end(), Slot{});
+        window_ = {};
+        probation_ = {};
+        protected_ = {};
+        sketch_.clear();
+        expiry_heap_.clear();
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t TinyLfuCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+    double TinyLfuCache::hit_rate() const {
+        const auto hits = hits_.load(std::memory_order_relaxed);
+        const auto total = hits + misses_.load(std::memory_order_relaxed);
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    size_t TinyLfuCache::purgeExpired(size_t max_entries) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cleanup(max_entries);
+    }
+
+    void TinyLfuCache::forEach(const EntryVisitor &visitor) const {
+        // 加锁期间只复制条目（地址列表只增加引用计数），回调在锁外执行
+        struct Record {
+            std::string hostname;
+            AddressList ips;
+            TimePoint expire_time;
+        };
+        std::vector<Record> records;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now = std::chrono::system_clock::now();
+            records.reserve(count_);
+            for (const auto &node: nodes_) {
+                if (node.region != Region::kFree && node.kind == CacheEntryKind::kAddresses &&
+                    now < node.expire_time) {
+                    records.push_back({node.hostname, node.ips, node.expire_time});
+                }
+            }
+        }
+
+        for (const auto &record: records) {
+            visitor(record.hostname, record.ips, record.expire_time);
+        }
+    }
+
+    void TinyLfuCache::updateConfig(const CacheConfig &config) {
+        reconfigure(config.max_size, std::chrono::milliseconds(config.ttl), refreshPolicy(config));
+    }
+
+    void TinyLfuCache::reconfigure(size_t max_size, std::chrono::milliseconds ttl, RefreshPolicy policy) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ttl_ = ttl;
+        // 过期堆以expire_time加serve-stale窗口为键，窗口变化时重建
+        const bool stale_changed = policy.serve_stale != policy_.serve_stale;
+        policy_ = policy;
+        if (stale_changed) {
+            rebuildExpiryHeap();
+        }
+
+        max_size = std::max<size_t>(max_size, 1);
+        if (max_size == max_size_) {
+            return;
+        }
+        max_size_ = max_size;
+        resizeRegions(max_size_);
+        // 计数表的宽度随容量变化，频率统计从头开始
+        sketch_.resize(max_size_);
+
+        if (count_ > max_size_) {
+            cleanup(count_ - max_size_);
+        }
+        while (count_ > max_size_) {
+            evictOne();
+        }
+
+        // 按新的区域容量重新平衡
+        while (protected_.size > protected_max_) {
+            const uint32_t demoted = protected_.tail;
+            unlink(demoted);
+            pushFront(Region::kProbation, demoted);
+        }
+        while (window_.size > window_max_) {
+            const uint32_t moved = window_.tail;
+            unlink(moved);
+            pushFront(Region::kProbation, moved);
+        }
+        rebuildIndex(max_size_);
+    }
+
+    uint32_t TinyLfuCache::find(std::string_view hostname, size_t hash) const {
+        const uint32_t tag = tagOf(hash);
+        for (size_t i = hash & slot_mask_;; i = (i + 1) & slot_mask_) {
+            const auto &slot = slots_[i];
+            if (slot.node == NIL) {
+                return NIL;
+            }
+            if (slot.tag == tag) {
+                const auto &node = nodes_[slot.node];
+                if (node.hash == hash && node.hostname == hostname) {
+                    return slot.node;
+                }
+            }
+        }
+    }
+
+    void TinyLfuCache::indexInsert(uint32_t node) {
+        const size_t hash = nodes_[node].hash;
+        size_t i = hash & slot_mask_;
+        while (slots_[i].node != NIL) {
+            i = (i + 1) & slot_mask_;
+        }
+        slots_[i] = {.node = node, .tag = tagOf(hash)};
+    }
+
+    void TinyLfuCache::indexErase(uint32_t node) {
+        size_t hole = nodes_[node].hash & slot_mask_;
+        while (slots_[hole].node != node) {
+            hole = (hole + 1) & slot_mask_;
+        }
+
+        // 后移补位：探测链上后续的槽位若可以放到空洞处（其初始位置不在空洞与当前位置之间）则前移，不留删除标记
+        for (size_t i = (hole + 1) & slot_mask_; slots_[i].node != NIL; i = (i + 1) & slot_mask_) {
+            const size_t home = nodes_[slots_[i].node].hash & slot_mask_;
+            if (((i - home) & slot_mask_) >= ((i - hole) & slot_mask_)) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        slots_[hole] = Slot{};
+    }
+
+    void TinyLfuCache::rebuildIndex(size_t max_size) {
+        const size_t capacity = std::bit_ceil(std::max<size_t>({max_size, count_, 4}) * 2);
+        slots_.assign(capacity, Slot{});
+        slot_mask_ = capacity - 1;
+        for (uint32_t i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i].region != Region::kFree) {
+                indexInsert(i);
+            }
+        }
+    }
+
+    TinyLfuCache::List &TinyLfuCache::listOf(Region region) {
+        switch (region) {
+            case Region::kWindow:
+                return window_;
+            case Region::kProtected:
+                return protected_;
+            default:
+                return probation_;
+        }
+    }
+
+    void TinyLfuCache::unlink(uint32_t index) {
+        auto &node = nodes_[index];
+        auto &list = listOf(node.region);
+        (node.prev != NIL ? nodes_[node.prev].next : list.head) = node.next;
+        (node.next != NIL ? nodes_[node.next].prev : list.tail) = node.prev;
+        node.prev = node.next = NIL;
+        --list.size;
+    }
+
+    void TinyLfuCache::pushFront(Region region, uint32_t index) {
+        auto &node = nodes_[index];
+        auto &list = listOf(region);
+        node.region = region;
+        node.prev = NIL;
+        node.next = list.head;
+        (list.head != NIL ? nodes_[list.head].prev : list.tail) = index;
+        list.head = index;
+        ++list.size;
+    }
+
+    void TinyLfuCache::onHit(uint32_t index) {
+        const auto region = nodes_[index].region;
+        unlink(index);
+        if (region == Region::kWindow) {
+            pushFront(Region::kWindow, index);
+            return;
+        }
+
+        // probation中再次被访问的条目晋升，protected溢出的LRU条目降回probation
+        pushFront(Region::kProtected, index);
+        if (protected_.size > protected_max_) {
+            const uint32_t demoted = protected_.tail;
+            unlink(demoted);
+            pushFront(Region::kProbation, demoted);
+        }
+    }
+
+    void TinyLfuCache::admit() {
+        // 窗口溢出的LRU条目成为候选，进入probation头部
+        uint32_t candidate = NIL;
+        if (window_.size > window_max_) {
+            candidate = window_.tail;
+            unlink(candidate);
+            pushFront(Region::kProbation, candidate);
+        }
+
+        while (count_ > max_size_) {
+            if (candidate == NIL) {
+                evictOne();
+                continue;
+            }
+
+            // 淘汰候选为probation的LRU条目；probation中只剩候选时取protected的LRU条目
+            const uint32_t victim = probation_.tail != candidate ? probation_.tail : protected_.tail;
+            if (victim == NIL) {
+                erase(candidate);
+                candidate = NIL;
+                continue;
+            }
+
+            // 候选的估计频率高于淘汰候选（或后者已过期）时才被接纳，平局时保留已有条目
+            const auto &victim_node = nodes_[victim];
+            const bool victim_expired = std::chrono::system_clock::now() >= removalTime(victim_node);
+            if (victim_expired || sketch_.frequency(nodes_[candidate].hash) > sketch_.frequency(victim_node.hash)) {
+                erase(victim);
+            } else {
+                erase(candidate);
+                candidate = NIL;
+            }
+        }
+    }
+
+    void TinyLfuCache::evictOne() {
+        uint32_t victim = probation_.tail;
+        if (victim == NIL) {
+            victim = window_.tail;
+        }
+        if (victim == NIL) {
+            victim = protected_.tail;
+        }
+        if (victim != NIL) {
+            erase(victim);
+        }
+    }
+
+    void TinyLfuCache::erase(uint32_t index) {
+        unlink(index);
+        indexErase(index);
+
+        auto &node = nodes_[index];
+        node.region = Region::kFree;
+        ++node.generation;
+        node.ips = AddressList{};
+        node.hostname.clear();// 保留容量，节点复用时不再分配
+        node.next = free_head_;
+        free_head_ = index;
+        --count_;
+    }
+
+    uint32_t TinyLfuCache::allocateNode() {
+        if (free_head_ != NIL) {
+            const uint32_t index = free_head_;
+            free_head_ = nodes_[index].next;
+            nodes_[index].next = NIL;
+            return index;
+        }
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    void TinyLfuCache::resizeRegions(size_t max_size) {
+        window_max_ = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(max_size) * WINDOW_RATIO));
+        const size_t main_max = max_size > window_max_ ? max_size - window_max_ : 0;
+        protected_max_ = static_cast<size_t>(static_cast<double>(main_max) * PROTECTED_RATIO);
+    }
+
+    void TinyLfuCache::scheduleExpiry(uint32_t index) {
+        const auto &node = nodes_[index];
+        expiry_heap_.push_back({removalTime(node), index, node.generation});
+        std::push_heap(expiry_heap_.begin(), expiry_heap_.end(), LaterRemoval{});
+
+        // 条目反复重写留下的失效记录过多时整体重建
+        if (expiry_heap_.size() > 2 * count_ + 64) {
+            rebuildExpiryHeap();
+        }
+    }
+
+    size_t TinyLfuCache::cleanup(size_t max_entries) {
+        const auto now = std::chrono::system_clock::now();
+        size_t purged = 0;
+        while (purged < max_entries && !expiry_heap_.empty()) {
+            const auto record = expiry_heap_.front();
+            if (record.removal_time > now) {
+                break;
+            }
+            std::pop_heap(expiry_heap_.begin(), expiry_heap_.end(), LaterRemoval{});
+            expiry_heap_.pop_back();
+
+            const auto &node = nodes_[record.node];
+            if (node.region == Region::kFree || node.generation != record.generation) {
+                continue;
+            }
+            erase(record.node);
+            ++purged;
+        }
+        return purged;
+    }
+
+    void TinyLfuCache::rebuildExpiryHeap() {
+        expiry_heap_.clear();
+        for (uint32_t i = 0; i < nodes_.size(); ++i) {
+            const auto &node = nodes_[i];
+            if (node.region != Region::kFree) {
+                expiry_heap_.push_back({removalTime(node), i, node.generation});
+            }
+        }
+        std::make_heap(expiry_heap_.begin(), expiry_heap_.end(), LaterRemoval{});
+    }
+
+}// namespace leigod::dns
@@ -0,0 +1,1145 @@
+#include "UdpBatchQueryStrategy.h"
+#include "EventLoop.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace leigod::dns {
+
+    namespace {
+        constexpr size_t HEADER_SIZE = 12;
+        constexpr uint16_t TYPE_A = 1;
+        constexpr uint16_t TYPE_CNAME = 5;
+        constexpr uint16_t TYPE_SOA = 6;
+        constexpr uint16_t TYPE_AAAA = 28;
+        constexpr uint16_t TYPE_OPT = 41;
+        constexpr uint16_t CLASS_IN = 1;
+        constexpr uint8_t FLAG_QR = 0x80;
+        constexpr uint8_t FLAG_TC = 0x02;
+        constexpr uint8_t FLAG_RD = 0x01;
+        constexpr uint8_t RCODE_NXDOMAIN = 3;
+        constexpr size_t ID_COUNT = 65536;
+        // 单次可读事件最多接收的批数，避免一个套接字独占事件循环
+        constexpr int MAX_RECEIVE_ROUNDS = 16;
+        constexpr size_t TCP_READ_CHUNK = 4096;
+
+        const auto INVALID_SOCKET_HANDLE = static_cast<SocketHandle>(-1);
+
+#ifdef MSG_NOSIGNAL
+        constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+        constexpr int SEND_FLAGS = 0;
+#endif
+
+        uint16_t readU16(const uint8_t *p) {
+            return static_cast<uint16_t>(p[0] << 8 | p[1]);
+        }
+
+        uint32_t readU32(const uint8_t *p) {
+            return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+                   static_cast<uint32_t>(p[2]) << 8 | p[3];
+        }
+
+        void writeU16(uint8_t *p, uint16_t value) {
+            p[0] = static_cast<uint8_t>(value >> 8);
+            p[1] = static_cast<uint8_t>(value);
+        }
+
+        // RFC 2181：最高位为1的TTL按0处理
+        int64_t recordTtl(uint32_t ttl) {
+            return ttl > INT32_MAX ? 0 : static_cast<int64_t>(ttl);
+        }
+
+        void closeSocket(SocketHandle socket) {
+#if defined(_WIN32)
+            closesocket(static_cast<SOCKET>(socket));
+#else
+            close(socket);
+#endif
+        }
+
+        bool setNonBlocking(SocketHandle socket) {
+#if defined(_WIN32)
+            u_long mode = 1;
+            return ioctlsocket(static_cast<SOCKET>(socket), FIONBIO, &mode) == 0;
+#else
+            const int flags = fcntl(socket, F_GETFL, 0);
+            return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+        }
+
+        // 最近一次套接字调用是否只是暂时无法完成
+        bool wouldBlock() {
+#if defined(_WIN32)
+            const int error = WSAGetLastError();
+            return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS || errno == EINTR;
+#endif
+        }
+
+        bool sameEndpoint(const sockaddr_storage &peer, const sockaddr_storage &server) {
+            if (peer.ss_family != server.ss_family) {
+                return false;
+            }
+            if (peer.ss_family == AF_INET) {
+                const auto &a = reinterpret_cast<const sockaddr_in &>(peer);
+                const auto &b = reinterpret_cast<const sockaddr_in &>(server);
+                return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+            }
+            const auto &a = reinterpret_cast<const sockaddr_in6 &>(peer);
+            const auto &b = reinterpret_cast<const sockaddr_in6 &>(server);
+            return a.sin6_port == b.sin6_port && std::memcmp(&a.sin6_addr, &b.sin6_addr, sizeof(a.sin6_addr)) == 0;
+        }
+
+        // 跳过（可能压缩的）名字，返回其后的偏移，报文不完整时返回0
+        size_t skipName(const uint8_t *data, size_t length, size_t offset) {
+            while (offset < length) {
+                const uint8_t label = data[offset];
+                if (label == 0) {
+                    return offset + 1;
+                }
+                if ((label & 0xC0) == 0xC0) {
+                    return offset + 2 <= length ? offset + 2 : 0;
+                }
+                if (label & 0xC0) {
+                    return 0;
+                }
+                offset += label + 1;
+            }
+            return 0;
+        }
+
+        // 沿压缩指针跳到名字的下一个实际标签，budget限制跳转次数以防指针成环
+        bool followPointers(const uint8_t *data, size_t length, size_t &offset, int &budget) {
+            while (offset + 1 < length && (data[offset] & 0xC0) == 0xC0) {
+                if (--budget < 0) {
+                    return false;
+                }
+                offset = static_cast<size_t>(data[offset] & 0x3F) << 8 | data[offset + 1];
+            }
+            return offset < length && (data[offset] & 0xC0) == 0;
+        }
+
+        // 比较报文内两个（可能压缩的）名字，按ASCII忽略大小写；报文不合法时视为不同
+        bool sameName(const uint8_t *data, size_t length, size_t a, size_t b) {
+            const auto lower = [](uint8_t c) { return c >= 'A' && c <= 'Z' ? static_cast<uint8_t>(c | 0x20) : c; };
+            int budget = 128;
+            for (;;) {
+                if (!followPointers(data, length, a, budget) || !followPointers(data, length, b, budget)) {
+                    return false;
+                }
+                const uint8_t label = data[a];
+                if (label != data[b] || a + label >= length || b + label >= length) {
+                    return false;
+                }
+                if (label == 0) {
+                    return true;
+                }
+                for (size_t i = 1; i <= label; ++i) {
+                    if (lower(data[a + i]) != lower(data[b + i])) {
+                        return false;
+                    }
+                }
+                a += label + 1;
+                b += label + 1;
+            }
+        }
+
+        /**
+         * 按标签编码QNAME，randomize_case时随机翻转字母大小写（DNS 0x20）；名字不合法时返回0
+         */
+        size_t encodeName(std::string_view hostname, uint8_t *out, bool randomize_case, std::mt19937 &rng) {
+            size_t offset = 0;
+            uint32_t bits = 0;
+            int remaining_bits = 0;
+            size_t start = 0;
+            while (start < hostname.size()) {
+                const size_t dot = std::min(hostname.find('.', start), hostname.size());
+                const size_t length = dot - start;
+                if (length == 0 || length > 63 || offset + length + 2 > 255) {
+                    return 0;
+                }
+                out[offset++] = static_cast<uint8_t>(length);
+                for (size_t i = start; i < dot; ++i) {
+                    auto c = static_cast<uint8_t>(hostname[i]);
+                    const auto lower = static_cast<uint8_t>(c | 0x20);
+                    if (randomize_case && lower >= 'a' && lower <= 'z') {
+                        if (remaining_bits == 0) {
+                            bits = static_cast<uint32_t>(rng());
+                            remaining_bits = 32;
+                        }
+                        if (bits & 1) {
+                            c ^= 0x20;
+                        }
+                        bits >>= 1;
+                        --remaining_bits;
+                    }
+                    out[offset++] = c;
+                }
+                start = dot + 1;
+            }
+            if (offset == 0) {
+                return 0;
+            }
+            out[offset++] = 0;
+            return offset;
+        }
+
+        std::string serverName(const DNSServerConfig &server) {
+            const bool ipv6 = server.address.find(':') != std::string::npos;
+            return ipv6 ? std::format("[{}]:{}", server.address, server.port)
+                        : std::format("{}:{}", server.address, server.port);
+        }
+
+        // ResolveResult中的阶段时间戳：steady_clock纳秒，未记录时为0
+        int64_t steadyNanos(std::chrono::steady_clock::time_point time) {
+            return time == std::chrono::steady_clock::time_point{}
+                           ? 0
+                           : std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+    }// namespace
+
+    /**
+     * 批量收发：Linux上以sendmmsg/recvmmsg一次系统调用处理一批报文，其他平台逐个收发。
+     * 待发送的报文由调用方填入packets/targets，接收到的报文按下标写入receive缓冲区
+     */
+    struct UdpBatchQueryStrategy::BatchBuffers {
+        explicit BatchBuffers(size_t batch)
+            : batch(batch), packets(batch), packet_lengths(batch), targets(batch), target_lengths(batch),
+              receive_buffer(batch * EDNS_UDP_SIZE), peers(batch), lengths(batch), truncated(batch)
+#if defined(__linux__)
+              ,
+              send_headers(batch), send_iov(batch), receive_headers(batch), receive_iov(batch)
+#endif
+        {
+        }
+
+        // 发送前count个报文，返回已发送的数量；第一个报文即失败时返回-1
+        int send(SocketHandle socket, size_t count) {
+#if defined(__linux__)
+            for (size_t i = 0; i < count; ++i) {
+                send_iov[i] = {const_cast<uint8_t *>(packets[i]), packet_lengths[i]};
+                auto &header = send_headers[i].msg_hdr;
+                header = {};
+                header.msg_name = const_cast<sockaddr_storage *>(targets[i]);
+                header.msg_namelen = target_lengths[i];
+                header.msg_iov = &send_iov[i];
+                header.msg_iovlen = 1;
+            }
+            int sent;
+            do {
+                sent = sendmmsg(socket, send_headers.data(), static_cast<unsigned int>(count), SEND_FLAGS);
+            } while (sent < 0 && errno == EINTR);
+            return sent;
+#else
+            for (size_t i = 0; i < count; ++i) {
+                const auto sent = ::sendto(socket, reinterpret_cast<const char *>(packets[i]),
+                                           static_cast<int>(packet_lengths[i]), SEND_FLAGS,
+                                           reinterpret_cast<const sockaddr *>(targets[i]), target_lengths[i]);
+                if (sent < 0) {
+                    return i == 0 ? -1 : static_cast<int>(i);
+                }
+            }
+            return static_cast<int>(count);
+#endif
+        }
+
+        // 接收至多batch个报文，返回数量，没有可读报文时返回0
+        int receive(SocketHandle socket) {
+#if defined(__linux__)
+            for (size_t i = 0; i < batch; ++i) {
+                receive_iov[i] = {receive_buffer.data() + i * EDNS_UDP_SIZE, EDNS_UDP_SIZE};
+                auto &header = receive_headers[i].msg_hdr;
+                header = {};
+                header.msg_name = &peers[i];
+                header.msg_namelen = sizeof(sockaddr_storage);
+                header.msg_iov = &receive_iov[i];
+                header.msg_iovlen = 1;
+            }
+            const int received = recvmmsg(socket, receive_headers.data(), static_cast<unsigned int>(batch),
+                                          MSG_DONTWAIT, nullptr);
+            for (int i = 0; i < received; ++i) {
+                lengths[i] = receive_headers[i].msg_len;
+                truncated[i] = (receive_headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+            }
+            return std::max(received, 0);
+#else
+            size_t count = 0;
+            for (; count < batch; ++count) {
+                auto *buffer = receive_buffer.data() + count * EDNS_UDP_SIZE;
+                socklen_t peer_length = sizeof(sockaddr_storage);
+#if defined(_WIN32)
+                const int received = ::recvfrom(socket, reinterpret_cast<char *>(buffer),
+                                                static_cast<int>(EDNS_UDP_SIZE), 0,
+                                                reinterpret_cast<sockaddr *>(&peers[count]), &peer_length);
+                const bool cut = received < 0 && WSAGetLastError() == WSAEMSGSIZE;
+                if (received < 0 && !cut) {
+                    break;
+                }
+                lengths[count] = cut ? EDNS_UDP_SIZE : static_cast<size_t>(received);
+                truncated[count] = cut;
+#else
+                iovec iov{buffer, EDNS_UDP_SIZE};
+                msghdr header{};
+                header.msg_name = &peers[count];
+                header.msg_namelen = peer_length;
+                header.msg_iov = &iov;
+                header.msg_iovlen = 1;
+                const auto received = ::recvmsg(socket, &header, 0);
+                if (received < 0) {
+                    break;
+                }
+                lengths[count] = static_cast<size_t>(received);
+                truncated[count] = (header.msg_flags & MSG_TRUNC) != 0;
+#endif
+            }
+            return static_cast<int>(count);
+#endif
+        }
+
+        size_t batch;
+        std::vector<const uint8_t *> packets;
+        std::vector<size_t> packet_lengths;
+        std::vector<const sockaddr_storage *> targets;
+        std::vector<socklen_t> target_lengths;
+        std::vector<TransactionMap::Key> send_keys;// 与packets按下标对应
+        std::vector<size_t> send_positions;        // 报文在发送队列中的位置
+
+        std::vector<uint8_t> receive_buffer;// batch个EDNS_UDP_SIZE字节的缓冲区
+        std::vector<sockaddr_storage> peers;
+        std::vector<size_t> lengths;
+        std::vector<uint8_t> truncated;
+#if defined(__linux__)
+        std::vector<mmsghdr> send_headers;
+        std::vector<iovec> send_iov;
+        std::vector<mmsghdr> receive_headers;
+        std::vector<iovec> receive_iov;
+#endif
+    };
+
+    UdpBatchQueryStrategy::UdpBatchQueryStrategy(DNSResolverConfig config, std::shared_ptr<ILogger> logger,
+                                                 std::shared_ptr<IEventLoop> eventLoop,
+                                                 std::shared_ptr<IMetrics> metrics)
+        : config_(std::move(config)), logger_(std::move(logger)), eventLoop_(std::move(eventLoop)),
+          metrics_(std::move(metrics)) {
+        initialize();
+    }
+
+    UdpBatchQueryStrategy::~UdpBatchQueryStrategy() {
+        if (initialized_) {
+            shutdown();
+        }
+        closeSockets();
+#if defined(_WIN32)
+        WSACleanup();
+#endif
+    }
+
+    void UdpBatchQueryStrategy::initialize() {
+#if defined(_WIN32)
+        WSADATA wsa_data;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+            DNS_LOGGER_ERROR(logger_, "Failed to initialize Winsock: {}", WSAGetLastError());
+            return;
+        }
+#endif
+
+        // 只使用显式配置的服务器：不读取系统解析配置，也不处理搜索域与hosts文件
+        for (const auto &config: config_.servers) {
+            if (!config.enabled) {
+                continue;
+            }
+            Server server;
+            server.name = serverName(config);
+            server.timeout = std::chrono::milliseconds(config.timeout_ms > 0
+                                                               ? std::min(config.timeout_ms, config_.query_timeout_ms)
+                                                               : config_.query_timeout_ms);
+            auto &v4 = reinterpret_cast<sockaddr_in &>(server.address);
+            auto &v6 = reinterpret_cast<sockaddr_in6 &>(server.address);
+            if (inet_pton(AF_INET, config.address.c_str(), &v4.sin_addr) == 1) {
+                v4.sin_family = AF_INET;
+                v4.sin_port = htons(config.port);
+                server.family = AF_INET;
+                server.address_length = sizeof(sockaddr_in);
+            } else if (inet_pton(AF_INET6, config.address.c_str(), &v6.sin6_addr) == 1) {
+                v6.sin6_family = AF_INET6;
+                v6.sin6_port = htons(config.port);
+                server.family = AF_INET6;
+                server.address_length = sizeof(sockaddr_in6);
+            } else {
+                DNS_LOGGER_ERROR(logger_, "Invalid DNS server address for udp_batch: {}", config.address);
+                return;
+            }
+            for (uint32_t i = 0; i < std::clamp<uint32_t>(config.weight, 1, 100); ++i) {
+                server_schedule_.push_back(static_cast<uint32_t>(servers_.size()));
+            }
+            servers_.push_back(std::move(server));
+        }
+        if (servers_.empty()) {
+            DNS_LOGGER_ERROR(logger_, "udp_batch query strategy requires at least one configured DNS server");
+            return;
+        }
+        max_attempts_ = std::max<uint32_t>(config_.retry.max_attempts, 1) * static_cast<uint32_t>(servers_.size());
+
+        // 未提供外部事件循环时使用平台默认实现（epoll/kqueue/WSAPoll）
+        if (!eventLoop_) {
+            try {
+                eventLoop_ = createDefaultEventLoop();
+            } catch (const std::exception &e) {
+                DNS_LOGGER_WARN(logger_, "Falling back to poll() event loop: {}", e.what());
+                eventLoop_ = std::make_shared<PollEventLoop>();
+            }
+        }
+
+        buffers_ = std::make_unique<BatchBuffers>(std::max<uint32_t>(config_.udp_batch.batch_size, 1));
+        buffers_->send_keys.resize(buffers_->batch);
+        buffers_->send_positions.resize(buffers_->batch);
+        if (!openSockets()) {
+            closeSockets();
+            return;
+        }
+
+        initialized_ = true;
+        DNS_LOGGER_INFO(logger_, "udp_batch query strategy initialized with {} server(s) and {} socket(s)",
+                        servers_.size(), sockets_.size());
+    }
+
+    bool UdpBatchQueryStrategy::openSockets() {
+        const auto needs = [this](int family) {
+            return std::ranges::any_of(servers_, [family](const Server &server) { return server.family == family; });
+        };
+        const uint32_t per_family = std::max<uint32_t>(config_.udp_batch.sockets, 1);
+
+        for (const int family: {AF_INET, AF_INET6}) {
+            if (!needs(family)) {
+                continue;
+            }
+            for (uint32_t i = 0; i < per_family; ++i) {
+                const auto handle = static_cast<SocketHandle>(::socket(family, SOCK_DGRAM, IPPROTO_UDP));
+                if (handle == INVALID_SOCKET_HANDLE) {
+                    DNS_LOGGER_ERROR(logger_, "Failed to create UDP socket: {}", errno);
+                    return false;
+                }
+                UdpSocket socket;
+                socket.handle = handle;
+                socket.family = family;
+                sockets_.push_back(std::move(socket));
+
+                const int buffer_size = SOCKET_BUFFER_SIZE;
+                setsockopt(handle, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char *>(&buffer_size),
+                           sizeof(buffer_size));
+
+                // 绑定端口0：每个套接字使用内核随机分配的源端口
+                sockaddr_storage local{};
+                local.ss_family = static_cast<decltype(local.ss_family)>(family);
+                const socklen_t local_length = family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+                if (!setNonBlocking(handle) ||
+                    bind(handle, reinterpret_cast<const sockaddr *>(&local), local_length) != 0) {
+                    DNS_LOGGER_ERROR(logger_, "Failed to bind UDP socket: {}", errno);
+                    return false;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < sockets_.size(); ++i) {
+            sockets_[i].ids.assign(ID_COUNT, {});
+            socket_index_[sockets_[i].handle] = i;
+            eventLoop_->updateSocket(sockets_[i].handle, true, false);
+        }
+        return true;
+    }
+
+    void UdpBatchQueryStrategy::closeSockets() {
+        for (const auto &socket: sockets_) {
+            if (eventLoop_ && socket_index_.contains(socket.handle)) {
+                eventLoop_->updateSocket(socket.handle, false, false);
+            }
+            closeSocket(socket.handle);
+        }
+        sockets_.clear();
+        socket_index_.clear();
+    }
+
+    void UdpBatchQueryStrategy::query(const std::string &hostname, DNSQueryCallback callback) {
+        query(hostname, config_.ipv6_enabled ? AF_UNSPEC : AF_INET, std::move(callback));
+    }
+
+    void UdpBatchQueryStrategy::query(const std::string &hostname, int family, DNSQueryCallback callback) {
+        if (!initialized_) {
+            DNS_LOGGER_ERROR(logger_, "udp_batch not initialized, cannot query: {}", hostname);
+            callback({.status = ARES_ENOTINITIALIZED});
+            return;
+        }
+
+        // 先入队再计数：计数从0变为非0时事件循环可能正阻塞在wait()中，需要唤醒
+        submissions_.push({.hostname = hostname, .family = family, .callback = std::move(callback)});
+        if (queued_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            eventLoop_->wakeup();
+        }
+    }
+
+    void UdpBatchQueryStrategy::drainSubmissions() {
+        Submission submission;
+        int64_t drained = 0;
+        while (submissions_.pop(submission)) {
+            ++drained;
+            startRequest(std::move(submission));
+        }
+        if (drained > 0) {
+            queued_.fetch_sub(drained, std::memory_order_acq_rel);
+        }
+    }
+
+    void UdpBatchQueryStrategy::startRequest(Submission submission) {
+        auto [key, request] = requests_.emplace();
+        request->hostname = std::move(submission.hostname);
+        request->callback = std::move(submission.callback);
+        request->start_time = Clock::now();
+
+        std::array<uint16_t, 2> types{};
+        uint8_t count = 0;
+        if (submission.family != AF_INET6) {
+            types[count++] = TYPE_A;
+        }
+        if (submission.family != AF_INET) {
+            types[count++] = TYPE_AAAA;
+        }
+        request->pending = count;
+
+        // 同一请求的A与AAAA查询发往同一个服务器
+        const uint32_t server = server_schedule_[next_server_++ % server_schedule_.size()];
+        const std::string hostname = request->hostname;
+        for (uint8_t i = 0; i < count; ++i) {
+            startTransaction(key, hostname, types[i], server);
+        }
+    }
+
+    void UdpBatchQueryStrategy::startTransaction(RequestMap::Key request_key, const std::string &hostname,
+                                                 uint16_t qtype, uint32_t server) {
+        auto [key, transaction] = transactions_.emplace();
+        transaction->request = request_key;
+        transaction->qtype = qtype;
+        transaction->server = server;
+
+        // 头部：RD，一个问题，一条EDNS OPT附加记录
+        auto *packet = transaction->packet.data();
+        std::memset(packet, 0, HEADER_SIZE);
+        packet[2] = FLAG_RD;
+        writeU16(packet + 4, 1);
+        writeU16(packet + 10, 1);
+
+        const size_t name_length = encodeName(hostname, packet + HEADER_SIZE, config_.udp_batch.use_0x20, rng_);
+        if (name_length == 0) {
+            completeTransaction(key, *transaction, {.status = ARES_EBADNAME});
+            return;
+        }
+        size_t offset = HEADER_SIZE + name_length;
+        writeU16(packet + offset, qtype);
+        writeU16(packet + offset + 2, CLASS_IN);
+        offset += 4;
+        transaction->question_length = static_cast<uint16_t>(name_length + 4);
+
+        // OPT：根名字、类型41、CLASS字段为通告的UDP应答大小，TTL与RDLENGTH为0
+        packet[offset] = 0;
+        writeU16(packet + offset + 1, TYPE_OPT);
+        writeU16(packet + offset + 3, static_cast<uint16_t>(EDNS_UDP_SIZE));
+        std::memset(packet + offset + 5, 0, 6);
+        offset += 11;
+        transaction->length = static_cast<uint16_t>(offset);
+
+        dispatch(key, *transaction);
+    }
+
+    void UdpBatchQueryStrategy::dispatch(TransactionMap::Key key, Transaction &transaction) {
+        if (!assignId(transaction, key)) {
+            DNS_LOGGER_WARN(logger_, "No free query ID for {}", servers_[transaction.server].name);
+            completeTransaction(key, transaction, {.status = ARES_ESERVFAIL});
+            return;
+        }
+        writeU16(transaction.packet.data(), transaction.id);
+
+        transaction.deadline = Clock::now() + servers_[transaction.server].timeout;
+        deadlines_.push({transaction.deadline, key});
+        transaction.queued = true;
+        sockets_[transaction.socket].outbox.push_back(key);
+    }
+
+    bool UdpBatchQueryStrategy::assignId(Transaction &transaction, TransactionMap::Key key) {
+        const int family = servers_[transaction.server].family;
+        for (size_t i = 0; i < sockets_.size(); ++i) {
+            const auto index = static_cast<uint32_t>((next_socket_ + i) % sockets_.size());
+            auto &socket = sockets_[index];
+            if (socket.family != family) {
+                continue;
+            }
+            next_socket_ = index + 1;
+
+            // 随机起点，冲突时顺序查找空闲ID
+            auto id = static_cast<uint16_t>(rng_());
+            for (size_t probe = 0; probe < ID_COUNT; ++probe, ++id) {
+                if (socket.ids[id].index == UINT32_MAX) {
+                    socket.ids[id] = key;
+                    transaction.socket = index;
+                    transaction.id = id;
+                    transaction.has_id = true;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void UdpBatchQueryStrategy::releaseId(Transaction &transaction) {
+        if (transaction.has_id) {
+            sockets_[transaction.socket].ids[transaction.id] = {};
+            transaction.has_id = false;
+        }
+        transaction.queued = false;
+    }
+
+    void UdpBatchQueryStrategy::retryOrFail(TransactionMap::Key key, Transaction &transaction, int status) {
+        releaseId(transaction);
+        closeTcp(transaction);
+        if (transaction.attempt + 1 < max_attempts_ && initialized_) {
+            // 换下一个服务器，以新的ID重发同一报文
+            ++transaction.attempt;
+            transaction.server = (transaction.server + 1) % static_cast<uint32_t>(servers_.size());
+            dispatch(key, transaction);
+            return;
+        }
+        completeTransaction(key, transaction, {.status = status});
+    }
+
+    void UdpBatchQueryStrategy::completeTransaction(TransactionMap::Key key, Transaction &transaction,
+                                                    const Answer &answer) {
+        releaseId(transaction);
+        closeTcp(transaction);
+        const auto request_key = transaction.request;
+        transactions_.erase(key);
+
+        auto *request = requests_.get(request_key);
+        if (!request) {
+            return;
+        }
+        switch (answer.status) {
+            case ARES_SUCCESS:
+                if (answer.ttl >= 0) {
+                    request->ttl = request->ttl < 0 ? answer.ttl : std::min(request->ttl, answer.ttl);
+                }
+                break;
+            case ARES_ENOTFOUND:
+            case ARES_ENODATA:
+                request->nxdomain = request->nxdomain || answer.status == ARES_ENOTFOUND;
+                if (answer.ttl >= 0) {
+                    request->negative_ttl = request->negative_ttl < 0 ? answer.ttl
+                                                                      : std::min(request->negative_ttl, answer.ttl);
+                }
+                break;
+            default:
+                if (request->failure == ARES_SUCCESS) {
+                    request->failure = answer.status;
+                }
+                break;
+        }
+        if (--request->pending == 0) {
+            deliver(request_key);
+        }
+    }
+
+    void UdpBatchQueryStrategy::deliver(RequestMap::Key key) {
+        auto *request = requests_.get(key);
+        // 任一地址族有地址即成功；否则NXDOMAIN优先，其次是服务器失败，最后为NODATA
+        int status;
+        int64_t ttl;
+        if (request->addresses.size() > 0) {
+            status = ARES_SUCCESS;
+            ttl = request->ttl;
+        } else if (request->nxdomain) {
+            status = ARES_ENOTFOUND;
+            ttl = request->negative_ttl;
+        } else if (request->failure != ARES_SUCCESS) {
+            status = request->failure;
+            ttl = -1;
+        } else {
+            status = ARES_ENODATA;
+            ttl = request->negative_ttl;
+        }
+
+        const auto now = Clock::now();
+        ResolveResult result = {
+                .status = status,
+                .hostname = request->hostname,
+                .ip_addresses = std::move(request->addresses).build(),
+                .resolution_time =
+                        std::chrono::duration_cast<std::chrono::microseconds>(now - request->start_time).count(),
+                .error = ares_strerror(status),
+                .from_cache = false,
+                .ttl = ttl < 0 ? -1 : ttl * 1000,
+                .first_packet_ns = steadyNanos(request->first_packet),
+                .answer_parsed_ns = steadyNanos(now),
+        };
+        auto callback = std::move(request->callback);
+        requests_.erase(key);
+        if (callback) {
+            callback(result);
+        }
+    }
+
+    void UdpBatchQueryStrategy::flushSends() {
+        for (uint32_t i = 0; i < sockets_.size(); ++i) {
+            if (!sockets_[i].outbox.empty()) {
+                flushSocket(i);
+            }
+        }
+    }
+
+    void UdpBatchQueryStrategy::flushSocket(uint32_t index) {
+        auto &buffers = *buffers_;
+        size_t position = 0;
+        // 发送失败的处理可能向同一队列追加重发的事务，只按下标访问队列
+        while (position < sockets_[index].outbox.size()) {
+            auto &socket = sockets_[index];
+            size_t count = 0;
+            for (; position < socket.outbox.size() && count < buffers.batch; ++position) {
+                const auto key = socket.outbox[position];
+                auto *transaction = transactions_.get(key);
+                if (!transaction || !transaction->queued || transaction->socket != index) {
+                    continue;
+                }
+                const auto &server = servers_[transaction->server];
+                buffers.packets[count] = transaction->packet.data();
+                buffers.packet_lengths[count] = transaction->length;
+                buffers.targets[count] = &server.address;
+                buffers.target_lengths[count] = server.address_length;
+                buffers.send_keys[count] = key;
+                buffers.send_positions[count] = position;
+                ++count;
+            }
+            if (count == 0) {
+                break;
+            }
+
+            const int sent = buffers.send(socket.handle, count);
+            for (int i = 0; i < sent; ++i) {
+                transactions_.get(buffers.send_keys[i])->queued = false;
+            }
+            if (sent == static_cast<int>(count)) {
+                continue;
+            }
+            if (sent < 0 && wouldBlock()) {
+                // 套接字发送缓冲区已满：保留未发送的部分，可写时继续
+                position = buffers.send_positions[0];
+                break;
+            }
+            if (sent < 0) {
+                // 第一个报文发送失败（如网络不可达），按服务器故障处理，其余报文下一轮重新收集
+                auto key = buffers.send_keys[0];
+                DNS_LOGGER_DEBUG(logger_, "Failed to send query to {}: {}",
+                                 servers_[transactions_.get(key)->server].name, errno);
+                position = buffers.send_positions[0] + 1;
+                retryOrFail(key, *transactions_.get(key), ARES_ECONNREFUSED);
+                continue;
+            }
+            position = buffers.send_positions[sent];
+        }
+
+        auto &socket = sockets_[index];
+        socket.outbox.erase(socket.outbox.begin(), socket.outbox.begin() + static_cast<ptrdiff_t>(position));
+        const bool want_write = !socket.outbox.empty();
+        if (want_write != socket.want_write) {
+            socket.want_write = want_write;
+            eventLoop_->updateSocket(socket.handle, true, want_write);
+        }
+    }
+
+    void UdpBatchQueryStrategy::receive(uint32_t index) {
+        auto &buffers = *buffers_;
+        for (int round = 0; round < MAX_RECEIVE_ROUNDS; ++round) {
+            const int received = buffers.receive(sockets_[index].handle);
+            const auto received_at = Clock::now();
+            for (int i = 0; i < received; ++i) {
+                const uint8_t *data = buffers.receive_buffer.data() + static_cast<size_t>(i) * EDNS_UDP_SIZE;
+                const size_t length = buffers.lengths[i];
+                if (length < HEADER_SIZE) {
+                    continue;
+                }
+                // 按ID找到在途事务，并且应答必须来自该事务所查询的服务器
+                const auto key = sockets_[index].ids[readU16(data)];
+                auto *transaction = transactions_.get(key);
+                if (!transaction || !sameEndpoint(buffers.peers[i], servers_[transaction->server].address)) {
+                    continue;
+                }
+                handleResponse(key, *transaction, data, length, buffers.truncated[i] != 0, received_at);
+            }
+            if (received < static_cast<int>(buffers.batch)) {
+                break;
+            }
+        }
+    }
+
+    bool UdpBatchQueryStrategy::matchesQuestion(const Transaction &transaction, const uint8_t *data,
+                                                size_t length) const {
+        // QR置位的标准查询应答，ID与问题段（逐字节比较，保留0x20大小写）都与查询一致
+        return length >= HEADER_SIZE + transaction.question_length && readU16(data) == transaction.id &&
+               (data[2] & FLAG_QR) && ((data[2] >> 3) & 0x0F) == 0 && readU16(data + 4) == 1 &&
+               std::memcmp(data + HEADER_SIZE, transaction.packet.data() + HEADER_SIZE,
+                           transaction.question_length) == 0;
+    }
+
+    void UdpBatchQueryStrategy::handleResponse(TransactionMap::Key key, Transaction &transaction, const uint8_t *data,
+                                               size_t length, bool truncated, Clock::time_point received) {
+        if (!matchesQuestion(transaction, data, length)) {
+            // 伪造或过期的应答：丢弃并继续等待真正的应答
+            return;
+        }
+        auto *request = requests_.get(transaction.request);
+        if (request->first_packet == Clock::time_point{}) {
+            request->first_packet = received;
+        }
+        if (!transaction.over_tcp && (truncated || (data[2] & FLAG_TC))) {
+            startTcp(key, transaction);
+            return;
+        }
+
+        const auto answer = parseResponse(data, length, HEADER_SIZE + transaction.question_length, transaction.qtype,
+                                          request->addresses);
+        if (answer.status != ARES_SUCCESS && answer.status != ARES_ENODATA && answer.status != ARES_ENOTFOUND) {
+            // SERVFAIL、REFUSED或格式错误：换下一个服务器重试
+            retryOrFail(key, transaction, answer.status);
+            return;
+        }
+        completeTransaction(key, transaction, answer);
+    }
+
+    UdpBatchQueryStrategy::Answer UdpBatchQueryStrategy::parseResponse(const uint8_t *data, size_t length,
+                                                                       size_t offset, uint16_t qtype,
+                                                                       AddressList::Builder &addresses) {
+        const uint8_t rcode = data[3] & 0x0F;
+        switch (rcode) {
+            case 0:
+            case RCODE_NXDOMAIN:
+                break;
+            case 1:
+                return {.status = ARES_EFORMERR};
+            case 2:
+                return {.status = ARES_ESERVFAIL};
+            case 4:
+                return {.status = ARES_ENOTIMP};
+            case 5:
+                return {.status = ARES_EREFUSED};
+            default:
+                return {.status = ARES_EBADRESP};
+        }
+
+        // 逐条解析资源记录，报文不完整时返回false；visit收到属主名在报文中的偏移
+        auto parseRecords = [&](size_t &position, uint16_t count, auto &&visit) {
+            for (uint16_t i = 0; i < count; ++i) {
+                const size_t owner = position;
+                position = skipName(data, length, position);
+                if (position == 0 || position + 10 > length) {
+                    return false;
+                }
+                const uint16_t type = readU16(data + position);
+                const uint16_t rclass = readU16(data + position + 2);
+                const uint32_t ttl = readU32(data + position + 4);
+                const uint16_t rdlength = readU16(data + position + 8);
+                position += 10;
+                if (position + rdlength > length) {
+                    return false;
+                }
+                if (rclass == CLASS_IN) {
+                    visit(owner, type, recordTtl(ttl), data + position, rdlength);
+                }
+                position += rdlength;
+            }
+            return true;
+        };
+
+        const size_t address_length = qtype == TYPE_A ? 4 : 16;
+        const uint16_t answer_count = readU16(data + 6);
+        const uint16_t authority_count = readU16(data + 8);
+
+        // 应答段按顺序沿CNAME链推进（与c-ares一致），只接受属主为当前目标名的记录；
+        // 目标名从问题段的QNAME开始，返回true表示该记录属于链上
+        size_t target = HEADER_SIZE;
+        auto onChain = [&](size_t owner, uint16_t type, const uint8_t *rdata) {
+            if (!sameName(data, length, owner, target)) {
+                return false;
+            }
+            if (type == TYPE_CNAME) {
+                target = static_cast<size_t>(rdata - data);
+            }
+            return true;
+        };
+
+        // 第一遍：校验应答段，统计地址并取链上地址与CNAME记录中最小的TTL
+        size_t position = offset;
+        size_t found = 0;
+        int64_t ttl = -1;
+        const bool answers_ok = parseRecords(position, answer_count, [&](size_t owner, uint16_t type,
+                                                                          int64_t record_ttl, const uint8_t *rdata,
+                                                                          uint16_t rdlength) {
+            if (((type == qtype && rdlength == address_length) || type == TYPE_CNAME) &&
+                onChain(owner, type, rdata)) {
+                ttl = ttl < 0 ? record_ttl : std::min(ttl, record_ttl);
+                found += type == qtype ? 1 : 0;
+            }
+        });
+        if (!answers_ok) {
+            return {.status = ARES_EBADRESP};
+        }
+
+        if (rcode == 0 && found > 0) {
+            // 第二遍：报文已校验，地址直接写入构建器
+            position = offset;
+            target = HEADER_SIZE;
+            parseRecords(position, answer_count, [&](size_t owner, uint16_t type, int64_t, const uint8_t *rdata,
+                                                     uint16_t rdlength) {
+                const bool address = type == qtype && rdlength == address_length;
+                if ((address || type == TYPE_CNAME) && onChain(owner, type, rdata) && address) {
+                    addresses.push_back(qtype == TYPE_A ? IPAddress::fromIPv4(rdata) : IPAddress::fromIPv6(rdata));
+                }
+            });
+            return {.status = ARES_SUCCESS, .ttl = ttl};
+        }
+
+        // 否定应答（RFC 2308）：TTL取授权段SOA记录的TTL与其MINIMUM字段中较小者
+        int64_t negative_ttl = -1;
+        parseRecords(position, authority_count, [&](size_t, uint16_t type, int64_t record_ttl, const uint8_t *rdata,
+                                                    uint16_t rdlength) {
+            if (type == TYPE_SOA && rdlength >= 22) {
+                const int64_t minimum = recordTtl(readU32(rdata + rdlength - 4));
+                negative_ttl = std::min(record_ttl, minimum);
+            }
+        });
+        return {.status = rcode == RCODE_NXDOMAIN ? ARES_ENOTFOUND : ARES_ENODATA, .ttl = negative_ttl};
+    }
+
+    void UdpBatchQueryStrategy::startTcp(TransactionMap::Key key, Transaction &transaction) {
+        releaseId(transaction);
+        const auto &server = servers_[transaction.server];
+        const auto handle = static_cast<SocketHandle>(::socket(server.family, SOCK_STREAM, IPPROTO_TCP));
+        if (handle == INVALID_SOCKET_HANDLE) {
+            retryOrFail(key, transaction, ARES_ECONNREFUSED);
+            return;
+        }
+        if (!setNonBlocking(handle) ||
+            (connect(handle, reinterpret_cast<const sockaddr *>(&server.address), server.address_length) != 0 &&
+             !wouldBlock())) {
+            closeSocket(handle);
+            retryOrFail(key, transaction, ARES_ECONNREFUSED);
+            return;
+        }
+
+        TcpConnection connection;
+        connection.transaction = key;
+        connection.out.resize(2 + transaction.length);
+        writeU16(connection.out.data(), transaction.length);
+        std::memcpy(connection.out.data() + 2, transaction.packet.data(), transaction.length);
+        tcp_connections_.emplace(handle, std::move(connection));
+
+        transaction.over_tcp = true;
+        transaction.tcp = handle;
+        transaction.deadline = Clock::now() + server.timeout;
+        deadlines_.push({transaction.deadline, key});
+        eventLoop_->updateSocket(handle, false, true);
+    }
+
+    void UdpBatchQueryStrategy::onTcpEvent(SocketHandle socket, bool readable, bool writable) {
+        auto it = tcp_connections_.find(socket);
+        if (it == tcp_connections_.end()) {
+            return;
+        }
+        const auto key = it->second.transaction;
+        auto *transaction = transactions_.get(key);
+        auto &connection = it->second;
+        // retryOrFail()会关闭连接，之后不能再访问connection
+        auto fail = [&] { retryOrFail(key, *transaction, ARES_ECONNREFUSED); };
+
+        if (writable && connection.written < connection.out.size()) {
+            int error = 0;
+            socklen_t error_length = sizeof(error);
+            if (connection.written == 0 &&
+                (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &error_length) != 0 ||
+                 error != 0)) {
+                fail();
+                return;
+            }
+            const auto sent = ::send(socket, reinterpret_cast<const char *>(connection.out.data() + connection.written),
+                                     static_cast<int>(connection.out.size() - connection.written), SEND_FLAGS);
+            if (sent < 0 && !wouldBlock()) {
+                fail();
+                return;
+            }
+            connection.written += static_cast<size_t>(std::max<decltype(sent)>(sent, 0));
+            if (connection.written == connection.out.size()) {
+                eventLoop_->updateSocket(socket, true, false);
+            }
+        }
+
+        if (!readable) {
+            return;
+        }
+        std::array<uint8_t, TCP_READ_CHUNK> chunk;
+        for (;;) {
+            const auto received = ::recv(socket, reinterpret_cast<char *>(chunk.data()), static_cast<int>(chunk.size()), 0);
+            if (received == 0 || (received < 0 && !wouldBlock())) {
+                fail();
+                return;
+            }
+            if (received < 0) {
+                return;
+            }
+            connection.in.insert(connection.in.end(), chunk.begin(), chunk.begin() + received);
+            if (connection.in.size() >= 2) {
+                const size_t expected = readU16(connection.in.data());
+                if (connection.in.size() >= 2 + expected) {
+                    // 应答完整：handleResponse()完成或重试事务时关闭连接
+                    std::vector<uint8_t> response(connection.in.begin() + 2,
+                                                  connection.in.begin() + 2 + static_cast<ptrdiff_t>(expected));
+                    handleResponse(key, *transaction, response.data(), response.size(), false, Clock::now());
+                    return;
+                }
+            }
+        }
+    }
+
+    void UdpBatchQueryStrategy::closeTcp(Transaction &transaction) {
+        if (!transaction.over_tcp) {
+            return;
+        }
+        eventLoop_->updateSocket(transaction.tcp, false, false);
+        closeSocket(transaction.tcp);
+        tcp_connections_.erase(transaction.tcp);
+        transaction.over_tcp = false;
+    }
+
+    void UdpBatchQueryStrategy::onSocketEvent(SocketHandle socket, bool readable, bool writable) {
+        auto it = socket_index_.find(socket);
+        if (it == socket_index_.end()) {
+            onTcpEvent(socket, readable, writable);
+            return;
+        }
+        if (readable) {
+            receive(it->second);
+        }
+        if (writable) {
+            flushSocket(it->second);
+        }
+    }
+
+    void UdpBatchQueryStrategy::processTimeouts(Clock::time_point now) {
+        // 已完成或已重发的事务留下的旧记录在到期时跳过
+        while (!deadlines_.empty() && deadlines_.top().deadline <= now) {
+            const auto entry = deadlines_.top();
+            deadlines_.pop();
+            auto *transaction = transactions_.get(entry.transaction);
+            if (transaction && transaction->deadline == entry.deadline) {
+                retryOrFail(entry.transaction, *transaction, ARES_ETIMEOUT);
+            }
+        }
+    }
+
+    void UdpBatchQueryStrategy::processEvents(std::chrono::milliseconds max_wait) {
+        if (!initialized_) return;
+
+        // 先把已提交的查询成批发出，再等待应答
+        drainSubmissions();
+        flushSends();
+
+        const int ready = eventLoop_->wait(nextTimeout(max_wait), [this](SocketHandle socket, bool readable,
+                                                                         bool writable) {
+            onSocketEvent(socket, readable, writable);
+        });
+        if (ready < 0) {
+            DNS_LOGGER_ERROR(logger_, "Event loop wait failed: {}", errno);
+            return;
+        }
+
+        processTimeouts(Clock::now());
+        drainSubmissions();
+        flushSends();
+    }
+
+    void UdpBatchQueryStrategy::processSocket(SocketHandle socket, bool readable, bool writable) {
+        if (!initialized_) return;
+
+        drainSubmissions();
+        onSocketEvent(socket, readable, writable);
+        processTimeouts(Clock::now());
+        flushSends();
+    }
+
+    std::chrono::milliseconds UdpBatchQueryStrategy::nextTimeout(std::chrono::milliseconds max_wait) {
+        if (!initialized_) return max_wait;
+
+        // 还有未取出的提交或未发出的报文时不等待
+        if (queued_.load(std::memory_order_acquire) > 0 ||
+            std::ranges::any_of(sockets_, [](const UdpSocket &socket) { return !socket.outbox.empty(); })) {
+            return std::chrono::milliseconds(0);
+        }
+        if (!deadlines_.empty()) {
+            const auto until = deadlines_.top().deadline - Clock::now();
+            // 向上取整，避免在超时到期前空转
+            max_wait = std::min(max_wait, std::max(std::chrono::ceil<std::chrono::milliseconds>(until),
+                                                   std::chrono::milliseconds(0)));
+        }
+        return max_wait;
+    }
+
+    std::shared_ptr<IEventLoop> UdpBatchQueryStrategy::eventLoop() const {
+        return eventLoop_;
+    }
+
+    void UdpBatchQueryStrategy::shutdown() {
+        bool expected = true;
+        if (!initialized_.compare_exchange_strong(expected, false)) {
+            DNS_LOGGER_ERROR(logger_, "udp_batch shutdown already in progress");
+            return;
+        }
+
+        // 取消所有未完成的请求（包括尚未取出的提交），回调在清理完成后执行
+        std::vector<DNSQueryCallback> cancelled;
+        Submission submission;
+        while (submissions_.pop(submission)) {
+            cancelled.push_back(std::move(submission.callback));
+        }
+        queued_.store(0, std::memory_order_relaxed);
+        requests_.forEach([&](RequestMap::Key key, Request &request) {
+            if (request.callback) {
+                cancelled.push_back(std::move(request.callback));
+            }
+            requests_.erase(key);
+        });
+        transactions_.forEach([&](TransactionMap::Key key, Transaction &transaction) {
+            closeTcp(transaction);
+            transactions_.erase(key);
+        });
+        deadlines_ = {};
+        closeSockets();
+
+        for (const auto &callback: cancelled) {
+            if (callback) {
+                callback({.status = ARES_ECANCELLED});
+            }
+        }
+        DNS_LOGGER_INFO(logger_, "udp_batch shutdown completed");
+    }
+
+    bool UdpBatchQueryStrategy::isInitialized() const {
+        return initialized_;
+    }
+
+}// namespace leigod::dns